@@ -186,6 +186,16 @@ final class BatchCompressionQueue: Identifiable {
         }.count
     }
 
+    /// Number of items that have finished (completed, failed or skipped)
+    var processedCount: Int {
+        items.filter {
+            switch $0.state {
+            case .completed, .failed, .skipped: return true
+            default: return false
+            }
+        }.count
+    }
+
     /// Current item being processed
     var currentItem: BatchCompressionItem? {
         items.first { $0.state.isActive }
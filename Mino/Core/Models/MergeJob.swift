@@ -85,6 +85,9 @@ struct MergeResult: Identifiable, Sendable, Codable {
     let duration: TimeInterval
     let timestamp: Date
 
+    /// Engine measurements (not persisted)
+    var stats: EngineStats? = nil
+
     /// Formatted output file size
     var formattedSize: String {
         ByteCountFormatter.string(fromByteCount: outputSize, countStyle: .file)
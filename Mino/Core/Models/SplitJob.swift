@@ -140,6 +140,9 @@ struct SplitResult: Identifiable, Sendable, Codable {
     let outputSize: Int64
     let timestamp: Date
 
+    /// Engine measurements (not persisted)
+    var stats: EngineStats? = nil
+
     /// Formatted output file size
     var formattedSize: String {
         ByteCountFormatter.string(fromByteCount: outputSize, countStyle: .file)
@@ -0,0 +1,26 @@
+//
+//  EngineMemory.swift
+//  Mino
+//
+//  Memory limit for the native engine
+//
+
+import Foundation
+import os
+
+/// Caps what the shared MuPDF contexts may allocate, so a large document
+/// makes a job fail instead of getting the app terminated
+enum EngineMemory {
+
+    /// Share of the memory left to the process that the engine may use
+    nonisolated static let availableFraction = 0.6
+
+    /// Sets the shared pool's budget. Must run before the first engine call.
+    nonisolated static func configure() {
+        // Zero when the process has no limit, e.g. on the simulator
+        let available = os_proc_available_memory()
+        guard available > 0 else { return }
+
+        _ = mino_set_shared_memory_budget(Int(Double(available) * availableFraction))
+    }
+}
@@ -0,0 +1,119 @@
+//
+//  EngineStats.swift
+//  Mino
+//
+//  Per-phase timing and memory measurements reported by the MuPDF engine
+//
+
+import Foundation
+
+/// Measurements collected by the native engine while a job ran
+struct EngineStats: Sendable, Codable {
+    /// Opening the document and reading its cross-reference table
+    var openDuration: TimeInterval = 0
+
+    /// Part of the open time spent on documents whose xref had to be rebuilt
+    var repairDuration: TimeInterval = 0
+
+    /// Interpreting pages to find the resolution images are drawn at
+    var scanDuration: TimeInterval = 0
+
+    /// Decoding, downsampling and re-encoding images
+    var imageDuration: TimeInterval = 0
+
+    /// Garbage collection and object renumbering before the output is written
+    var garbageCollectionDuration: TimeInterval = 0
+
+    /// Serializing the output
+    var writeDuration: TimeInterval = 0
+
+    /// Rasterizing pages
+    var renderDuration: TimeInterval = 0
+
+    /// Sampling images to predict the output size
+    var estimateDuration: TimeInterval = 0
+
+    /// Number of images that were recompressed
+    var imagesRewritten: Int = 0
+
+    /// Duplicate images merged into another before recompression
+    var imagesDeduplicated: Int = 0
+
+    /// Recompressed images loaded from the on-disk cache
+    var imageCacheHits: Int = 0
+
+    /// Images left as they were because recompression would have grown them
+    var imagesKept: Int = 0
+
+    /// Page renders that replayed a cached display list instead of parsing
+    var displayListHits: Int = 0
+
+    /// Size of the documents opened
+    var bytesIn: Int64 = 0
+
+    /// Encoded size of the images that were replaced
+    var imageBytesIn: Int64 = 0
+
+    /// Encoded size of their replacements
+    var imageBytesOut: Int64 = 0
+
+    /// Bytes written
+    var bytesOut: Int64 = 0
+
+    /// Highest engine heap use while the job ran (shared by concurrent jobs)
+    var peakHeapBytes: Int64 = 0
+
+    /// Allocations that had to evict cached resources first
+    var storeEvictions: Int = 0
+
+    nonisolated init() {}
+
+    /// Converts the native stats struct
+    nonisolated init(_ stats: mino_job_stats) {
+        openDuration = Self.seconds(stats.open_ns)
+        repairDuration = Self.seconds(stats.repair_ns)
+        scanDuration = Self.seconds(stats.scan_ns)
+        imageDuration = Self.seconds(stats.images_ns)
+        garbageCollectionDuration = Self.seconds(stats.gc_ns)
+        writeDuration = Self.seconds(stats.write_ns)
+        renderDuration = Self.seconds(stats.render_ns)
+        estimateDuration = Self.seconds(stats.estimate_ns)
+        imagesRewritten = Int(stats.images_rewritten)
+        imagesDeduplicated = Int(stats.images_deduplicated)
+        imageCacheHits = Int(stats.image_cache_hits)
+        imagesKept = Int(stats.images_kept)
+        displayListHits = Int(stats.display_list_hits)
+        bytesIn = stats.bytes_in
+        imageBytesIn = stats.image_bytes_in
+        imageBytesOut = stats.image_bytes_out
+        bytesOut = stats.bytes_out
+        peakHeapBytes = stats.peak_heap_bytes
+        storeEvictions = Int(stats.store_evictions)
+    }
+
+    /// Total time attributed to engine phases
+    var engineDuration: TimeInterval {
+        openDuration + scanDuration + imageDuration + garbageCollectionDuration
+            + writeDuration + renderDuration + estimateDuration
+    }
+
+    /// One-line summary for logs
+    var summary: String {
+        String(
+            format: "open %.0fms, scan %.0fms, images %.0fms (%d, %d kept, %d merged), gc %.0fms, write %.0fms, peak %@",
+            openDuration * 1000,
+            scanDuration * 1000,
+            imageDuration * 1000,
+            imagesRewritten,
+            imagesKept,
+            imagesDeduplicated,
+            garbageCollectionDuration * 1000,
+            writeDuration * 1000,
+            ByteCountFormatter.string(fromByteCount: peakHeapBytes, countStyle: .memory)
+        )
+    }
+
+    nonisolated private static func seconds(_ nanoseconds: Int64) -> TimeInterval {
+        TimeInterval(nanoseconds) / 1_000_000_000
+    }
+}
@@ -30,6 +30,9 @@ final class MuPDFDocument: @unchecked Sendable {
     /// Internal PDF document pointer
     private var pdfDocument: UnsafeMutablePointer<pdf_document>?
 
+    /// Keeps in-memory document bytes alive while MuPDF reads from them
+    private var backingData: NSData?
+
     /// Lock for thread safety
     private let lock = NSLock()
 
@@ -54,6 +57,37 @@ final class MuPDFDocument: @unchecked Sendable {
             throw MuPDFError.accessDenied(path: url.path)
         }
 
+        // Map the file rather than reading it through buffered I/O
+        try open { ctx in mino_open_document_mapped(ctx, url.path) }
+    }
+
+    /// Opens a PDF document held in memory, without writing it to disk
+    /// - Parameters:
+    ///   - data: The PDF bytes
+    ///   - sourceURL: The URL the document is associated with (it need not exist yet)
+    /// - Throws: MuPDFError if the document cannot be opened
+    init(data: Data, sourceURL: URL) throws {
+        self.sourceURL = sourceURL
+        self.originalFileSize = Int64(data.count)
+
+        // NSData gives MuPDF a stable pointer for the document's lifetime
+        let storage = data as NSData
+        self.backingData = storage
+
+        try open { ctx in
+            mino_open_document_from_memory(
+                ctx,
+                storage.bytes.assumingMemoryBound(to: UInt8.self),
+                storage.length
+            )
+        }
+    }
+
+    /// Creates the context, opens the document with the given function and
+    /// reads its page count
+    private func open(
+        with opener: (UnsafeMutablePointer<fz_context>) -> UnsafeMutablePointer<fz_document>?
+    ) throws {
         // Create MuPDF context
         guard let ctx = mino_create_context() else {
             throw MuPDFError.contextCreationFailed
@@ -61,17 +95,17 @@ final class MuPDFDocument: @unchecked Sendable {
         self.context = ctx
 
         // Open document
-        guard let doc = mino_open_document(ctx, url.path) else {
+        guard let doc = opener(ctx) else {
             let errorMsg = String(cString: mino_get_last_error() ?? "Unknown error".withCString { $0 })
             mino_drop_context(ctx)
-            throw MuPDFError.documentOpenFailed(path: url.path, reason: errorMsg)
+            self.context = nil
+            throw MuPDFError.documentOpenFailed(path: sourceURL.path, reason: errorMsg)
         }
         self.document = doc
 
         // Get PDF-specific handle
         guard let pdfDoc = mino_pdf_specifics(ctx, doc) else {
-            mino_drop_document(ctx, doc)
-            mino_drop_context(ctx)
+            close()
             throw MuPDFError.invalidPDFDocument
         }
         self.pdfDocument = pdfDoc
@@ -79,8 +113,7 @@ final class MuPDFDocument: @unchecked Sendable {
         // Get page count
         let count = mino_count_pages(ctx, doc)
         if count < 0 {
-            mino_drop_document(ctx, doc)
-            mino_drop_context(ctx)
+            close()
             throw MuPDFError.invalidPDFDocument
         }
         self.pageCount = Int(count)
@@ -106,6 +139,7 @@ final class MuPDFDocument: @unchecked Sendable {
             mino_drop_context(ctx)
             context = nil
         }
+        backingData = nil
     }
 
     /// Returns the internal context pointer (for advanced operations)
@@ -19,6 +19,7 @@ enum MuPDFError: Error, LocalizedError {
     case fileNotFound(path: String)
     case accessDenied(path: String)
     case unknownError(String)
+    case cancelled
 
     // Merge/Split specific errors
     case documentCreationFailed
@@ -57,6 +58,8 @@ enum MuPDFError: Error, LocalizedError {
             return "Access denied: \(file)"
         case .unknownError(let message):
             return message
+        case .cancelled:
+            return "The operation was cancelled"
         case .documentCreationFailed:
             return "Failed to create new PDF document"
         case .graftMapFailed:
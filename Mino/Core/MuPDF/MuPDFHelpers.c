@@ -9,11 +9,33 @@
 #include "mupdf/pdf.h"
 #include "MuPDFHelpers.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // Thread-local error message storage
 static __thread char last_error[256] = {0};
 
+// Job whose output last stopped at its size ceiling on this thread. The
+// output wrapper that throws is gone by the time the status is worked out.
+static __thread const mino_job *ceiling_job = NULL;
+
 // Store error message
 static void set_error(const char *msg) {
     if (msg) {
@@ -32,17 +54,199 @@ void mino_clear_error(void) {
     last_error[0] = '\0';
 }
 
-// Create a new MuPDF context
-fz_context* mino_create_context(void) {
+// MARK: - Locking
+
+// One lock table shared by every context Mino creates. MuPDF only requires
+// that all contexts in a cloned family agree on their locks, so a single
+// process-wide table keeps the wiring simple and makes every context clonable.
+static pthread_mutex_t mino_mutexes[FZ_LOCK_MAX];
+static pthread_once_t mino_mutexes_once = PTHREAD_ONCE_INIT;
+
+static void init_mutexes(void) {
+    for (int i = 0; i < FZ_LOCK_MAX; i++) {
+        pthread_mutex_init(&mino_mutexes[i], NULL);
+    }
+}
+
+static void lock_mutex(void *user, int lock) {
+    (void)user;
+    pthread_mutex_lock(&mino_mutexes[lock]);
+}
+
+static void unlock_mutex(void *user, int lock) {
+    (void)user;
+    pthread_mutex_unlock(&mino_mutexes[lock]);
+}
+
+static const fz_locks_context mino_locks = { NULL, lock_mutex, unlock_mutex };
+
+static const fz_locks_context* get_locks(void) {
+    pthread_once(&mino_mutexes_once, init_mutexes);
+    return &mino_locks;
+}
+
+// MARK: - Heap Accounting
+
+// Every context Mino creates allocates through these functions. Each block
+// carries its size in a header so engine heap use can be reported per job,
+// and the tally it was allocated under so a thread can measure what one piece
+// of work leaves allocated.
+#define HEAP_HEADER 16      // Size and tally; keeps blocks aligned for any type
+
+static size_t heap_current = 0;
+static size_t heap_peak = 0;
+static int heap_failures = 0;       // NULL returns; MuPDF then evicts from the store and retries
+static int heap_jobs_active = 0;
+static size_t heap_next_tally = 0;
+static __thread size_t heap_thread_tally = 0;       // Tally running on this thread, 0 for none
+static __thread int64_t heap_thread_tally_bytes = 0;    // Live bytes allocated under it
+
+// Hard limit shared by a context and its clones, passed as the allocator's
+// user pointer. An allocation that would exceed it returns NULL, which makes
+// MuPDF scavenge the store and retry; it only throws once nothing more can
+// be evicted.
+typedef struct {
+    size_t limit;
+    size_t current;
+    size_t peak;
+    int scavenges;          // Allocations refused for being over the limit
+} mino_memory_budget;
+
+static void note_peak(size_t *peak_, size_t now) {
+    size_t peak = __atomic_load_n(peak_, __ATOMIC_RELAXED);
+    while (now > peak &&
+           !__atomic_compare_exchange_n(peak_, &peak, now, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void heap_note_alloc(size_t size) {
+    note_peak(&heap_peak, __atomic_add_fetch(&heap_current, size, __ATOMIC_RELAXED));
+}
+
+// Count what the calling thread allocates from now on and has not freed by
+// heap_tally_end. Frees of older blocks, such as store scavenging, and work
+// on other threads do not affect it.
+static void heap_tally_begin(void) {
+    heap_thread_tally = __atomic_add_fetch(&heap_next_tally, 1, __ATOMIC_RELAXED);
+    heap_thread_tally_bytes = 0;
+}
+
+static int64_t heap_tally_end(void) {
+    heap_thread_tally = 0;
+    return heap_thread_tally_bytes;
+}
+
+// Claim size bytes of the budget. Returns 0 when that would exceed it.
+static int budget_reserve(mino_memory_budget *budget, size_t size) {
+    if (!budget || size == 0) return 1;
+
+    size_t now = __atomic_add_fetch(&budget->current, size, __ATOMIC_RELAXED);
+    if (now > budget->limit) {
+        __atomic_sub_fetch(&budget->current, size, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&budget->scavenges, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&heap_failures, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    note_peak(&budget->peak, now);
+    return 1;
+}
+
+static void budget_release(mino_memory_budget *budget, size_t size) {
+    if (budget) {
+        __atomic_sub_fetch(&budget->current, size, __ATOMIC_RELAXED);
+    }
+}
+
+static void* heap_malloc(void *user, size_t size) {
+    if (!budget_reserve(user, size)) {
+        return NULL;
+    }
+
+    unsigned char *block = malloc(size + HEAP_HEADER);
+    if (!block) {
+        budget_release(user, size);
+        __atomic_add_fetch(&heap_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    size_t *header = (size_t *)block;
+    header[0] = size;
+    header[1] = heap_thread_tally;
+    if (heap_thread_tally) heap_thread_tally_bytes += (int64_t)size;
+    heap_note_alloc(size);
+    return block + HEAP_HEADER;
+}
+
+static void* heap_realloc(void *user, void *old, size_t size) {
+    if (!old) {
+        return heap_malloc(user, size);
+    }
+
+    unsigned char *block = (unsigned char *)old - HEAP_HEADER;
+    size_t old_size = *(size_t *)block;
+    if (size > old_size && !budget_reserve(user, size - old_size)) {
+        return NULL;
+    }
+
+    unsigned char *resized = realloc(block, size + HEAP_HEADER);
+    if (!resized) {
+        if (size > old_size) budget_release(user, size - old_size);
+        __atomic_add_fetch(&heap_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    if (size < old_size) budget_release(user, old_size - size);
+
+    // The block stays in the tally it was allocated under
+    size_t *header = (size_t *)resized;
+    header[0] = size;
+    if (header[1] && header[1] == heap_thread_tally) {
+        heap_thread_tally_bytes += (int64_t)size - (int64_t)old_size;
+    }
+    __atomic_sub_fetch(&heap_current, old_size, __ATOMIC_RELAXED);
+    heap_note_alloc(size);
+    return resized + HEAP_HEADER;
+}
+
+static void heap_free(void *user, void *ptr) {
+    if (!ptr) return;
+
+    unsigned char *block = (unsigned char *)ptr - HEAP_HEADER;
+    size_t *header = (size_t *)block;
+    size_t size = header[0];
+    budget_release(user, size);
+    __atomic_sub_fetch(&heap_current, size, __ATOMIC_RELAXED);
+    if (header[1] && header[1] == heap_thread_tally) {
+        heap_thread_tally_bytes -= (int64_t)size;
+    }
+    free(block);
+}
+
+static const fz_alloc_context mino_alloc = { NULL, heap_malloc, heap_realloc, heap_free };
+
+// Bytes currently allocated by all Mino contexts
+size_t mino_heap_in_use(void) {
+    return __atomic_load_n(&heap_current, __ATOMIC_RELAXED);
+}
+
+// Number of online CPU cores (at least 1)
+static int available_cores(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Defined by MuPDF's PDF module; document-all.c declares it the same way
+extern fz_document_handler pdf_document_handler;
+
+static fz_context* new_context(const fz_alloc_context *alloc, size_t max_store) {
     mino_clear_error();
-    fz_context *ctx = fz_new_context(NULL, NULL, FZ_STORE_DEFAULT);
+    fz_context *ctx = fz_new_context(alloc, get_locks(), max_store);
     if (!ctx) {
         set_error("Failed to create MuPDF context");
         return NULL;
     }
 
+    // Mino only opens PDFs, so the other handlers are never registered
     fz_try(ctx) {
-        fz_register_document_handlers(ctx);
+        fz_register_document_handler(ctx, &pdf_document_handler);
     }
     fz_catch(ctx) {
         set_error(fz_caught_message(ctx));
@@ -53,308 +257,4697 @@ fz_context* mino_create_context(void) {
     return ctx;
 }
 
+// Create a new MuPDF context
+fz_context* mino_create_context(void) {
+    return new_context(&mino_alloc, FZ_STORE_DEFAULT);
+}
+
+// Create a context whose family may never hold more than max_bytes. The
+// store gets a quarter of it so cached resources give way to working memory
+// well before the limit.
+fz_context* mino_create_context_with_budget(size_t max_bytes) {
+    if (max_bytes == 0) {
+        return mino_create_context();
+    }
+
+    mino_memory_budget *budget = calloc(1, sizeof(*budget));
+    if (!budget) {
+        set_error("Failed to allocate memory budget");
+        return NULL;
+    }
+    budget->limit = max_bytes;
+
+    fz_alloc_context alloc = { budget, heap_malloc, heap_realloc, heap_free };
+    fz_context *ctx = new_context(&alloc, max_bytes / 4);
+    if (!ctx) {
+        free(budget);
+    }
+    return ctx;
+}
+
+static mino_memory_budget* context_budget(fz_context *ctx) {
+    return ctx && ctx->alloc.malloc == heap_malloc ? ctx->alloc.user : NULL;
+}
+
+int mino_context_memory(fz_context *ctx, mino_memory_stats *stats) {
+    mino_memory_budget *budget = context_budget(ctx);
+    if (!budget || !stats) {
+        return -1;
+    }
+
+    stats->limit_bytes = (int64_t)budget->limit;
+    stats->in_use_bytes = (int64_t)__atomic_load_n(&budget->current, __ATOMIC_RELAXED);
+    stats->peak_bytes = (int64_t)__atomic_load_n(&budget->peak, __ATOMIC_RELAXED);
+    stats->scavenges = __atomic_load_n(&budget->scavenges, __ATOMIC_RELAXED);
+    return 0;
+}
+
 // Drop/free context
 void mino_drop_context(fz_context *ctx) {
     if (ctx) {
+        // The budget outlives every block, which the context frees on drop
+        mino_memory_budget *budget = context_budget(ctx);
         fz_drop_context(ctx);
+        free(budget);
     }
 }
 
-// Open a document
-fz_document* mino_open_document(fz_context *ctx, const char *path) {
-    if (!ctx || !path) {
-        set_error("Invalid context or path");
+// MARK: - Context Pool
+
+struct mino_context_pool {
+    pthread_mutex_t mutex;
+    fz_context *master;     // Never handed out; only cloned under `mutex`
+    fz_context **idle;      // Released clones ready for reuse
+    int idle_count;
+    int capacity;
+};
+
+// Create a pool whose contexts share the master's store and caches
+mino_context_pool* mino_context_pool_create(int capacity) {
+    return mino_context_pool_create_with_budget(capacity, 0);
+}
+
+// Create a pool whose contexts together stay within max_bytes (0 for no limit)
+mino_context_pool* mino_context_pool_create_with_budget(int capacity, size_t max_bytes) {
+    if (capacity <= 0) {
+        capacity = available_cores();
+    }
+
+    mino_context_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        set_error("Failed to allocate context pool");
         return NULL;
     }
 
-    mino_clear_error();
-    fz_document *doc = NULL;
+    pool->idle = calloc((size_t)capacity, sizeof(fz_context *));
+    pool->master = mino_create_context_with_budget(max_bytes);
+    if (!pool->idle || !pool->master) {
+        if (!pool->master) {
+            set_error("Failed to create context pool master");
+        }
+        mino_drop_context(pool->master);
+        free(pool->idle);
+        free(pool);
+        return NULL;
+    }
 
-    fz_try(ctx) {
-        doc = fz_open_document(ctx, path);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->capacity = capacity;
+
+    // Pre-warm the pool so the first jobs don't pay for cloning
+    for (int i = 0; i < capacity; i++) {
+        fz_context *clone = fz_clone_context(pool->master);
+        if (!clone) break;
+        pool->idle[pool->idle_count++] = clone;
     }
-    fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
+
+    return pool;
+}
+
+// Drop the pool, its idle clones and the master context
+void mino_context_pool_drop(mino_context_pool *pool) {
+    if (!pool) return;
+
+    // Clones must go before the master that owns the shared store
+    for (int i = 0; i < pool->idle_count; i++) {
+        fz_drop_context(pool->idle[i]);
+    }
+    mino_drop_context(pool->master);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->idle);
+    free(pool);
+}
+
+// Take a warm context from the pool, cloning a new one if none are idle
+fz_context* mino_context_pool_acquire(mino_context_pool *pool) {
+    if (!pool) {
+        set_error("Invalid context pool");
         return NULL;
     }
 
-    return doc;
+    fz_context *ctx = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->idle_count > 0) {
+        ctx = pool->idle[--pool->idle_count];
+    } else {
+        ctx = fz_clone_context(pool->master);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!ctx) {
+        set_error("Failed to clone MuPDF context");
+    }
+    return ctx;
 }
 
-// Drop/close document
-void mino_drop_document(fz_context *ctx, fz_document *doc) {
-    if (ctx && doc) {
-        fz_drop_document(ctx, doc);
+// Return a context to the pool (dropped if the pool is already full)
+void mino_context_pool_release(mino_context_pool *pool, fz_context *ctx) {
+    if (!pool || !ctx) return;
+
+    fz_flush_warnings(ctx);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->idle_count < pool->capacity) {
+        pool->idle[pool->idle_count++] = ctx;
+        ctx = NULL;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (ctx) {
+        fz_drop_context(ctx);
     }
 }
 
-// Get page count
-int mino_count_pages(fz_context *ctx, fz_document *doc) {
-    if (!ctx || !doc) {
+// Process-wide pool used by the Swift engines
+static mino_context_pool *shared_pool = NULL;
+static pthread_once_t shared_pool_once = PTHREAD_ONCE_INIT;
+static size_t shared_pool_budget = 0;
+static int shared_pool_started = 0;
+
+static void init_shared_pool(void) {
+    __atomic_store_n(&shared_pool_started, 1, __ATOMIC_RELEASE);
+    shared_pool = mino_context_pool_create_with_budget(0, __atomic_load_n(&shared_pool_budget, __ATOMIC_ACQUIRE));
+}
+
+int mino_set_shared_memory_budget(size_t max_bytes) {
+    if (__atomic_load_n(&shared_pool_started, __ATOMIC_ACQUIRE)) {
+        set_error("The shared context pool is already in use");
         return -1;
     }
+    __atomic_store_n(&shared_pool_budget, max_bytes, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static mino_context_pool* get_shared_pool(void) {
+    pthread_once(&shared_pool_once, init_shared_pool);
+    return shared_pool;
+}
+
+fz_context* mino_acquire_context(void) {
+    mino_context_pool *pool = get_shared_pool();
+    if (!pool) {
+        set_error("Failed to create shared context pool");
+        return NULL;
+    }
+    return mino_context_pool_acquire(pool);
+}
+
+void mino_release_context(fz_context *ctx) {
+    mino_context_pool_release(get_shared_pool(), ctx);
+}
+
+// MARK: - Worker Threads
+
+// Upper bound on threads started for a single parallel operation
+#define MINO_MAX_WORKERS 64
+
+typedef void (*worker_job_fn)(fz_context *ctx, void *arg, int job);
+
+typedef struct {
+    fz_context *parent;     // Cloned once per worker; NULL to use the shared pool
+    int job_count;
+    int next_job;           // Claimed atomically by the workers
+    const int *stop;        // Optional flag checked before each job is claimed
+    worker_job_fn fn;
+    void *arg;
+} worker_group;
+
+static void run_worker_jobs(fz_context *ctx, worker_group *group) {
+    for (;;) {
+        if (group->stop && __atomic_load_n(group->stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        int job = __atomic_fetch_add(&group->next_job, 1, __ATOMIC_RELAXED);
+        if (job >= group->job_count) {
+            break;
+        }
+        group->fn(ctx, group->arg, job);
+    }
+}
+
+static void* worker_main(void *arg) {
+    worker_group *group = arg;
+    fz_context *ctx = group->parent ? fz_clone_context(group->parent) : mino_acquire_context();
+
+    // If no context is available the other workers pick up the jobs
+    if (!ctx) return NULL;
+
+    run_worker_jobs(ctx, group);
+
+    if (group->parent) {
+        fz_drop_context(ctx);
+    } else {
+        mino_release_context(ctx);
+    }
+    return NULL;
+}
+
+// Run job_count jobs across up to thread_count threads (<= 0 for one per
+// core). The calling thread takes part as well, using `parent` directly or a
+// pooled context when `parent` is NULL, so jobs still run if no extra thread
+// can be started. Returns once every claimed job has finished.
+static void run_workers(
+    fz_context *parent,
+    int thread_count,
+    int job_count,
+    const int *stop,
+    worker_job_fn fn,
+    void *arg
+) {
+    worker_group group = { parent, job_count, 0, stop, fn, arg };
+
+    if (thread_count <= 0) thread_count = available_cores();
+    if (thread_count > job_count) thread_count = job_count;
+    if (thread_count > MINO_MAX_WORKERS) thread_count = MINO_MAX_WORKERS;
+    if (thread_count < 1) return;
+
+    pthread_t threads[MINO_MAX_WORKERS];
+    int started = 0;
+    for (int i = 1; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, worker_main, &group) == 0) {
+            started++;
+        }
+    }
+
+    fz_context *ctx = parent ? parent : mino_acquire_context();
+    if (ctx) {
+        run_worker_jobs(ctx, &group);
+        if (!parent) {
+            mino_release_context(ctx);
+        }
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Monotonic clock in nanoseconds
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// MARK: - Jobs
+
+fz_cookie* mino_new_cookie(void) {
+    return calloc(1, sizeof(fz_cookie));
+}
+
+void mino_drop_cookie(fz_cookie *cookie) {
+    free(cookie);
+}
+
+void mino_abort_cookie(fz_cookie *cookie) {
+    if (cookie) {
+        __atomic_store_n(&cookie->abort, 1, __ATOMIC_RELEASE);
+    }
+}
+
+int mino_cookie_aborted(const fz_cookie *cookie) {
+    return cookie ? __atomic_load_n(&cookie->abort, __ATOMIC_ACQUIRE) : 0;
+}
+
+static int job_aborted(const mino_job *job) {
+    return job ? mino_cookie_aborted(job->cookie) : 0;
+}
+
+// Throw out of the current operation once the job has been cancelled
+static void check_abort(fz_context *ctx, const mino_job *job) {
+    if (job_aborted(job)) {
+        fz_throw(ctx, FZ_ERROR_ABORT, "Operation cancelled");
+    }
+}
+
+static const int* job_abort_flag(const mino_job *job) {
+    return job && job->cookie ? &job->cookie->abort : NULL;
+}
+
+// Worker threads the job's own parallel stages may use
+static int job_threads(const mino_job *job) {
+    return job && job->threads > 0 ? job->threads : available_cores();
+}
+
+static void report_progress(mino_job *job, int phase, int done, int total) {
+    if (!job) return;
+
+    if (job->cookie) {
+        job->cookie->progress = done;
+        job->cookie->progress_max = (size_t)total;
+    }
+    if (job->progress) {
+        job->progress(job->progress_user, phase, done, total);
+    }
+}
+
+// Snapshot taken when a job-aware operation starts
+typedef struct {
+    int64_t start_ns;
+    int heap_failures;
+} stats_mark;
+
+static mino_job_stats* job_stats(const mino_job *job) {
+    return job ? job->stats : NULL;
+}
+
+static void stats_begin(const mino_job *job, stats_mark *mark) {
+    mark->start_ns = now_ns();
+    ceiling_job = NULL;
+    if (!job_stats(job)) return;
+
+    // The peak restarts whenever no other job is being measured
+    if (__atomic_fetch_add(&heap_jobs_active, 1, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_store_n(&heap_peak, mino_heap_in_use(), __ATOMIC_RELAXED);
+    }
+    mark->heap_failures = __atomic_load_n(&heap_failures, __ATOMIC_RELAXED);
+}
+
+static void stats_end(const mino_job *job, const stats_mark *mark) {
+    mino_job_stats *stats = job_stats(job);
+    if (!stats) return;
+
+    int64_t peak = (int64_t)__atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+    if (peak > stats->peak_heap_bytes) {
+        stats->peak_heap_bytes = peak;
+    }
+    stats->store_evictions += __atomic_load_n(&heap_failures, __ATOMIC_RELAXED) - mark->heap_failures;
+    __atomic_sub_fetch(&heap_jobs_active, 1, __ATOMIC_ACQ_REL);
+}
+
+// Map a caught exception to a status code and record its message
+static int caught_status(fz_context *ctx, const mino_job *job) {
+    if (fz_caught(ctx) == FZ_ERROR_ABORT || job_aborted(job)) {
+        set_error("Operation cancelled");
+        return MINO_STATUS_CANCELLED;
+    }
+    // MuPDF raises FZ_ERROR_LIMIT itself for oversized images and memory
+    // limits; only the output's own ceiling means there is nothing to gain
+    if (fz_caught(ctx) == FZ_ERROR_LIMIT && job && ceiling_job == job) {
+        ceiling_job = NULL;
+        set_error(fz_caught_message(ctx));
+        return MINO_STATUS_NO_GAIN;
+    }
+    set_error(fz_caught_message(ctx));
+    return MINO_STATUS_ERROR;
+}
+
+// Output wrapper that tracks objects written and honours cancellation
+typedef struct {
+    fz_output *target;
+    mino_job *job;
+    pdf_document *doc;      // Set when the xref size is only known once writing starts
+    int64_t written;
+    int objects_written;    // For progress only: stream data can hold "endobj" too
+    int objects_total;
+    int matched;            // Length of the "endobj" prefix seen so far
+    int reported_percent;
+    int64_t first_byte_ns;  // Everything before this is garbage collection
+    int xref_table;         // A classic xref table follows the objects
+    int xref_entries;       // Entries in that table
+} job_output;
+
+// Smallest possible trailer: "trailer\n<</Size 1/Root 1 0 R>>\nstartxref\n0\n%%EOF\n"
+#define MIN_TRAILER_BYTES 48
+
+// Bytes the output is certain to reach: what is written, plus the xref table
+// (20 bytes for every entry) and the trailer
+static int64_t job_output_floor(const job_output *state) {
+    int64_t floor = state->written + MIN_TRAILER_BYTES;
+    if (state->xref_table) {
+        floor += 20 * (int64_t)state->xref_entries;
+    }
+    return floor;
+}
+
+static const char endobj_token[] = "endobj";
+
+static void job_output_write(fz_context *ctx, void *state_, const void *data, size_t n) {
+    job_output *state = state_;
+    check_abort(ctx, state->job);
+
+    if (state->first_byte_ns == 0) {
+        state->first_byte_ns = now_ns();
+
+        // Garbage collection has renumbered the objects by now, and the
+        // writer's table covers every number up to the xref length
+        if (state->doc) {
+            state->xref_entries = pdf_xref_len(ctx, state->doc);
+        }
+    }
+
+    fz_write_data(ctx, state->target, data, n);
+    state->written += (int64_t)n;
+
+    // Count "endobj" tokens for progress, which may straddle two writes
+    const char *p = data;
+    const char *end = p + n;
+    while (p < end) {
+        if (state->matched == 0) {
+            p = memchr(p, 'e', (size_t)(end - p));
+            if (!p) break;
+        }
+        if (*p == endobj_token[state->matched]) {
+            if (++state->matched == (int)sizeof(endobj_token) - 1) {
+                state->objects_written++;
+                state->matched = 0;
+            }
+        } else {
+            state->matched = *p == 'e' ? 1 : 0;
+        }
+        p++;
+    }
+
+    if (state->objects_total > 0) {
+        int done = state->objects_written < state->objects_total
+            ? state->objects_written
+            : state->objects_total;
+        int percent = (int)((int64_t)done * 100 / state->objects_total);
+        if (percent != state->reported_percent) {
+            state->reported_percent = percent;
+            report_progress(state->job, MINO_PHASE_WRITE, done, state->objects_total);
+        }
+    }
+
+    if (state->job->size_ceiling > 0 && job_output_floor(state) >= state->job->size_ceiling) {
+        ceiling_job = state->job;
+        fz_throw(ctx, FZ_ERROR_LIMIT, "Output would not be smaller than %lld bytes",
+            (long long)state->job->size_ceiling);
+    }
+}
+
+static int64_t job_output_tell(fz_context *ctx, void *state) {
+    return ((job_output *)state)->written;
+}
+
+// Write the document to an output, reporting progress and honouring the job
+static void write_pdf(
+    fz_context *ctx,
+    pdf_document *doc,
+    fz_output *target,
+    const pdf_write_options *opts,
+    mino_job *job
+) {
+    if (!job) {
+        pdf_write_document(ctx, doc, target, opts);
+        return;
+    }
+
+    job_output state = {
+        .target = target,
+        .job = job,
+        .doc = doc,
+        .objects_total = pdf_xref_len(ctx, doc),
+        .reported_percent = -1,
+        .xref_table = !opts->do_use_objstms,
+    };
+    fz_output *out = NULL;
+    int64_t start = now_ns();
+
+    fz_var(out);
 
-    int count = 0;
     fz_try(ctx) {
-        count = fz_count_pages(ctx, doc);
+        out = fz_new_output(ctx, 8192, &state, job_output_write, NULL, NULL);
+        out->tell = job_output_tell;
+        pdf_write_document(ctx, doc, out, opts);
+        fz_close_output(ctx, out);
+        report_progress(job, MINO_PHASE_WRITE, state.objects_total, state.objects_total);
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) {
+            int64_t end = now_ns();
+            int64_t first_byte = state.first_byte_ns ? state.first_byte_ns : end;
+            stats->gc_ns += first_byte - start;
+            stats->write_ns += end - first_byte;
+            stats->bytes_out += state.written;
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_output(ctx, out);
     }
     fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        return -1;
+        fz_rethrow(ctx);
     }
+}
 
-    return count;
+// Write the document to a file, removing the partial file on failure
+static void save_pdf(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *path,
+    const pdf_write_options *opts,
+    mino_job *job
+) {
+    fz_output *file = NULL;
+
+    fz_var(file);
+
+    fz_try(ctx) {
+        file = fz_new_output_with_path(ctx, path, 0);
+        write_pdf(ctx, doc, file, opts, job);
+        fz_close_output(ctx, file);
+    }
+    fz_always(ctx) {
+        fz_drop_output(ctx, file);
+    }
+    fz_catch(ctx) {
+        remove(path);
+        fz_rethrow(ctx);
+    }
+}
+
+// Open a document. Every open goes straight to the PDF parser rather than
+// through format detection.
+fz_document* mino_open_document(fz_context *ctx, const char *path) {
+    if (!ctx || !path) {
+        set_error("Invalid context or path");
+        return NULL;
+    }
+
+    mino_clear_error();
+    fz_document *doc = NULL;
+
+    fz_try(ctx) {
+        doc = &pdf_open_document(ctx, path)->super;
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return NULL;
+    }
+
+    return doc;
+}
+
+// Open a document from a caller-owned memory block, which must stay valid
+// until the document is dropped
+fz_document* mino_open_document_from_memory(
+    fz_context *ctx,
+    const unsigned char *data,
+    size_t length
+) {
+    if (!ctx || !data || length == 0) {
+        set_error("Invalid context or data");
+        return NULL;
+    }
+
+    mino_clear_error();
+    fz_stream *stm = NULL;
+    fz_document *doc = NULL;
+
+    fz_var(stm);
+
+    fz_try(ctx) {
+        stm = fz_open_memory(ctx, data, length);
+        doc = &pdf_open_document_with_stream(ctx, stm)->super;
+    }
+    fz_always(ctx) {
+        // The document keeps its own reference to the stream
+        fz_drop_stream(ctx, stm);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return NULL;
+    }
+
+    return doc;
+}
+
+// A read-only mapping of a whole file, served to MuPDF as one buffer
+typedef struct {
+    void *base;
+    size_t length;
+} mapped_file;
+
+static int mapped_next(fz_context *ctx, fz_stream *stm, size_t max) {
+    // The entire file is available from the start
+    return EOF;
+}
+
+static void mapped_seek(fz_context *ctx, fz_stream *stm, int64_t offset, int whence) {
+    mapped_file *file = stm->state;
+    int64_t pos = stm->rp - (unsigned char *)file->base;
+
+    if (whence == SEEK_CUR) offset += pos;
+    else if (whence == SEEK_END) offset += (int64_t)file->length;
+
+    if (offset < 0) offset = 0;
+    if (offset > (int64_t)file->length) offset = (int64_t)file->length;
+
+    stm->rp = (unsigned char *)file->base + offset;
+}
+
+static void mapped_drop(fz_context *ctx, void *state) {
+    mapped_file *file = state;
+    munmap(file->base, file->length);
+    fz_free(ctx, file);
+}
+
+// Open a document through a memory-mapped view of the file
+fz_document* mino_open_document_mapped(fz_context *ctx, const char *path) {
+    if (!ctx || !path) {
+        set_error("Invalid context or path");
+        return NULL;
+    }
+
+    mino_clear_error();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_error("Cannot open file");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        set_error("Cannot read file");
+        return NULL;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        set_error("Cannot map file");
+        return NULL;
+    }
+
+    fz_stream *stm = NULL;
+    fz_document *doc = NULL;
+
+    fz_var(base);
+    fz_var(stm);
+
+    fz_try(ctx) {
+        mapped_file *file = fz_malloc_struct(ctx, mapped_file);
+        file->base = base;
+        file->length = (size_t)st.st_size;
+
+        // The stream owns the mapping from here on (fz_new_stream drops the
+        // state itself if it fails)
+        base = NULL;
+        stm = fz_new_stream(ctx, file, mapped_next, mapped_drop);
+        stm->rp = file->base;
+        stm->wp = (unsigned char *)file->base + file->length;
+        stm->pos = (int64_t)file->length;
+        stm->seek = mapped_seek;
+
+        doc = &pdf_open_document_with_stream(ctx, stm)->super;
+    }
+    fz_always(ctx) {
+        fz_drop_stream(ctx, stm);
+    }
+    fz_catch(ctx) {
+        if (base) {
+            munmap(base, (size_t)st.st_size);
+        }
+        set_error(fz_caught_message(ctx));
+        return NULL;
+    }
+
+    return doc;
+}
+
+// Open a document, recording open and repair time in the job's stats
+fz_document* mino_open_document_job(fz_context *ctx, const char *path, mino_job *job) {
+    stats_mark mark;
+    stats_begin(job, &mark);
+
+    fz_document *doc = mino_open_document(ctx, path);
+
+    mino_job_stats *stats = job_stats(job);
+    if (doc && stats) {
+        int64_t elapsed = now_ns() - mark.start_ns;
+        stats->open_ns += elapsed;
+
+        // MuPDF rebuilds a broken xref while opening
+        pdf_document *pdf = pdf_document_from_fz_document(ctx, doc);
+        if (pdf && pdf_was_repaired(ctx, pdf)) {
+            stats->repair_ns += elapsed;
+        }
+
+        int64_t size = mino_get_file_size(path);
+        if (size > 0) {
+            stats->bytes_in += size;
+        }
+    }
+    stats_end(job, &mark);
+
+    return doc;
+}
+
+// Drop/close document
+void mino_drop_document(fz_context *ctx, fz_document *doc) {
+    if (ctx && doc) {
+        fz_drop_document(ctx, doc);
+    }
+}
+
+// Get page count
+int mino_count_pages(fz_context *ctx, fz_document *doc) {
+    if (!ctx || !doc) {
+        return -1;
+    }
+
+    int count = 0;
+    fz_try(ctx) {
+        count = fz_count_pages(ctx, doc);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return -1;
+    }
+
+    return count;
+}
+
+// Get PDF-specific document handle
+pdf_document* mino_pdf_specifics(fz_context *ctx, fz_document *doc) {
+    if (!ctx || !doc) {
+        return NULL;
+    }
+    return pdf_specifics(ctx, doc);
+}
+
+// MARK: - Image Rewriting
+//
+// Images are rewritten in three stages:
+//   1. Enumerate image XObjects and the lowest effective DPI at which each is
+//      drawn, by running every page through a device that records image uses.
+//      Identical images are then merged into one object, so each is
+//      recompressed once.
+//   2. Decode, downsample and JPEG-encode the images on worker threads, each
+//      with a context cloned from the caller's.
+//   3. Write the new streams back into the document on the calling thread.
+// Only stage 2 runs in parallel; the document is touched by one thread only.
+
+// Image XObject referenced from the page currently being scanned
+typedef struct {
+    fz_image *image;
+    int num;
+} page_image;
+
+typedef struct {
+    page_image *items;
+    int count;
+    int capacity;
+} page_image_list;
+
+// Device that records the lowest effective DPI of every known image
+typedef struct {
+    fz_device super;
+    page_image_list *images;    // Sorted by image pointer
+    float *min_dpi;             // Indexed by object number
+    int *uses;                  // Draw count by object number, or NULL
+} dpi_device;
+
+static int compare_page_images(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)((const page_image *)a)->image;
+    uintptr_t y = (uintptr_t)((const page_image *)b)->image;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void record_image_draw(dpi_device *dev, fz_image *image, fz_matrix ctm) {
+    page_image key = { image, 0 };
+    page_image *found = bsearch(
+        &key, dev->images->items, (size_t)dev->images->count,
+        sizeof(page_image), compare_page_images
+    );
+    if (!found) return;
+
+    if (dev->uses) dev->uses[found->num]++;
+
+    // The image maps to the unit square, so the ctm axes are its size in points
+    float width_pts = sqrtf(ctm.a * ctm.a + ctm.b * ctm.b);
+    float height_pts = sqrtf(ctm.c * ctm.c + ctm.d * ctm.d);
+    if (width_pts <= 0 || height_pts <= 0) return;
+
+    float dpi = fminf(image->w * 72.0f / width_pts, image->h * 72.0f / height_pts);
+    float *slot = &dev->min_dpi[found->num];
+    if (*slot == 0 || dpi < *slot) {
+        *slot = dpi;
+    }
+}
+
+static void dpi_device_fill_image(
+    fz_context *ctx,
+    fz_device *dev,
+    fz_image *image,
+    fz_matrix ctm,
+    float alpha,
+    fz_color_params color_params
+) {
+    record_image_draw((dpi_device *)dev, image, ctm);
+}
+
+// Stencil masks (/ImageMask true) are painted through these instead of fill_image
+static void dpi_device_fill_image_mask(
+    fz_context *ctx,
+    fz_device *dev,
+    fz_image *image,
+    fz_matrix ctm,
+    fz_colorspace *colorspace,
+    const float *color,
+    float alpha,
+    fz_color_params color_params
+) {
+    record_image_draw((dpi_device *)dev, image, ctm);
+}
+
+static void dpi_device_clip_image_mask(
+    fz_context *ctx,
+    fz_device *dev,
+    fz_image *image,
+    fz_matrix ctm,
+    fz_rect scissor
+) {
+    record_image_draw((dpi_device *)dev, image, ctm);
+}
+
+static void add_page_image(fz_context *ctx, page_image_list *list, fz_image *image, int num) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = fz_realloc_array(ctx, list->items, capacity, page_image);
+        list->capacity = capacity;
+    }
+    list->items[list->count].image = image;
+    list->items[list->count].num = num;
+    list->count++;
+}
+
+static int page_image_list_has(page_image_list *list, int num) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i].num == num) return 1;
+    }
+    return 0;
+}
+
+// Load every image XObject reachable from a resource dictionary (including
+// nested form XObjects) so the device can match images back to objects
+static void collect_page_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    pdf_obj *resources,
+    page_image_list *list,
+    int depth
+) {
+    if (!resources || depth > 8) return;
+
+    pdf_obj *xobjects = pdf_dict_get(ctx, resources, PDF_NAME(XObject));
+    int n = pdf_dict_len(ctx, xobjects);
+
+    for (int i = 0; i < n; i++) {
+        pdf_obj *ref = pdf_dict_get_val(ctx, xobjects, i);
+        if (!pdf_is_indirect(ctx, ref)) continue;
+
+        pdf_obj *subtype = pdf_dict_get(ctx, ref, PDF_NAME(Subtype));
+        if (pdf_name_eq(ctx, subtype, PDF_NAME(Image))) {
+            int num = pdf_to_num(ctx, ref);
+            if (page_image_list_has(list, num)) continue;
+
+            fz_image *image = NULL;
+            fz_try(ctx) {
+                image = pdf_load_image(ctx, doc, ref);
+            }
+            fz_catch(ctx) {
+                // Broken images are left for the writer to deal with
+                fz_warn(ctx, "skipping unreadable image %d", num);
+                continue;
+            }
+
+            fz_try(ctx) {
+                add_page_image(ctx, list, image, num);
+            }
+            fz_catch(ctx) {
+                fz_drop_image(ctx, image);
+                fz_rethrow(ctx);
+            }
+        } else if (pdf_name_eq(ctx, subtype, PDF_NAME(Form))) {
+            if (pdf_mark_obj(ctx, ref)) continue;
+            fz_try(ctx) {
+                pdf_obj *form_resources = pdf_dict_get(ctx, ref, PDF_NAME(Resources));
+                collect_page_images(ctx, doc, form_resources, list, depth + 1);
+            }
+            fz_always(ctx) {
+                pdf_unmark_obj(ctx, ref);
+            }
+            fz_catch(ctx) {
+                fz_rethrow(ctx);
+            }
+        }
+    }
+}
+
+static void drop_page_images(fz_context *ctx, page_image_list *list) {
+    for (int i = 0; i < list->count; i++) {
+        fz_drop_image(ctx, list->items[i].image);
+    }
+    list->count = 0;
+}
+
+// Stage 1: find the lowest effective DPI of every image drawn on a page.
+// Returns an array indexed by object number (0 for objects never drawn).
+// When uses is given it receives the number of times each image is drawn.
+static float* find_image_dpis(fz_context *ctx, pdf_document *doc, int *uses, mino_job *job) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    int page_count = pdf_count_pages(ctx, doc);
+    float *min_dpi = fz_calloc(ctx, (size_t)xref_len, sizeof(float));
+    page_image_list images = { NULL, 0, 0 };
+    dpi_device *dev = NULL;
+    fz_page *page = NULL;
+
+    fz_var(dev);
+    fz_var(page);
+
+    fz_try(ctx) {
+        dev = fz_new_derived_device(ctx, dpi_device);
+        dev->super.fill_image = dpi_device_fill_image;
+        dev->super.fill_image_mask = dpi_device_fill_image_mask;
+        dev->super.clip_image_mask = dpi_device_clip_image_mask;
+        dev->images = &images;
+        dev->min_dpi = min_dpi;
+        dev->uses = uses;
+
+        for (int i = 0; i < page_count; i++) {
+            check_abort(ctx, job);
+            report_progress(job, MINO_PHASE_SCAN, i, page_count);
+
+            pdf_obj *page_obj = pdf_lookup_page_obj(ctx, doc, i);
+            pdf_obj *resources = pdf_dict_get_inheritable(ctx, page_obj, PDF_NAME(Resources));
+
+            collect_page_images(ctx, doc, resources, &images, 0);
+            if (images.count == 0) continue;
+
+            // Hold the images while the page runs so the interpreter gets the
+            // same fz_image instances back from the store
+            qsort(images.items, (size_t)images.count, sizeof(page_image), compare_page_images);
+
+            page = fz_load_page(ctx, &doc->super, i);
+            fz_run_page(ctx, page, &dev->super, fz_identity, job ? job->cookie : NULL);
+            fz_drop_page(ctx, page);
+            page = NULL;
+
+            drop_page_images(ctx, &images);
+        }
+
+        fz_close_device(ctx, &dev->super);
+        check_abort(ctx, job);
+        report_progress(job, MINO_PHASE_SCAN, page_count, page_count);
+    }
+    fz_always(ctx) {
+        fz_drop_page(ctx, page);
+        fz_drop_device(ctx, (fz_device *)dev);
+        drop_page_images(ctx, &images);
+        fz_free(ctx, images.items);
+    }
+    fz_catch(ctx) {
+        fz_free(ctx, min_dpi);
+        fz_rethrow(ctx);
+    }
+
+    return min_dpi;
+}
+
+// An image selected for rewriting
+typedef struct {
+    int num;
+    float min_dpi;
+    fz_image *image;            // Loaded by the owning thread
+    int out_w, out_h;           // Size after downsampling
+    fz_buffer *encoded;         // JPEG stream produced by a worker
+    fz_colorspace *out_cs;      // Set when the colorspace had to be converted
+    unsigned char cache_key[16];
+    int cache_miss;             // cache_key is set and the result should be stored
+    int keep_original;          // Cached decision: re-encoding does not make it smaller
+    int64_t original_size;      // Size the original is written at if it is kept
+    fz_buffer *original_raw;    // Unfiltered original, deflated by the worker to size it
+} rewrite_candidate;
+
+typedef struct {
+    const mino_rewrite_options *opts;
+    rewrite_candidate *candidates;
+} rewrite_batch;
+
+// JPEG carries gray or RGB without alpha; anything else is converted
+static int jpeg_compatible(fz_context *ctx, fz_pixmap *pix) {
+    if (pix->alpha) return 0;
+    return fz_colorspace_is_gray(ctx, pix->colorspace) || fz_colorspace_is_rgb(ctx, pix->colorspace);
+}
+
+// Decode an image into a pixmap JPEG can carry. *converted is set to the
+// new colorspace when the image had to be converted.
+static fz_pixmap* decode_for_jpeg(fz_context *ctx, fz_image *image, fz_colorspace **converted) {
+    fz_pixmap *pix = fz_get_pixmap_from_image(ctx, image, NULL, NULL, NULL, NULL);
+    if (jpeg_compatible(ctx, pix)) {
+        // Indexed images decode to their base colorspace, which the
+        // dictionary must then name instead of the palette
+        if (pix->colorspace != image->colorspace) {
+            *converted = fz_colorspace_n(ctx, pix->colorspace) == 1 ? fz_device_gray(ctx) : fz_device_rgb(ctx);
+        }
+        return pix;
+    }
+
+    fz_pixmap *tmp = NULL;
+    fz_try(ctx) {
+        fz_colorspace *cs = fz_colorspace_n(ctx, pix->colorspace) == 1
+            ? fz_device_gray(ctx)
+            : fz_device_rgb(ctx);
+        tmp = fz_convert_pixmap(ctx, pix, cs, NULL, NULL, fz_default_color_params, 0);
+        *converted = cs;
+    }
+    fz_always(ctx) {
+        fz_drop_pixmap(ctx, pix);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+    return tmp;
+}
+
+// Size of a buffer once the writer deflates it
+static int64_t deflated_size(fz_context *ctx, fz_buffer *raw) {
+    unsigned char *deflated = NULL;
+    size_t length = 0;
+
+    fz_try(ctx) {
+        deflated = fz_new_deflated_data_from_buffer(ctx, &length, raw, FZ_DEFLATE_DEFAULT);
+    }
+    fz_always(ctx) {
+        fz_free(ctx, deflated);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+    return (int64_t)length;
+}
+
+// Stage 2: decode, downsample and encode one image on a worker context
+static void rewrite_image_job(fz_context *ctx, void *arg, int job) {
+    rewrite_batch *batch = arg;
+    rewrite_candidate *c = &batch->candidates[job];
+    fz_pixmap *pix = NULL;
+    fz_pixmap *tmp = NULL;
+
+    // Size the original here rather than serially in stage 3
+    if (c->original_raw) {
+        fz_try(ctx) {
+            c->original_size = deflated_size(ctx, c->original_raw);
+        }
+        fz_always(ctx) {
+            fz_drop_buffer(ctx, c->original_raw);
+            c->original_raw = NULL;
+        }
+        fz_catch(ctx) {
+            // Compare against the unfiltered length instead
+            fz_warn(ctx, "cannot size image %d: %s", c->num, fz_caught_message(ctx));
+        }
+    }
+
+    // Already loaded from the image cache
+    if (c->encoded) return;
+
+    fz_var(pix);
+    fz_var(tmp);
+
+    fz_try(ctx) {
+        pix = decode_for_jpeg(ctx, c->image, &c->out_cs);
+
+        // MuPDF's scaler averages the source pixels when reducing
+        if (c->out_w != pix->w || c->out_h != pix->h) {
+            tmp = fz_scale_pixmap(ctx, pix, 0, 0, (float)c->out_w, (float)c->out_h, NULL);
+            fz_drop_pixmap(ctx, pix);
+            pix = tmp;
+            tmp = NULL;
+        }
+
+        c->out_w = pix->w;
+        c->out_h = pix->h;
+        c->encoded = fz_new_buffer_from_pixmap_as_jpeg(
+            ctx, pix, fz_default_color_params, batch->opts->jpeg_quality, 0
+        );
+    }
+    fz_always(ctx) {
+        fz_drop_pixmap(ctx, tmp);
+        fz_drop_pixmap(ctx, pix);
+    }
+    fz_catch(ctx) {
+        // Leave this image untouched
+        fz_warn(ctx, "cannot rewrite image %d: %s", c->num, fz_caught_message(ctx));
+        c->encoded = NULL;
+    }
+}
+
+// Whether an image can be recompressed as JPEG without changing its meaning
+static int is_rewritable(fz_context *ctx, pdf_obj *dict, fz_image *image) {
+    if (image->imagemask || image->use_colorkey || image->bpc < 8) return 0;
+    if (pdf_is_array(ctx, pdf_dict_get(ctx, dict, PDF_NAME(Mask)))) return 0;
+    if (pdf_dict_get_int(ctx, dict, PDF_NAME(SMaskInData))) return 0;
+    return 1;
+}
+
+// Size an image is rewritten at: downsampled to target_dpi when it is drawn
+// above the threshold, otherwise unchanged
+static void rewrite_size(
+    const mino_rewrite_options *opts,
+    int w,
+    int h,
+    float min_dpi,
+    int *out_w,
+    int *out_h
+) {
+    *out_w = w;
+    *out_h = h;
+    if (min_dpi > opts->dpi_threshold) {
+        float scale = opts->target_dpi / min_dpi;
+        *out_w = (int)(w * scale + 0.5f);
+        *out_h = (int)(h * scale + 0.5f);
+        if (*out_w < 1) *out_w = 1;
+        if (*out_h < 1) *out_h = 1;
+    }
+}
+
+// Prepare a candidate on the owning thread. Returns 0 if the image is skipped.
+static int load_candidate(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts,
+    rewrite_candidate *c
+) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, c->num, 0);
+    int keep = 0;
+
+    fz_try(ctx) {
+        c->image = pdf_load_image(ctx, doc, ref);
+        keep = is_rewritable(ctx, ref, c->image);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_warn(ctx, "skipping unreadable image %d", c->num);
+        keep = 0;
+    }
+
+    if (!keep) {
+        fz_drop_image(ctx, c->image);
+        c->image = NULL;
+        return 0;
+    }
+
+    rewrite_size(opts, c->image->w, c->image->h, c->min_dpi, &c->out_w, &c->out_h);
+    return 1;
+}
+
+// Record the original's size on the owning thread. Filtered streams are
+// copied as they are; an unfiltered one is deflated by the writer, so when
+// the policy compares sizes its data is loaded for the worker to deflate.
+static void prepare_original(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts,
+    rewrite_candidate *c
+) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, c->num, 0);
+
+    fz_try(ctx) {
+        c->original_size = pdf_dict_get_int64(ctx, ref, PDF_NAME(Length));
+        if (opts->replace == MINO_REPLACE_IF_SMALLER && !pdf_dict_get(ctx, ref, PDF_NAME(Filter))) {
+            c->original_raw = pdf_load_raw_stream_number(ctx, doc, c->num);
+        }
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_warn(ctx, "cannot read image %d: %s", c->num, fz_caught_message(ctx));
+    }
+}
+
+// Size a stream will have in the output: unfiltered streams are deflated by
+// the writer, filtered ones are copied
+static int64_t written_stream_size(fz_context *ctx, pdf_document *doc, pdf_obj *obj, int num) {
+    if (pdf_dict_get(ctx, obj, PDF_NAME(Filter))) {
+        return pdf_dict_get_int64(ctx, obj, PDF_NAME(Length));
+    }
+
+    fz_buffer *raw = pdf_load_raw_stream_number(ctx, doc, num);
+    int64_t length = 0;
+
+    fz_try(ctx) {
+        length = deflated_size(ctx, raw);
+    }
+    fz_always(ctx) {
+        fz_drop_buffer(ctx, raw);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+    return length;
+}
+
+// Update an image dictionary to describe the candidate's JPEG stream
+static void describe_candidate(fz_context *ctx, pdf_obj *dict, const rewrite_candidate *c) {
+    pdf_dict_put(ctx, dict, PDF_NAME(Filter), PDF_NAME(DCTDecode));
+    pdf_dict_del(ctx, dict, PDF_NAME(DecodeParms));
+    pdf_dict_del(ctx, dict, PDF_NAME(Decode));
+    pdf_dict_put_int(ctx, dict, PDF_NAME(Width), c->out_w);
+    pdf_dict_put_int(ctx, dict, PDF_NAME(Height), c->out_h);
+    pdf_dict_put_int(ctx, dict, PDF_NAME(BitsPerComponent), 8);
+    if (c->out_cs) {
+        pdf_dict_put(ctx, dict, PDF_NAME(ColorSpace),
+            fz_colorspace_is_gray(ctx, c->out_cs) ? PDF_NAME(DeviceGray) : PDF_NAME(DeviceRGB));
+    }
+}
+
+// Stage 3: replace the image stream and update its dictionary
+// Replace the image stream, returning the size of the stream it replaced
+static int64_t store_candidate(fz_context *ctx, pdf_document *doc, rewrite_candidate *c) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, c->num, 0);
+    int64_t old_length = 0;
+
+    fz_try(ctx) {
+        old_length = pdf_dict_get_int64(ctx, ref, PDF_NAME(Length));
+        pdf_update_stream(ctx, doc, ref, c->encoded, 1);
+        describe_candidate(ctx, ref, c);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return old_length;
+}
+
+static void release_candidate(fz_context *ctx, rewrite_candidate *c) {
+    fz_drop_image(ctx, c->image);
+    fz_drop_buffer(ctx, c->encoded);
+    fz_drop_buffer(ctx, c->original_raw);
+    c->image = NULL;
+    c->encoded = NULL;
+    c->original_raw = NULL;
+}
+
+// Stage 1 with timing. The result is freed by the caller.
+static float* scan_images(fz_context *ctx, pdf_document *doc, mino_job *job) {
+    int64_t start = now_ns();
+    float *min_dpi = find_image_dpis(ctx, doc, NULL, job);
+
+    mino_job_stats *stats = job_stats(job);
+    if (stats) stats->scan_ns += now_ns() - start;
+    return min_dpi;
+}
+
+// MARK: - Image Deduplication
+//
+// Images are identical when their dictionaries and encoded streams match
+// byte for byte, or failing that when they decode to the same pixels with the
+// same masks. Only images whose dimensions collide with another's are decoded
+// for the second test. Duplicates are redirected to one canonical object,
+// which keeps the lowest DPI of the group, and deleted.
+
+typedef struct {
+    int num;
+    int w, h;
+    unsigned char key[16];
+    int keyed;                  // key holds a content hash
+    int canonical;              // Object this one is replaced by, or 0
+    fz_image *image;            // Loaded for pixel hashing only
+    unsigned char pixels[16];
+    int hashed;                 // pixels is valid
+} dedup_entry;
+
+static void md5_output_write(fz_context *ctx, void *state, const void *data, size_t n) {
+    fz_md5_update(state, data, n);
+}
+
+// Hash an object's printed form (indirect references by number)
+static void md5_object(fz_context *ctx, fz_md5 *md5, pdf_obj *obj) {
+    fz_output *out = fz_new_output(ctx, 256, md5, md5_output_write, NULL, NULL);
+    fz_try(ctx) {
+        pdf_print_obj(ctx, out, obj, 1, 0);
+        fz_close_output(ctx, out);
+    }
+    fz_always(ctx) {
+        fz_drop_output(ctx, out);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// MD5 over an image's dictionary and encoded stream
+static void hash_image_object(fz_context *ctx, pdf_document *doc, int num, unsigned char digest[16]) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, num, 0);
+    fz_buffer *raw = NULL;
+    fz_md5 md5;
+
+    fz_var(raw);
+
+    fz_try(ctx) {
+        fz_md5_init(&md5);
+        md5_object(ctx, &md5, pdf_resolve_indirect(ctx, ref));
+        raw = pdf_load_raw_stream_number(ctx, doc, num);
+        unsigned char *data = NULL;
+        size_t length = fz_buffer_storage(ctx, raw, &data);
+        fz_md5_update(&md5, data, length);
+        fz_md5_final(&md5, digest);
+    }
+    fz_always(ctx) {
+        fz_drop_buffer(ctx, raw);
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Key over the dictionary and the encoded stream
+static void hash_encoded_image(fz_context *ctx, pdf_document *doc, dedup_entry *e) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, e->num, 0);
+
+    fz_try(ctx) {
+        e->w = pdf_dict_get_int(ctx, ref, PDF_NAME(Width));
+        e->h = pdf_dict_get_int(ctx, ref, PDF_NAME(Height));
+        hash_image_object(ctx, doc, e->num, e->key);
+        e->keyed = 1;
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_warn(ctx, "cannot hash image %d", e->num);
+        e->keyed = 0;
+    }
+}
+
+// Worker: hash the decoded samples of one image
+static void hash_pixels_job(fz_context *ctx, void *arg, int job) {
+    dedup_entry *e = ((dedup_entry **)arg)[job];
+    fz_pixmap *pix = NULL;
+    fz_md5 md5;
+
+    fz_var(pix);
+
+    fz_try(ctx) {
+        pix = fz_get_pixmap_from_image(ctx, e->image, NULL, NULL, NULL, NULL);
+        int header[4] = { pix->w, pix->h, pix->n, pix->alpha };
+        const char *cs = pix->colorspace ? fz_colorspace_name(ctx, pix->colorspace) : "";
+        size_t row = (size_t)pix->w * pix->n;
+
+        fz_md5_init(&md5);
+        fz_md5_update(&md5, (const unsigned char *)header, sizeof(header));
+        fz_md5_update(&md5, (const unsigned char *)cs, strlen(cs) + 1);
+        for (int y = 0; y < pix->h; y++) {
+            fz_md5_update(&md5, pix->samples + (size_t)y * pix->stride, row);
+        }
+        fz_md5_final(&md5, e->pixels);
+        e->hashed = 1;
+    }
+    fz_always(ctx) {
+        fz_drop_pixmap(ctx, pix);
+    }
+    fz_catch(ctx) {
+        // A failed decode leaves the image unique
+        e->hashed = 0;
+    }
+}
+
+// Combine the pixel hash with the entries that change how the pixels are
+// drawn, so images with different masks, colour spaces or decode arrays stay
+// apart. The colour space is printed as the first pass prints it, so two
+// ICCBased images only merge when they name the same profile object.
+static void rekey_with_pixels(fz_context *ctx, pdf_document *doc, dedup_entry *e) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, e->num, 0);
+    fz_md5 md5;
+
+    fz_try(ctx) {
+        fz_md5_init(&md5);
+        fz_md5_update(&md5, e->pixels, sizeof(e->pixels));
+        md5_object(ctx, &md5, pdf_dict_get(ctx, ref, PDF_NAME(ColorSpace)));
+        md5_object(ctx, &md5, pdf_dict_get(ctx, ref, PDF_NAME(Decode)));
+        md5_object(ctx, &md5, pdf_dict_get(ctx, ref, PDF_NAME(SMask)));
+        md5_object(ctx, &md5, pdf_dict_get(ctx, ref, PDF_NAME(Mask)));
+        md5_object(ctx, &md5, pdf_dict_get(ctx, ref, PDF_NAME(ImageMask)));
+        fz_md5_final(&md5, e->key);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+static int compare_dedup_keys(const void *a, const void *b) {
+    const dedup_entry *x = a, *y = b;
+    if (x->keyed != y->keyed) return y->keyed - x->keyed;
+    int order = memcmp(x->key, y->key, sizeof(x->key));
+    return order ? order : x->num - y->num;
+}
+
+static int compare_dedup_sizes(const void *a, const void *b) {
+    const dedup_entry *x = a, *y = b;
+    if (x->canonical != y->canonical) return (x->canonical != 0) - (y->canonical != 0);
+    if (x->w != y->w) return x->w - y->w;
+    if (x->h != y->h) return x->h - y->h;
+    return x->num - y->num;
+}
+
+// After sorting by key, point every repeat of a key at the first entry
+// with it. Returns the number of duplicates found.
+static int mark_duplicates(dedup_entry *entries, int count) {
+    int found = 0;
+    int first = 0;
+    for (int i = 1; i < count; i++) {
+        if (!entries[i].keyed) break;
+        if (memcmp(entries[first].key, entries[i].key, sizeof(entries[i].key)) == 0) {
+            entries[i].canonical = entries[first].num;
+            found++;
+        } else {
+            first = i;
+        }
+    }
+    return found;
+}
+
+// Decode images sharing their dimensions with another survivor and merge
+// those with equal pixels
+static int dedup_by_pixels(
+    fz_context *ctx,
+    pdf_document *doc,
+    dedup_entry *entries,
+    int count,
+    mino_job *job
+) {
+    dedup_entry **batch = NULL;
+    int batch_count = 0;
+    int found = 0;
+
+    fz_var(batch);
+    fz_var(batch_count);
+
+    qsort(entries, (size_t)count, sizeof(dedup_entry), compare_dedup_sizes);
+
+    fz_try(ctx) {
+        int threads = job_threads(job);
+        int chunk_size = threads * 4;
+        batch = fz_malloc_array(ctx, count, dedup_entry *);
+
+        // Candidates: survivors with a same-sized neighbour
+        int candidates = 0;
+        for (int i = 0; i < count; i++) {
+            dedup_entry *e = &entries[i];
+            e->keyed = 0;
+            if (e->canonical) continue;
+            int same_prev = i > 0 && !entries[i - 1].canonical &&
+                entries[i - 1].w == e->w && entries[i - 1].h == e->h;
+            int same_next = i + 1 < count && !entries[i + 1].canonical &&
+                entries[i + 1].w == e->w && entries[i + 1].h == e->h;
+            if (same_prev || same_next) {
+                batch[candidates++] = e;
+            }
+        }
+
+        for (int first = 0; first < candidates; first += chunk_size) {
+            int n = candidates - first < chunk_size ? candidates - first : chunk_size;
+            dedup_entry **chunk = &batch[first];
+
+            batch_count = 0;
+            for (int i = 0; i < n; i++) {
+                pdf_obj *ref = pdf_new_indirect(ctx, doc, chunk[i]->num, 0);
+                fz_try(ctx) {
+                    chunk[i]->image = pdf_load_image(ctx, doc, ref);
+                }
+                fz_always(ctx) {
+                    pdf_drop_obj(ctx, ref);
+                }
+                fz_catch(ctx) {
+                    chunk[i]->image = NULL;
+                }
+                if (chunk[i]->image) {
+                    chunk[batch_count++] = chunk[i];
+                }
+            }
+
+            run_workers(ctx, threads, batch_count, job_abort_flag(job), hash_pixels_job, chunk);
+            check_abort(ctx, job);
+
+            for (int i = 0; i < batch_count; i++) {
+                dedup_entry *e = chunk[i];
+                fz_drop_image(ctx, e->image);
+                e->image = NULL;
+                if (e->hashed) {
+                    rekey_with_pixels(ctx, doc, e);
+                    e->keyed = 1;
+                }
+            }
+            batch_count = 0;
+        }
+
+        qsort(entries, (size_t)count, sizeof(dedup_entry), compare_dedup_keys);
+        found = mark_duplicates(entries, count);
+    }
+    fz_always(ctx) {
+        if (batch) {
+            for (int i = 0; i < count; i++) {
+                fz_drop_image(ctx, entries[i].image);
+                entries[i].image = NULL;
+            }
+        }
+        fz_free(ctx, batch);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return found;
+}
+
+// Rewrite references to merged images, descending into direct containers
+static void redirect_references(fz_context *ctx, pdf_document *doc, pdf_obj *obj, const int *remap, int xref_len, int depth) {
+    if (depth > 32) return;
+
+    if (pdf_is_dict(ctx, obj)) {
+        int n = pdf_dict_len(ctx, obj);
+        for (int i = 0; i < n; i++) {
+            pdf_obj *val = pdf_dict_get_val(ctx, obj, i);
+            if (pdf_is_indirect(ctx, val)) {
+                int num = pdf_to_num(ctx, val);
+                if (num > 0 && num < xref_len && remap[num]) {
+                    pdf_dict_put_drop(ctx, obj, pdf_dict_get_key(ctx, obj, i), pdf_new_indirect(ctx, doc, remap[num], 0));
+                }
+            } else {
+                redirect_references(ctx, doc, val, remap, xref_len, depth + 1);
+            }
+        }
+    } else if (pdf_is_array(ctx, obj)) {
+        int n = pdf_array_len(ctx, obj);
+        for (int i = 0; i < n; i++) {
+            pdf_obj *val = pdf_array_get(ctx, obj, i);
+            if (pdf_is_indirect(ctx, val)) {
+                int num = pdf_to_num(ctx, val);
+                if (num > 0 && num < xref_len && remap[num]) {
+                    pdf_array_put_drop(ctx, obj, i, pdf_new_indirect(ctx, doc, remap[num], 0));
+                }
+            } else {
+                redirect_references(ctx, doc, val, remap, xref_len, depth + 1);
+            }
+        }
+    }
+}
+
+// Group identical images drawn on pages without touching the document. Returns
+// a map from each duplicate to its canonical object (0 for the rest), or NULL
+// when there are none. min_dpi is updated so each canonical image carries the
+// lowest DPI of its group and duplicates are no longer listed.
+static int* find_duplicate_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    float *min_dpi,
+    int *found_out,
+    mino_job *job
+) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    dedup_entry *entries = NULL;
+    int *remap = NULL;
+    int count = 0;
+    int found = 0;
+
+    fz_var(entries);
+    fz_var(remap);
+
+    fz_try(ctx) {
+        entries = fz_calloc(ctx, (size_t)xref_len, sizeof(dedup_entry));
+        for (int num = 1; num < xref_len; num++) {
+            if (min_dpi[num] > 0) {
+                entries[count++].num = num;
+            }
+        }
+
+        if (count > 1) {
+            for (int i = 0; i < count; i++) {
+                if (i % 64 == 0) check_abort(ctx, job);
+                hash_encoded_image(ctx, doc, &entries[i]);
+            }
+
+            qsort(entries, (size_t)count, sizeof(dedup_entry), compare_dedup_keys);
+            found = mark_duplicates(entries, count);
+            found += dedup_by_pixels(ctx, doc, entries, count, job);
+        }
+
+        if (found > 0) {
+            remap = fz_calloc(ctx, (size_t)xref_len, sizeof(int));
+            for (int i = 0; i < count; i++) {
+                remap[entries[i].num] = entries[i].canonical;
+            }
+
+            // A group merged by pixels may point at one merged by bytes
+            for (int num = 1; num < xref_len; num++) {
+                int target = remap[num];
+                if (!target) continue;
+                while (remap[target]) target = remap[target];
+                remap[num] = target;
+                if (min_dpi[num] < min_dpi[target]) {
+                    min_dpi[target] = min_dpi[num];
+                }
+                min_dpi[num] = 0;
+            }
+        }
+    }
+    fz_always(ctx) {
+        fz_free(ctx, entries);
+    }
+    fz_catch(ctx) {
+        fz_free(ctx, remap);
+        fz_rethrow(ctx);
+    }
+
+    *found_out = found;
+    return remap;
+}
+
+// Merge identical images drawn on pages, updating min_dpi as
+// find_duplicate_images does
+static void dedup_images(fz_context *ctx, pdf_document *doc, float *min_dpi, mino_job *job) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    int *remap = NULL;
+    pdf_obj *obj = NULL;
+    int found = 0;
+
+    fz_var(remap);
+    fz_var(obj);
+
+    int64_t start = now_ns();
+
+    fz_try(ctx) {
+        remap = find_duplicate_images(ctx, doc, min_dpi, &found, job);
+
+        if (remap) {
+            for (int num = 1; num < xref_len; num++) {
+                if (num % 1024 == 0) check_abort(ctx, job);
+                if (remap[num]) continue;
+
+                fz_try(ctx) {
+                    obj = pdf_load_object(ctx, doc, num);
+                }
+                fz_catch(ctx) {
+                    // Nothing can be referenced from an unreadable object
+                    continue;
+                }
+                redirect_references(ctx, doc, obj, remap, xref_len, 0);
+                pdf_drop_obj(ctx, obj);
+                obj = NULL;
+            }
+
+            for (int num = 1; num < xref_len; num++) {
+                if (remap[num]) pdf_delete_object(ctx, doc, num);
+            }
+
+            mino_job_stats *stats = job_stats(job);
+            if (stats) stats->images_deduplicated += found;
+        }
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) stats->images_ns += now_ns() - start;
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, obj);
+        fz_free(ctx, remap);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// MARK: - Image Cache
+//
+// Recompressed image streams persisted across runs. An entry is keyed by the
+// source image (dictionary and encoded stream), the JPEG quality, the output
+// size (which follows from the target DPI and where the image is drawn) and
+// the resampling method. Files are evicted least recently used first, by
+// modification time, which a hit refreshes.
+
+#define IMAGE_CACHE_MAGIC 0x3143494d    // "MIC1"
+#define IMAGE_CACHE_SUFFIX ".mic"
+#define IMAGE_CACHE_METHOD 3            // fz_scale_pixmap, then fz_new_buffer_from_pixmap_as_jpeg;
+                                        // 2 records the colorspace of decoded Indexed images,
+                                        // 3 keys on the renumbered mino_replace_policy
+
+struct mino_image_cache {
+    pthread_mutex_t mutex;      // Guards total_bytes and eviction
+    char *directory;
+    int64_t max_bytes;
+    int64_t total_bytes;
+};
+
+// File header; the JPEG stream follows. A zero width with no stream records
+// that the original was smaller than its recompression.
+typedef struct {
+    uint32_t magic;
+    int32_t width;
+    int32_t height;
+    int32_t colorspace;         // 0 unchanged, 1 converted to gray, 2 converted to RGB
+} image_cache_header;
+
+typedef struct {
+    char *path;
+    time_t mtime;
+    int64_t size;
+} image_cache_file;
+
+static int compare_cache_files(const void *a, const void *b) {
+    time_t x = ((const image_cache_file *)a)->mtime;
+    time_t y = ((const image_cache_file *)b)->mtime;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static int is_cache_file(const char *name) {
+    size_t length = strlen(name);
+    size_t suffix = sizeof(IMAGE_CACHE_SUFFIX) - 1;
+    return length > suffix && strcmp(name + length - suffix, IMAGE_CACHE_SUFFIX) == 0;
+}
+
+// List the entries on disk. Returns the number found; *files is malloc'd.
+static int list_cache_files(const mino_image_cache *cache, image_cache_file **files, int64_t *total) {
+    DIR *dir = opendir(cache->directory);
+    int count = 0, capacity = 0;
+    *files = NULL;
+    *total = 0;
+    if (!dir) return 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_cache_file(entry->d_name)) continue;
+
+        size_t length = strlen(cache->directory) + strlen(entry->d_name) + 2;
+        char *path = malloc(length);
+        if (!path) break;
+        snprintf(path, length, "%s/%s", cache->directory, entry->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+
+        if (count == capacity) {
+            int grown = capacity ? capacity * 2 : 64;
+            image_cache_file *resized = realloc(*files, (size_t)grown * sizeof(image_cache_file));
+            if (!resized) {
+                free(path);
+                break;
+            }
+            *files = resized;
+            capacity = grown;
+        }
+        (*files)[count++] = (image_cache_file){ path, st.st_mtime, (int64_t)st.st_size };
+        *total += (int64_t)st.st_size;
+    }
+
+    closedir(dir);
+    return count;
+}
+
+static void free_cache_files(image_cache_file *files, int count) {
+    for (int i = 0; i < count; i++) {
+        free(files[i].path);
+    }
+    free(files);
+}
+
+// Delete the oldest entries until the cache is under `limit` bytes.
+// Called with the mutex held.
+static void evict_cache_files(mino_image_cache *cache, int64_t limit) {
+    image_cache_file *files = NULL;
+    int64_t total = 0;
+    int count = list_cache_files(cache, &files, &total);
+
+    qsort(files, (size_t)count, sizeof(image_cache_file), compare_cache_files);
+    for (int i = 0; i < count && total > limit; i++) {
+        if (unlink(files[i].path) == 0) {
+            total -= files[i].size;
+        }
+    }
+
+    cache->total_bytes = total;
+    free_cache_files(files, count);
+}
+
+mino_image_cache* mino_image_cache_open(const char *directory, int64_t max_bytes) {
+    if (!directory || max_bytes <= 0) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        set_error("Failed to create image cache directory");
+        return NULL;
+    }
+
+    mino_image_cache *cache = calloc(1, sizeof(*cache));
+    if (!cache || !(cache->directory = strdup(directory))) {
+        free(cache);
+        set_error("Failed to allocate image cache");
+        return NULL;
+    }
+
+    pthread_mutex_init(&cache->mutex, NULL);
+    cache->max_bytes = max_bytes;
+
+    // Picks up what earlier runs left and trims it if the limit shrank
+    pthread_mutex_lock(&cache->mutex);
+    evict_cache_files(cache, max_bytes);
+    pthread_mutex_unlock(&cache->mutex);
+
+    return cache;
+}
+
+void mino_image_cache_close(mino_image_cache *cache) {
+    if (!cache) return;
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache->directory);
+    free(cache);
+}
+
+int64_t mino_image_cache_size(mino_image_cache *cache) {
+    if (!cache) return 0;
+    pthread_mutex_lock(&cache->mutex);
+    int64_t total = cache->total_bytes;
+    pthread_mutex_unlock(&cache->mutex);
+    return total;
+}
+
+void mino_image_cache_clear(mino_image_cache *cache) {
+    if (!cache) return;
+    pthread_mutex_lock(&cache->mutex);
+    evict_cache_files(cache, 0);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+// Key of a recompression: source image, quality, requested size, method and
+// replace policy, since a kept original is only valid under the policy that kept it
+static void image_cache_key(
+    const unsigned char source[16],
+    int jpeg_quality,
+    int out_w,
+    int out_h,
+    mino_replace_policy replace,
+    unsigned char key[16]
+) {
+    int32_t params[5] = { jpeg_quality, out_w, out_h, IMAGE_CACHE_METHOD, (int32_t)replace };
+    fz_md5 md5;
+
+    fz_md5_init(&md5);
+    fz_md5_update(&md5, source, 16);
+    fz_md5_update(&md5, (const unsigned char *)params, sizeof(params));
+    fz_md5_final(&md5, key);
+}
+
+static void image_cache_path(const mino_image_cache *cache, const unsigned char key[16], char path[PATH_MAX]) {
+    char hex[33];
+    for (int i = 0; i < 16; i++) {
+        snprintf(hex + i * 2, 3, "%02x", key[i]);
+    }
+    snprintf(path, PATH_MAX, "%s/%s" IMAGE_CACHE_SUFFIX, cache->directory, hex);
+}
+
+// Load a cached stream into the candidate. Returns 0 on a miss.
+static int image_cache_get(fz_context *ctx, mino_image_cache *cache, rewrite_candidate *c) {
+    char path[PATH_MAX];
+    fz_buffer *file = NULL;
+    int hit = 0;
+
+    image_cache_path(cache, c->cache_key, path);
+    if (access(path, R_OK) != 0) return 0;
+
+    fz_var(file);
+
+    fz_try(ctx) {
+        file = fz_read_file(ctx, path);
+        unsigned char *data = NULL;
+        size_t length = fz_buffer_storage(ctx, file, &data);
+
+        image_cache_header header;
+        if (length == sizeof(header)) {
+            memcpy(&header, data, sizeof(header));
+            if (header.magic == IMAGE_CACHE_MAGIC && header.width == 0) {
+                c->keep_original = 1;
+                hit = 1;
+            }
+        } else if (length > sizeof(header)) {
+            memcpy(&header, data, sizeof(header));
+            if (header.magic == IMAGE_CACHE_MAGIC && header.width > 0 && header.height > 0) {
+                c->encoded = fz_new_buffer_from_copied_data(ctx, data + sizeof(header), length - sizeof(header));
+                c->out_w = header.width;
+                c->out_h = header.height;
+                c->out_cs = header.colorspace == 1 ? fz_device_gray(ctx)
+                    : header.colorspace == 2 ? fz_device_rgb(ctx) : NULL;
+                hit = 1;
+            }
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_buffer(ctx, file);
+    }
+    fz_catch(ctx) {
+        hit = 0;
+    }
+
+    // Mark as recently used
+    if (hit) utimes(path, NULL);
+    return hit;
+}
+
+// Write an entry through a temporary file so readers never see partial ones
+static void image_cache_write(
+    mino_image_cache *cache,
+    const unsigned char key[16],
+    const image_cache_header *header,
+    const unsigned char *data,
+    size_t length
+) {
+    char path[PATH_MAX];
+    char temp[PATH_MAX + 32];
+    image_cache_path(cache, key, path);
+    snprintf(temp, sizeof(temp), "%s.%lx.tmp", path, (unsigned long)(uintptr_t)pthread_self());
+
+    FILE *file = fopen(temp, "wb");
+    if (!file) return;
+    int ok = fwrite(header, sizeof(*header), 1, file) == 1 &&
+        (length == 0 || fwrite(data, 1, length, file) == length);
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temp, path) != 0) {
+        unlink(temp);
+        return;
+    }
+
+    pthread_mutex_lock(&cache->mutex);
+    cache->total_bytes += (int64_t)(sizeof(*header) + length);
+    if (cache->total_bytes > cache->max_bytes) {
+        // Trim below the limit so eviction does not run on every insert
+        evict_cache_files(cache, cache->max_bytes - cache->max_bytes / 10);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+// Store the recompressed stream of a candidate, or the decision to keep the
+// original when kept is set
+static void image_cache_put(fz_context *ctx, mino_image_cache *cache, const rewrite_candidate *c, int kept) {
+    if (kept) {
+        image_cache_header header = { IMAGE_CACHE_MAGIC, 0, 0, 0 };
+        image_cache_write(cache, c->cache_key, &header, NULL, 0);
+        return;
+    }
+
+    unsigned char *data = NULL;
+    size_t length = fz_buffer_storage(ctx, c->encoded, &data);
+    image_cache_header header = {
+        IMAGE_CACHE_MAGIC, c->out_w, c->out_h,
+        !c->out_cs ? 0 : fz_colorspace_is_gray(ctx, c->out_cs) ? 1 : 2
+    };
+    image_cache_write(cache, c->cache_key, &header, data, length);
+}
+
+// Look up a candidate before its image is loaded. On a miss the key is kept
+// so the result can be stored.
+static int lookup_candidate(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts,
+    rewrite_candidate *c
+) {
+    pdf_obj *ref = pdf_new_indirect(ctx, doc, c->num, 0);
+    unsigned char source[16];
+    int hit = 0;
+
+    fz_try(ctx) {
+        int w = pdf_dict_get_int(ctx, ref, PDF_NAME(Width));
+        int h = pdf_dict_get_int(ctx, ref, PDF_NAME(Height));
+        int out_w, out_h;
+        rewrite_size(opts, w, h, c->min_dpi, &out_w, &out_h);
+        hash_image_object(ctx, doc, c->num, source);
+        image_cache_key(source, opts->jpeg_quality, out_w, out_h, opts->replace, c->cache_key);
+        hit = image_cache_get(ctx, opts->cache, c);
+        c->cache_miss = !hit;
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, ref);
+    }
+    fz_catch(ctx) {
+        c->cache_miss = 0;
+        hit = 0;
+    }
+
+    return hit;
+}
+
+// Stages 2 and 3 for images found by scan_images
+static void rewrite_scanned_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts,
+    const float *min_dpi,
+    mino_job *job
+) {
+    rewrite_candidate *candidates = NULL;
+    int count = 0;
+
+    fz_var(candidates);
+    fz_var(count);
+
+    mino_job_stats *stats = job_stats(job);
+    int64_t phase_start = now_ns();
+
+    fz_try(ctx) {
+        int xref_len = pdf_xref_len(ctx, doc);
+        candidates = fz_calloc(ctx, (size_t)xref_len, sizeof(rewrite_candidate));
+        for (int num = 1; num < xref_len; num++) {
+            if (min_dpi[num] > 0) {
+                candidates[count].num = num;
+                candidates[count].min_dpi = min_dpi[num];
+                count++;
+            }
+        }
+
+        // Work in chunks so only a few compressed images are held at once
+        int threads = opts->threads > 0 ? opts->threads : available_cores();
+        int chunk_size = threads * 4;
+
+        report_progress(job, MINO_PHASE_IMAGES, 0, count);
+
+        for (int first = 0; first < count; first += chunk_size) {
+            int chunk_count = count - first < chunk_size ? count - first : chunk_size;
+            rewrite_candidate *chunk = &candidates[first];
+
+            // Compact the chunk to the images that can be rewritten. Cache
+            // hits are kept without loading the image at all.
+            int loaded = 0;
+            for (int i = 0; i < chunk_count; i++) {
+                rewrite_candidate c = chunk[i];
+                if (opts->cache && lookup_candidate(ctx, doc, opts, &c)) {
+                    if (stats) stats->image_cache_hits++;
+                    if (c.keep_original) {
+                        if (stats) stats->images_kept++;
+                        continue;
+                    }
+                } else if (!load_candidate(ctx, doc, opts, &c)) {
+                    continue;
+                }
+                prepare_original(ctx, doc, opts, &c);
+                chunk[loaded++] = c;
+            }
+
+            // Stage 2
+            rewrite_batch batch = { opts, chunk };
+            run_workers(ctx, threads, loaded, job_abort_flag(job), rewrite_image_job, &batch);
+            check_abort(ctx, job);
+
+            // Stage 3
+            for (int i = 0; i < loaded; i++) {
+                rewrite_candidate *c = &chunk[i];
+                if (c->encoded) {
+                    int64_t new_length = (int64_t)fz_buffer_storage(ctx, c->encoded, NULL);
+                    int keep = opts->replace == MINO_REPLACE_IF_SMALLER && new_length >= c->original_size;
+
+                    if (c->cache_miss) {
+                        image_cache_put(ctx, opts->cache, c, keep);
+                    }
+                    if (keep) {
+                        if (stats) stats->images_kept++;
+                    } else {
+                        int64_t old_length = store_candidate(ctx, doc, c);
+                        if (stats) {
+                            stats->images_rewritten++;
+                            stats->image_bytes_in += old_length;
+                            stats->image_bytes_out += new_length;
+                        }
+                    }
+                }
+                release_candidate(ctx, c);
+            }
+
+            report_progress(job, MINO_PHASE_IMAGES, first + chunk_count, count);
+        }
+
+        if (stats) stats->images_ns += now_ns() - phase_start;
+    }
+    fz_always(ctx) {
+        if (candidates) {
+            for (int i = 0; i < count; i++) {
+                release_candidate(ctx, &candidates[i]);
+            }
+        }
+        fz_free(ctx, candidates);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Rewrite images, throwing on error or cancellation
+static void rewrite_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts,
+    mino_job *job
+) {
+    float *min_dpi = scan_images(ctx, doc, job);
+
+    fz_try(ctx) {
+        dedup_images(ctx, doc, min_dpi, job);
+        rewrite_scanned_images(ctx, doc, opts, min_dpi, job);
+    }
+    fz_always(ctx) {
+        fz_free(ctx, min_dpi);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Rewrite images with explicit options
+int mino_rewrite_images_with_options(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts
+) {
+    if (!ctx || !doc || !opts) {
+        set_error("Invalid context or document");
+        return -1;
+    }
+
+    mino_clear_error();
+
+    fz_try(ctx) {
+        rewrite_images(ctx, doc, opts, NULL);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Rewrite images in the PDF with compression settings
+int mino_rewrite_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    int jpeg_quality,
+    int target_dpi,
+    int dpi_threshold
+) {
+    mino_rewrite_options opts = {
+        .jpeg_quality = jpeg_quality,
+        .target_dpi = target_dpi,
+        .dpi_threshold = dpi_threshold,
+        .threads = 0,
+    };
+    return mino_rewrite_images_with_options(ctx, doc, &opts);
+}
+
+// MARK: - Document Analysis
+//
+// Inventory of what a document spends its bytes on. Images are listed one per
+// object from their dictionaries, without decoding; every other stream is
+// attributed to fonts, content, metadata or other by how it is referenced.
+
+enum {
+    STREAM_OTHER = 0,
+    STREAM_IMAGE,
+    STREAM_FONT,
+    STREAM_CONTENT,
+    STREAM_METADATA,
+};
+
+// Attribute a referenced stream unless it already has a kind
+static void mark_stream(fz_context *ctx, unsigned char *kinds, int xref_len, pdf_obj *ref, int kind) {
+    if (!pdf_is_indirect(ctx, ref)) return;
+    int num = pdf_to_num(ctx, ref);
+    if (num > 0 && num < xref_len && kinds[num] == STREAM_OTHER) {
+        kinds[num] = (unsigned char)kind;
+    }
+}
+
+// Whether the dictionary alone shows the image can be recompressed; mirrors
+// is_rewritable without loading the image
+static int dict_is_rewritable(fz_context *ctx, pdf_obj *dict) {
+    if (pdf_dict_get_bool(ctx, dict, PDF_NAME(ImageMask))) return 0;
+    if (pdf_is_array(ctx, pdf_dict_get(ctx, dict, PDF_NAME(Mask)))) return 0;
+    if (pdf_dict_get_int(ctx, dict, PDF_NAME(SMaskInData))) return 0;
+
+    // JPX carries its depth in the codestream
+    pdf_obj *bpc = pdf_dict_get(ctx, dict, PDF_NAME(BitsPerComponent));
+    return bpc ? pdf_to_int(ctx, bpc) >= 8 : 1;
+}
+
+// Append a NUL-terminated string to the pool, returning its offset
+static int pool_string(fz_context *ctx, fz_buffer *pool, const char *text) {
+    int offset = (int)fz_buffer_storage(ctx, pool, NULL);
+    fz_append_string(ctx, pool, text);
+    fz_append_byte(ctx, pool, 0);
+    return offset;
+}
+
+// Colorspace family name: the name itself, or the first element of an array
+static int pool_colorspace(fz_context *ctx, fz_buffer *pool, pdf_obj *dict) {
+    if (pdf_dict_get_bool(ctx, dict, PDF_NAME(ImageMask))) {
+        return pool_string(ctx, pool, "");
+    }
+    pdf_obj *cs = pdf_dict_get(ctx, dict, PDF_NAME(ColorSpace));
+    if (pdf_is_array(ctx, cs)) {
+        cs = pdf_array_get(ctx, cs, 0);
+    }
+    return pool_string(ctx, pool, pdf_is_name(ctx, cs) ? pdf_to_name(ctx, cs) : "");
+}
+
+// Filter chain in decode order, separated by spaces
+static int pool_filters(fz_context *ctx, fz_buffer *pool, pdf_obj *dict) {
+    int offset = (int)fz_buffer_storage(ctx, pool, NULL);
+    pdf_obj *filter = pdf_dict_get(ctx, dict, PDF_NAME(Filter));
+
+    if (pdf_is_name(ctx, filter)) {
+        fz_append_string(ctx, pool, pdf_to_name(ctx, filter));
+    } else if (pdf_is_array(ctx, filter)) {
+        int n = pdf_array_len(ctx, filter);
+        for (int i = 0; i < n; i++) {
+            if (i > 0) fz_append_byte(ctx, pool, ' ');
+            fz_append_string(ctx, pool, pdf_to_name(ctx, pdf_array_get(ctx, filter, i)));
+        }
+    }
+    fz_append_byte(ctx, pool, 0);
+    return offset;
+}
+
+static void alloc_image_columns(fz_context *ctx, mino_document_analysis *a, int count) {
+    a->object_num = fz_malloc_array(ctx, count, int);
+    a->width = fz_malloc_array(ctx, count, int);
+    a->height = fz_malloc_array(ctx, count, int);
+    a->bits_per_component = fz_malloc_array(ctx, count, int);
+    a->colorspace = fz_malloc_array(ctx, count, int);
+    a->filters = fz_malloc_array(ctx, count, int);
+    a->stream_bytes = fz_malloc_array(ctx, count, int64_t);
+    a->effective_dpi = fz_malloc_array(ctx, count, float);
+    a->use_count = fz_malloc_array(ctx, count, int);
+    a->rewritable = fz_malloc_array(ctx, count, unsigned char);
+}
+
+// Fill the image columns and stream totals; kinds and lengths are scratch
+// arrays indexed by object number
+static void analyze_objects(
+    fz_context *ctx,
+    pdf_document *doc,
+    const float *min_dpi,
+    const int *uses,
+    unsigned char *kinds,
+    int64_t *lengths,
+    mino_document_analysis *a,
+    mino_job *job
+) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    fz_buffer *pool = NULL;
+    pdf_obj *obj = NULL;
+    int count = 0;
+
+    fz_var(pool);
+    fz_var(obj);
+
+    fz_try(ctx) {
+        // Page content streams
+        for (int i = 0; i < a->page_count; i++) {
+            pdf_obj *contents = pdf_dict_get(ctx, pdf_lookup_page_obj(ctx, doc, i), PDF_NAME(Contents));
+            if (pdf_is_array(ctx, contents)) {
+                int n = pdf_array_len(ctx, contents);
+                for (int k = 0; k < n; k++) {
+                    mark_stream(ctx, kinds, xref_len, pdf_array_get(ctx, contents, k), STREAM_CONTENT);
+                }
+            } else {
+                mark_stream(ctx, kinds, xref_len, contents, STREAM_CONTENT);
+            }
+        }
+
+        // Classify the remaining objects by what they are or what they point to
+        for (int num = 1; num < xref_len; num++) {
+            if (num % 1024 == 0) {
+                check_abort(ctx, job);
+            }
+
+            fz_try(ctx) {
+                obj = pdf_load_object(ctx, doc, num);
+            }
+            fz_catch(ctx) {
+                fz_warn(ctx, "skipping unreadable object %d", num);
+                continue;
+            }
+
+            pdf_obj *type = pdf_dict_get(ctx, obj, PDF_NAME(Type));
+            pdf_obj *subtype = pdf_dict_get(ctx, obj, PDF_NAME(Subtype));
+
+            if (pdf_obj_num_is_stream(ctx, doc, num)) {
+                lengths[num] = pdf_dict_get_int64(ctx, obj, PDF_NAME(Length));
+                if (pdf_name_eq(ctx, subtype, PDF_NAME(Image))) {
+                    kinds[num] = STREAM_IMAGE;
+                    count++;
+                } else if (pdf_name_eq(ctx, subtype, PDF_NAME(Form))) {
+                    kinds[num] = STREAM_CONTENT;
+                } else if (pdf_name_eq(ctx, type, PDF_NAME(Metadata))) {
+                    kinds[num] = STREAM_METADATA;
+                }
+            } else if (pdf_name_eq(ctx, type, PDF_NAME(Font))) {
+                a->font_count++;
+            } else if (pdf_name_eq(ctx, type, PDF_NAME(FontDescriptor))) {
+                mark_stream(ctx, kinds, xref_len, pdf_dict_get(ctx, obj, PDF_NAME(FontFile)), STREAM_FONT);
+                mark_stream(ctx, kinds, xref_len, pdf_dict_get(ctx, obj, PDF_NAME(FontFile2)), STREAM_FONT);
+                mark_stream(ctx, kinds, xref_len, pdf_dict_get(ctx, obj, PDF_NAME(FontFile3)), STREAM_FONT);
+            }
+
+            pdf_drop_obj(ctx, obj);
+            obj = NULL;
+        }
+
+        alloc_image_columns(ctx, a, count > 0 ? count : 1);
+        pool = fz_new_buffer(ctx, 256);
+
+        for (int num = 1; num < xref_len; num++) {
+            switch (kinds[num]) {
+            case STREAM_IMAGE:
+                a->image_bytes += lengths[num];
+                break;
+            case STREAM_FONT:
+                a->font_file_count++;
+                a->font_bytes += lengths[num];
+                continue;
+            case STREAM_CONTENT:
+                a->content_stream_count++;
+                a->content_bytes += lengths[num];
+                continue;
+            case STREAM_METADATA:
+                a->metadata_bytes += lengths[num];
+                continue;
+            default:
+                a->other_stream_bytes += lengths[num];
+                continue;
+            }
+
+            int i = a->image_count;
+            obj = pdf_load_object(ctx, doc, num);
+
+            pdf_obj *bpc = pdf_dict_get(ctx, obj, PDF_NAME(BitsPerComponent));
+            a->object_num[i] = num;
+            a->width[i] = pdf_dict_get_int(ctx, obj, PDF_NAME(Width));
+            a->height[i] = pdf_dict_get_int(ctx, obj, PDF_NAME(Height));
+            a->bits_per_component[i] = pdf_dict_get_bool(ctx, obj, PDF_NAME(ImageMask)) ? 1 : pdf_to_int(ctx, bpc);
+            a->colorspace[i] = pool_colorspace(ctx, pool, obj);
+            a->filters[i] = pool_filters(ctx, pool, obj);
+            a->stream_bytes[i] = lengths[num];
+            a->effective_dpi[i] = min_dpi[num];
+            a->use_count[i] = uses[num];
+            a->rewritable[i] = (unsigned char)dict_is_rewritable(ctx, obj);
+            a->image_count++;
+
+            if (a->rewritable[i] && min_dpi[num] > 0) {
+                a->rewritable_image_bytes += lengths[num];
+            }
+
+            pdf_drop_obj(ctx, obj);
+            obj = NULL;
+        }
+
+        a->strings_length = (int)fz_buffer_extract(ctx, pool, (unsigned char **)&a->strings);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, obj);
+        fz_drop_buffer(ctx, pool);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+int mino_analyze_document(
+    fz_context *ctx,
+    pdf_document *doc,
+    mino_document_analysis *analysis,
+    mino_job *job
+) {
+    if (!ctx || !doc || !analysis) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
+    }
+
+    mino_clear_error();
+    memset(analysis, 0, sizeof(*analysis));
+
+    float *min_dpi = NULL;
+    int *uses = NULL;
+    unsigned char *kinds = NULL;
+    int64_t *lengths = NULL;
+    stats_mark mark;
+
+    fz_var(min_dpi);
+    fz_var(uses);
+    fz_var(kinds);
+    fz_var(lengths);
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        int xref_len = pdf_xref_len(ctx, doc);
+        analysis->page_count = pdf_count_pages(ctx, doc);
+        analysis->file_bytes = doc->file_size;
+
+        int64_t scan_start = now_ns();
+        uses = fz_calloc(ctx, (size_t)xref_len, sizeof(int));
+        min_dpi = find_image_dpis(ctx, doc, uses, job);
+        mino_job_stats *stats = job_stats(job);
+        if (stats) stats->scan_ns += now_ns() - scan_start;
+
+        kinds = fz_calloc(ctx, (size_t)xref_len, 1);
+        lengths = fz_calloc(ctx, (size_t)xref_len, sizeof(int64_t));
+        analyze_objects(ctx, doc, min_dpi, uses, kinds, lengths, analysis, job);
+    }
+    fz_always(ctx) {
+        fz_free(ctx, lengths);
+        fz_free(ctx, kinds);
+        fz_free(ctx, uses);
+        fz_free(ctx, min_dpi);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        mino_drop_document_analysis(ctx, analysis);
+        return caught_status(ctx, job);
+    }
+
+    return MINO_STATUS_OK;
+}
+
+void mino_drop_document_analysis(fz_context *ctx, mino_document_analysis *analysis) {
+    if (!ctx || !analysis) return;
+
+    fz_free(ctx, analysis->object_num);
+    fz_free(ctx, analysis->width);
+    fz_free(ctx, analysis->height);
+    fz_free(ctx, analysis->bits_per_component);
+    fz_free(ctx, analysis->colorspace);
+    fz_free(ctx, analysis->filters);
+    fz_free(ctx, analysis->stream_bytes);
+    fz_free(ctx, analysis->effective_dpi);
+    fz_free(ctx, analysis->use_count);
+    fz_free(ctx, analysis->rewritable);
+    fz_free(ctx, analysis->strings);
+    memset(analysis, 0, sizeof(*analysis));
+}
+
+// Write options used for compressed output
+static pdf_write_options compress_write_options(int garbage_level) {
+    // Set up write options from the default constant
+    pdf_write_options opts = pdf_default_write_options;
+
+    opts.do_garbage = garbage_level;        // 0-4, 4 is maximum
+    opts.do_compress = 1;                   // Compress streams
+    opts.do_compress_images = 1;            // Compress images
+    opts.do_compress_fonts = 1;             // Compress fonts
+    opts.do_clean = 1;                      // Clean content streams
+    opts.do_sanitize = 1;                   // Sanitize content
+    opts.do_linear = 0;                     // Don't linearize (faster)
+    opts.do_appearance = 0;                 // Don't regenerate appearances
+
+    return opts;
+}
+
+// Rewrite images ahead of saving. Image failures are not fatal (the document
+// is still written with its original images) but cancellation is.
+static void compress_images(
+    fz_context *ctx,
+    pdf_document *doc,
+    int jpeg_quality,
+    int target_dpi,
+    mino_job *job
+) {
+    mino_rewrite_options ropts = {
+        .jpeg_quality = jpeg_quality,
+        .target_dpi = target_dpi,
+        .dpi_threshold = target_dpi + 50, // Allow some headroom
+        .threads = job_threads(job),
+        .cache = job ? job->image_cache : NULL,
+        .replace = job ? job->image_replace : MINO_REPLACE_ALWAYS,
+    };
+
+    fz_try(ctx) {
+        rewrite_images(ctx, doc, &ropts, job);
+    }
+    fz_catch(ctx) {
+        if (fz_caught(ctx) == FZ_ERROR_ABORT) {
+            fz_rethrow(ctx);
+        }
+        fz_warn(ctx, "image rewrite failed: %s", fz_caught_message(ctx));
+    }
+}
+
+// Compress and save PDF
+int mino_compress_pdf(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level
+) {
+    return mino_compress_pdf_job(
+        ctx, doc, output_path, jpeg_quality, target_dpi, garbage_level, NULL
+    );
+}
+
+// Compress and save PDF with progress reporting and cancellation
+int mino_compress_pdf_job(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    mino_job *job
+) {
+    if (!ctx || !doc || !output_path) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
+    }
+
+    mino_clear_error();
+
+    stats_mark mark;
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        // Rewrite images first
+        compress_images(ctx, doc, jpeg_quality, target_dpi, job);
+
+        pdf_write_options opts = compress_write_options(garbage_level);
+
+        // Save the document
+        save_pdf(ctx, doc, output_path, &opts, job);
+    }
+    fz_always(ctx) {
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        return caught_status(ctx, job);
+    }
+
+    return MINO_STATUS_OK;
+}
+
+// Compress into memory. On success *data holds the output, owned by the
+// caller and freed with mino_free_buffer_data.
+int mino_compress_pdf_to_buffer(
+    fz_context *ctx,
+    pdf_document *doc,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    unsigned char **data,
+    size_t *length,
+    mino_job *job
+) {
+    if (!ctx || !doc || !data || !length) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
+    }
+
+    *data = NULL;
+    *length = 0;
+    mino_clear_error();
+
+    fz_buffer *buf = NULL;
+    fz_output *out = NULL;
+    stats_mark mark;
+
+    fz_var(buf);
+    fz_var(out);
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        compress_images(ctx, doc, jpeg_quality, target_dpi, job);
+
+        pdf_write_options opts = compress_write_options(garbage_level);
+
+        buf = fz_new_buffer(ctx, 64 * 1024);
+        out = fz_new_output_with_buffer(ctx, buf);
+        write_pdf(ctx, doc, out, &opts, job);
+        fz_close_output(ctx, out);
+
+        // Hand the storage to the caller without copying
+        *length = fz_buffer_extract(ctx, buf, data);
+    }
+    fz_always(ctx) {
+        fz_drop_output(ctx, out);
+        fz_drop_buffer(ctx, buf);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        return caught_status(ctx, job);
+    }
+
+    return MINO_STATUS_OK;
+}
+
+// Free data returned by mino_compress_pdf_to_buffer
+void mino_free_buffer_data(fz_context *ctx, unsigned char *data) {
+    if (ctx && data) {
+        fz_free(ctx, data);
+    }
+}
+
+// MARK: - Size Estimation
+//
+// The output is modelled as the bytes image rewriting leaves alone plus the
+// re-encoded size of every rewritable image. The former is measured from the
+// objects that survive garbage collection; for the latter a stratified sample
+// of the images is decoded once, each probe of a quality/DPI setting only
+// rescales and encodes the cached pixmaps, and the bytes per output sample
+// they produce are extrapolated to the images outside the sample.
+
+#define SIZE_SAMPLE_MAX 16
+
+// Settings tried, from best quality to smallest output (includes the presets)
+static const struct {
+    int jpeg_quality;
+    int target_dpi;
+} size_ladder[] = {
+    { 85, 200 }, { 75, 150 }, { 70, 150 }, { 60, 125 }, { 50, 100 },
+    { 45, 100 }, { 40, 85 }, { 30, 72 }, { 25, 60 }, { 20, 50 },
+};
+
+#define SIZE_LADDER_COUNT ((int)(sizeof(size_ladder) / sizeof(size_ladder[0])))
+
+// A rewritable image
+typedef struct {
+    int num;
+    float min_dpi;
+    int w, h;
+    int components;             // After conversion for JPEG: 1 or 3
+    int64_t length;             // Current stream length
+    int sampled;
+} model_image;
+
+// A sampled image, decoded once and re-encoded by every probe
+typedef struct {
+    const model_image *source;
+    fz_image *image;            // Loaded on the owning thread
+    fz_pixmap *pix;             // Decoded by a worker; NULL if that failed
+    int out_w, out_h;           // Size for the current probe
+    size_t encoded;             // Bytes produced by the current probe
+} size_sample;
+
+typedef struct {
+    model_image *images;
+    int count;
+    size_sample samples[SIZE_SAMPLE_MAX];
+    int sample_count;
+    int64_t fixed_bytes;        // Output bytes not attributed to rewritable images
+    int decode_dpi;             // Highest target DPI any probe will ask for
+    int jpeg_quality;           // Quality of the current probe
+} size_model;
+
+// Per-object framing in the output: "n 0 obj", "endobj" and an xref entry
+#define OBJECT_OVERHEAD 40
+#define STREAM_OVERHEAD 18
+
+static void count_output_write(fz_context *ctx, void *state, const void *data, size_t n) {
+    *(int64_t *)state += (int64_t)n;
+}
+
+// Queue the objects referenced from obj, descending into direct containers
+static void push_references(
+    fz_context *ctx,
+    pdf_obj *obj,
+    unsigned char *seen,
+    int *stack,
+    int *top,
+    int xref_len,
+    int depth
+) {
+    if (pdf_is_indirect(ctx, obj)) {
+        int num = pdf_to_num(ctx, obj);
+        if (num > 0 && num < xref_len && !seen[num]) {
+            seen[num] = 1;
+            stack[(*top)++] = num;
+        }
+    } else if (depth < 32 && pdf_is_dict(ctx, obj)) {
+        int n = pdf_dict_len(ctx, obj);
+        for (int i = 0; i < n; i++) {
+            push_references(ctx, pdf_dict_get_val(ctx, obj, i), seen, stack, top, xref_len, depth + 1);
+        }
+    } else if (depth < 32 && pdf_is_array(ctx, obj)) {
+        int n = pdf_array_len(ctx, obj);
+        for (int i = 0; i < n; i++) {
+            push_references(ctx, pdf_array_get(ctx, obj, i), seen, stack, top, xref_len, depth + 1);
+        }
+    }
+}
+
+#define REACHABLE_DROPPED 2
+
+// Approximate output size of every object reachable from the trailer (what
+// garbage collection keeps), leaving out the objects flagged in `skip`.
+// Objects under a skipped one are still visited, so soft masks count, unless
+// it is flagged REACHABLE_DROPPED: nothing will reference it any more.
+static int64_t reachable_bytes(
+    fz_context *ctx,
+    pdf_document *doc,
+    const unsigned char *skip,
+    mino_job *job
+) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    unsigned char *seen = NULL;
+    int *stack = NULL;
+    fz_output *counter = NULL;
+    pdf_obj *obj = NULL;
+    int64_t dict_bytes = 0;
+    int64_t total = 0;
+    int top = 0;
+
+    fz_var(seen);
+    fz_var(stack);
+    fz_var(counter);
+    fz_var(obj);
+    fz_var(total);
+
+    fz_try(ctx) {
+        seen = fz_calloc(ctx, (size_t)xref_len, 1);
+        stack = fz_malloc_array(ctx, xref_len, int);
+        counter = fz_new_output(ctx, 256, &dict_bytes, count_output_write, NULL, NULL);
+
+        push_references(ctx, pdf_trailer(ctx, doc), seen, stack, &top, xref_len, 0);
+
+        for (int visited = 0; top > 0; visited++) {
+            if (visited % 1024 == 0) {
+                check_abort(ctx, job);
+            }
+
+            int num = stack[--top];
+            if (skip[num] == REACHABLE_DROPPED) continue;
+            obj = pdf_load_object(ctx, doc, num);
+
+            if (!skip[num]) {
+                pdf_print_obj(ctx, counter, obj, 1, 0);
+                total += OBJECT_OVERHEAD;
+                if (pdf_obj_num_is_stream(ctx, doc, num)) {
+                    total += STREAM_OVERHEAD + written_stream_size(ctx, doc, obj, num);
+                }
+            }
+
+            push_references(ctx, obj, seen, stack, &top, xref_len, 0);
+            pdf_drop_obj(ctx, obj);
+            obj = NULL;
+        }
+
+        fz_close_output(ctx, counter);
+        total += dict_bytes;
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, obj);
+        fz_drop_output(ctx, counter);
+        fz_free(ctx, stack);
+        fz_free(ctx, seen);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return total;
+}
+
+static mino_rewrite_options ladder_options(int rung) {
+    mino_rewrite_options opts = {
+        .jpeg_quality = size_ladder[rung].jpeg_quality,
+        .target_dpi = size_ladder[rung].target_dpi,
+        .dpi_threshold = size_ladder[rung].target_dpi + 50,
+        .threads = 0,
+    };
+    return opts;
+}
+
+static int compare_model_images(const void *a, const void *b) {
+    int64_t x = ((const model_image *)a)->length;
+    int64_t y = ((const model_image *)b)->length;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Decode a sample, keeping only the resolution the sharpest probe needs
+static void decode_sample_job(fz_context *ctx, void *arg, int job) {
+    size_model *model = arg;
+    size_sample *s = &model->samples[job];
+    fz_colorspace *converted = NULL;
+    fz_pixmap *tmp = NULL;
+
+    fz_var(tmp);
+
+    fz_try(ctx) {
+        s->pix = decode_for_jpeg(ctx, s->image, &converted);
+
+        mino_rewrite_options best = {
+            .target_dpi = model->decode_dpi,
+            .dpi_threshold = model->decode_dpi + 50,
+        };
+        int w, h;
+        rewrite_size(&best, s->source->w, s->source->h, s->source->min_dpi, &w, &h);
+        if (w != s->pix->w || h != s->pix->h) {
+            tmp = fz_scale_pixmap(ctx, s->pix, 0, 0, (float)w, (float)h, NULL);
+            if (tmp) {
+                fz_drop_pixmap(ctx, s->pix);
+                s->pix = tmp;
+                tmp = NULL;
+            }
+        }
+    }
+    fz_catch(ctx) {
+        fz_warn(ctx, "cannot sample image %d: %s", s->source->num, fz_caught_message(ctx));
+        fz_drop_pixmap(ctx, tmp);
+        fz_drop_pixmap(ctx, s->pix);
+        s->pix = NULL;
+    }
+}
+
+// Encode a decoded sample at the current probe's size and quality
+static void probe_sample_job(fz_context *ctx, void *arg, int job) {
+    size_model *model = arg;
+    size_sample *s = &model->samples[job];
+    fz_pixmap *scaled = NULL;
+    fz_buffer *buf = NULL;
+
+    fz_var(scaled);
+    fz_var(buf);
+
+    s->encoded = 0;
+    if (!s->pix) return;
+
+    fz_try(ctx) {
+        fz_pixmap *pix = s->pix;
+        if (s->out_w != pix->w || s->out_h != pix->h) {
+            scaled = fz_scale_pixmap(ctx, pix, 0, 0, (float)s->out_w, (float)s->out_h, NULL);
+            if (scaled) pix = scaled;
+        }
+        buf = fz_new_buffer_from_pixmap_as_jpeg(
+            ctx, pix, fz_default_color_params, model->jpeg_quality, 0
+        );
+        s->encoded = fz_buffer_storage(ctx, buf, NULL);
+    }
+    fz_always(ctx) {
+        fz_drop_buffer(ctx, buf);
+        fz_drop_pixmap(ctx, scaled);
+    }
+    fz_catch(ctx) {
+        s->encoded = 0;
+    }
+}
+
+static void drop_size_model(fz_context *ctx, size_model *model) {
+    for (int i = 0; i < model->sample_count; i++) {
+        fz_drop_pixmap(ctx, model->samples[i].pix);
+        fz_drop_image(ctx, model->samples[i].image);
+    }
+    model->sample_count = 0;
+    fz_free(ctx, model->images);
+    model->images = NULL;
+    model->count = 0;
+}
+
+// Inventory the rewritable images among those found by scan_images, then
+// load and decode the sample at decode_dpi. duplicates maps images that
+// deduplication would merge away (from find_duplicate_images), or is NULL.
+static void build_size_model(
+    fz_context *ctx,
+    pdf_document *doc,
+    const float *min_dpi,
+    const int *duplicates,
+    int decode_dpi,
+    size_model *model,
+    mino_job *job
+) {
+    int xref_len = pdf_xref_len(ctx, doc);
+    unsigned char *rewritable = NULL;
+
+    fz_var(rewritable);
+
+    model->images = fz_calloc(ctx, (size_t)xref_len, sizeof(model_image));
+    model->decode_dpi = decode_dpi;
+
+    for (int num = 1; num < xref_len; num++) {
+        if (min_dpi[num] <= 0) continue;
+
+        pdf_obj *ref = pdf_new_indirect(ctx, doc, num, 0);
+        fz_image *image = NULL;
+
+        fz_var(image);
+
+        fz_try(ctx) {
+            image = pdf_load_image(ctx, doc, ref);
+            if (is_rewritable(ctx, ref, image)) {
+                model_image *m = &model->images[model->count++];
+                m->num = num;
+                m->min_dpi = min_dpi[num];
+                m->w = image->w;
+                m->h = image->h;
+                m->components = image->n == 1 ? 1 : 3;
+                m->length = pdf_dict_get_int64(ctx, ref, PDF_NAME(Length));
+            }
+        }
+        fz_always(ctx) {
+            fz_drop_image(ctx, image);
+            pdf_drop_obj(ctx, ref);
+        }
+        fz_catch(ctx) {
+            // The real pass skips it as well
+            fz_warn(ctx, "skipping unreadable image %d", num);
+        }
+    }
+
+    // Everything else is written much as it is now
+    fz_try(ctx) {
+        rewritable = fz_calloc(ctx, (size_t)xref_len, 1);
+        for (int i = 0; i < model->count; i++) {
+            rewritable[model->images[i].num] = 1;
+        }
+        for (int num = 1; duplicates && num < xref_len; num++) {
+            if (duplicates[num]) rewritable[num] = REACHABLE_DROPPED;
+        }
+        model->fixed_bytes = reachable_bytes(ctx, doc, rewritable, job);
+    }
+    fz_always(ctx) {
+        fz_free(ctx, rewritable);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    // Evenly spaced through the images ordered by size, so the largest is
+    // always sampled and small images are still represented
+    qsort(model->images, (size_t)model->count, sizeof(model_image), compare_model_images);
+    int wanted = model->count < SIZE_SAMPLE_MAX ? model->count : SIZE_SAMPLE_MAX;
+    for (int i = 0; i < wanted; i++) {
+        model_image *m = &model->images[(int)((int64_t)i * model->count / wanted)];
+        pdf_obj *ref = pdf_new_indirect(ctx, doc, m->num, 0);
+
+        fz_try(ctx) {
+            size_sample *s = &model->samples[model->sample_count];
+            s->image = pdf_load_image(ctx, doc, ref);
+            s->source = m;
+            m->sampled = 1;
+            model->sample_count++;
+        }
+        fz_always(ctx) {
+            pdf_drop_obj(ctx, ref);
+        }
+        fz_catch(ctx) {
+            fz_warn(ctx, "skipping unreadable image %d", m->num);
+        }
+    }
+
+    run_workers(ctx, job_threads(job), model->sample_count, job_abort_flag(job), decode_sample_job, model);
+    check_abort(ctx, job);
+}
+
+// Predicted output size for one setting. *error_bytes receives the half-width
+// of an approximate 95% interval: the sampling error of the extrapolated
+// images plus a margin on the bytes that are not images.
+static int64_t probe_size(
+    fz_context *ctx,
+    size_model *model,
+    const mino_rewrite_options *opts,
+    int64_t *error_bytes,
+    mino_job *job
+) {
+    model->jpeg_quality = opts->jpeg_quality;
+
+    for (int i = 0; i < model->sample_count; i++) {
+        size_sample *s = &model->samples[i];
+        rewrite_size(opts, s->source->w, s->source->h, s->source->min_dpi, &s->out_w, &s->out_h);
+    }
+    run_workers(ctx, job_threads(job), model->sample_count, job_abort_flag(job), probe_sample_job, model);
+    check_abort(ctx, job);
+
+    int64_t total = model->fixed_bytes;
+    double sample_bytes = 0;
+    double sample_units = 0;
+    int encoded = 0;
+
+    for (int i = 0; i < model->sample_count; i++) {
+        size_sample *s = &model->samples[i];
+        if (s->encoded > 0) {
+            // Rewriting keeps whichever stream is smaller
+            total += (int64_t)s->encoded < s->source->length ? (int64_t)s->encoded : s->source->length;
+            sample_bytes += (double)s->encoded;
+            sample_units += (double)s->out_w * s->out_h * s->source->components;
+            encoded++;
+        } else {
+            total += s->source->length;
+        }
+    }
+
+    // Bytes per output sample (pixel times component) seen in the sample
+    double rate = sample_units > 0 ? sample_bytes / sample_units : 0;
+    double rest_units = 0;
+
+    for (int i = 0; i < model->count; i++) {
+        const model_image *m = &model->images[i];
+        if (m->sampled) continue;
+
+        if (rate > 0) {
+            int w, h;
+            rewrite_size(opts, m->w, m->h, m->min_dpi, &w, &h);
+            double units = (double)w * h * m->components;
+            int64_t predicted = (int64_t)(rate * units);
+            total += predicted < m->length ? predicted : m->length;
+            rest_units += units;
+        } else {
+            total += m->length;
+        }
+    }
+
+    // Standard error of the ratio estimator, with finite population correction
+    double error = 0;
+    if (rest_units > 0 && encoded >= 2) {
+        double mean_units = sample_units / encoded;
+        double variance = 0;
+        for (int i = 0; i < model->sample_count; i++) {
+            size_sample *s = &model->samples[i];
+            if (s->encoded == 0) continue;
+            double units = (double)s->out_w * s->out_h * s->source->components;
+            double residual = (double)s->encoded - rate * units;
+            variance += residual * residual;
+        }
+        variance /= encoded - 1;
+        double fpc = 1.0 - (double)encoded / model->count;
+        double rate_error = sqrt(variance / encoded * (fpc > 0 ? fpc : 0)) / mean_units;
+        error = 2.0 * rate_error * rest_units;
+    } else if (rest_units > 0) {
+        // One usable sample says little about the rest
+        error = 0.5 * rate * rest_units;
+    }
+    error += 0.05 * (double)model->fixed_bytes;
+
+    if (error_bytes) *error_bytes = (int64_t)error;
+    return total;
+}
+
+// Pick the highest rung predicted to fit. Sizes fall down the ladder, so
+// this is a binary search over it.
+static int search_ladder(
+    fz_context *ctx,
+    size_model *model,
+    int64_t target_bytes,
+    mino_size_result *result,
+    mino_job *job
+) {
+    int64_t predicted[SIZE_LADDER_COUNT];
+    int last = SIZE_LADDER_COUNT - 1;
+
+    if (model->count == 0) {
+        result->predicted_bytes = model->fixed_bytes;
+        return 0;
+    }
+
+    mino_rewrite_options opts = ladder_options(0);
+    predicted[0] = probe_size(ctx, model, &opts, NULL, job);
+    result->probes++;
+    if (predicted[0] <= target_bytes) {
+        result->predicted_bytes = predicted[0];
+        return 0;
+    }
+
+    opts = ladder_options(last);
+    predicted[last] = probe_size(ctx, model, &opts, NULL, job);
+    result->probes++;
+    if (predicted[last] > target_bytes) {
+        // Nothing fits; get as close as possible
+        result->predicted_bytes = predicted[last];
+        return last;
+    }
+
+    // predicted[lo] > target >= predicted[hi]
+    int lo = 0;
+    int hi = last;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        opts = ladder_options(mid);
+        predicted[mid] = probe_size(ctx, model, &opts, NULL, job);
+        result->probes++;
+        if (predicted[mid] <= target_bytes) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+
+    result->predicted_bytes = predicted[hi];
+    return hi;
+}
+
+// Predict the output size of each setting without writing anything
+int mino_estimate_compression(
+    fz_context *ctx,
+    pdf_document *doc,
+    mino_size_estimate *estimates,
+    int count,
+    mino_job *job
+) {
+    if (!ctx || !doc || !estimates || count <= 0) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
+    }
+
+    mino_clear_error();
+
+    float *min_dpi = NULL;
+    int *duplicates = NULL;
+    size_model model;
+    stats_mark mark;
+
+    memset(&model, 0, sizeof(model));
+
+    fz_var(min_dpi);
+    fz_var(duplicates);
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        min_dpi = scan_images(ctx, doc, job);
+
+        // Merge duplicates as the real pass would, without editing the document
+        int found = 0;
+        duplicates = find_duplicate_images(ctx, doc, min_dpi, &found, job);
+
+        int decode_dpi = 0;
+        for (int i = 0; i < count; i++) {
+            if (estimates[i].target_dpi > decode_dpi) decode_dpi = estimates[i].target_dpi;
+        }
+
+        int64_t estimate_start = now_ns();
+        build_size_model(ctx, doc, min_dpi, duplicates, decode_dpi, &model, job);
+
+        for (int i = 0; i < count; i++) {
+            mino_size_estimate *e = &estimates[i];
+            mino_rewrite_options opts = {
+                .jpeg_quality = e->jpeg_quality,
+                .target_dpi = e->target_dpi,
+                .dpi_threshold = e->target_dpi + 50,
+                .threads = 0,
+            };
+            e->predicted_bytes = probe_size(ctx, &model, &opts, &e->error_bytes, job);
+        }
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) stats->estimate_ns += now_ns() - estimate_start;
+    }
+    fz_always(ctx) {
+        drop_size_model(ctx, &model);
+        fz_free(ctx, duplicates);
+        fz_free(ctx, min_dpi);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        return caught_status(ctx, job);
+    }
+
+    return MINO_STATUS_OK;
+}
+
+// Compress to fit target_bytes, choosing JPEG quality and DPI by sampling
+int mino_compress_pdf_to_size(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int64_t target_bytes,
+    int garbage_level,
+    mino_size_result *result,
+    mino_job *job
+) {
+    if (!ctx || !doc || !output_path || !result || target_bytes <= 0) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->target_bytes = target_bytes;
+    mino_clear_error();
+
+    float *min_dpi = NULL;
+    size_model model;
+    stats_mark mark;
+
+    memset(&model, 0, sizeof(model));
+
+    fz_var(min_dpi);
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        min_dpi = scan_images(ctx, doc, job);
+        dedup_images(ctx, doc, min_dpi, job);
+
+        int64_t estimate_start = now_ns();
+        build_size_model(ctx, doc, min_dpi, NULL, size_ladder[0].target_dpi, &model, job);
+        int rung = search_ladder(ctx, &model, target_bytes, result, job);
+        result->sampled_images = model.sample_count;
+        drop_size_model(ctx, &model);
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) stats->estimate_ns += now_ns() - estimate_start;
+
+        // The single real pass, reusing the page scan
+        mino_rewrite_options ropts = ladder_options(rung);
+        ropts.cache = job ? job->image_cache : NULL;
+        ropts.threads = job_threads(job);
+        ropts.replace = job ? job->image_replace : MINO_REPLACE_ALWAYS;
+        result->jpeg_quality = ropts.jpeg_quality;
+        result->target_dpi = ropts.target_dpi;
+
+        fz_try(ctx) {
+            rewrite_scanned_images(ctx, doc, &ropts, min_dpi, job);
+        }
+        fz_catch(ctx) {
+            if (fz_caught(ctx) == FZ_ERROR_ABORT) {
+                fz_rethrow(ctx);
+            }
+            fz_warn(ctx, "image rewrite failed: %s", fz_caught_message(ctx));
+        }
+
+        pdf_write_options opts = compress_write_options(garbage_level);
+        save_pdf(ctx, doc, output_path, &opts, job);
+
+        result->actual_bytes = mino_get_file_size(output_path);
+        result->target_met = result->actual_bytes >= 0 && result->actual_bytes <= target_bytes;
+    }
+    fz_always(ctx) {
+        drop_size_model(ctx, &model);
+        fz_free(ctx, min_dpi);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        return caught_status(ctx, job);
+    }
+
+    return MINO_STATUS_OK;
+}
+
+// Get file size
+int64_t mino_get_file_size(const char *path) {
+    if (!path) return -1;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    int64_t size = ftell(f);
+    fclose(f);
+
+    return size;
+}
+
+// Render a page to pixmap
+fz_pixmap* mino_render_page(
+    fz_context *ctx,
+    fz_document *doc,
+    int page_number,
+    float zoom
+) {
+    return mino_render_page_job(ctx, doc, page_number, zoom, NULL);
+}
+
+// Render a page to pixmap with cancellation
+fz_pixmap* mino_render_page_job(
+    fz_context *ctx,
+    fz_document *doc,
+    int page_number,
+    float zoom,
+    mino_job *job
+) {
+    if (!ctx || !doc) {
+        set_error("Invalid context or document");
+        return NULL;
+    }
+
+    mino_clear_error();
+    fz_pixmap *pix = NULL;
+    fz_page *page = NULL;
+    fz_device *dev = NULL;
+    stats_mark mark;
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        // Load the page
+        page = fz_load_page(ctx, doc, page_number);
+
+        // Get page bounds
+        fz_rect bounds = fz_bound_page(ctx, page);
+
+        // Create transformation matrix with zoom
+        fz_matrix transform = fz_scale(zoom, zoom);
+
+        // Transform the bounds
+        fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, transform));
+
+        // Create pixmap with RGB colorspace and alpha
+        pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, NULL, 1);
+
+        // Clear to white
+        fz_clear_pixmap_with_value(ctx, pix, 255);
+
+        // Create draw device
+        dev = fz_new_draw_device(ctx, transform, pix);
+
+        // Render page
+        fz_run_page(ctx, page, dev, fz_identity, job ? job->cookie : NULL);
+
+        // Close device
+        fz_close_device(ctx, dev);
+
+        // The interpreter stops early when aborted; discard the partial page
+        check_abort(ctx, job);
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) {
+            stats->render_ns += now_ns() - mark.start_ns;
+            stats->bytes_out += (int64_t)fz_pixmap_stride(ctx, pix) * fz_pixmap_height(ctx, pix);
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+        fz_drop_page(ctx, page);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        caught_status(ctx, job);
+        fz_drop_pixmap(ctx, pix);
+        return NULL;
+    }
+
+    return pix;
+}
+
+// Get page dimensions
+int mino_get_page_size(
+    fz_context *ctx,
+    fz_document *doc,
+    int page_number,
+    float *width,
+    float *height
+) {
+    if (!ctx || !doc || !width || !height) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    mino_clear_error();
+    fz_page *page = NULL;
+
+    fz_try(ctx) {
+        page = fz_load_page(ctx, doc, page_number);
+        fz_rect bounds = fz_bound_page(ctx, page);
+        *width = bounds.x1 - bounds.x0;
+        *height = bounds.y1 - bounds.y0;
+    }
+    fz_always(ctx) {
+        fz_drop_page(ctx, page);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Drop pixmap
+void mino_drop_pixmap(fz_context *ctx, fz_pixmap *pix) {
+    if (ctx && pix) {
+        fz_drop_pixmap(ctx, pix);
+    }
+}
+
+// Pixmap data accessors
+int mino_pixmap_width(fz_context *ctx, fz_pixmap *pix) {
+    if (!ctx || !pix) return 0;
+    return fz_pixmap_width(ctx, pix);
+}
+
+int mino_pixmap_height(fz_context *ctx, fz_pixmap *pix) {
+    if (!ctx || !pix) return 0;
+    return fz_pixmap_height(ctx, pix);
+}
+
+unsigned char* mino_pixmap_samples(fz_context *ctx, fz_pixmap *pix) {
+    if (!ctx || !pix) return NULL;
+    return fz_pixmap_samples(ctx, pix);
+}
+
+int mino_pixmap_stride(fz_context *ctx, fz_pixmap *pix) {
+    if (!ctx || !pix) return 0;
+    return fz_pixmap_stride(ctx, pix);
+}
+
+// Write a pixmap to a PNG file
+int mino_save_pixmap_png(fz_context *ctx, fz_pixmap *pix, const char *path) {
+    if (!ctx || !pix || !path) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    mino_clear_error();
+
+    fz_try(ctx) {
+        fz_save_pixmap_as_png(ctx, pix, path);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        return -1;
+    }
+
+    return 0;
+}
+
+// MARK: - Renderer
+//
+// A document opened once and rendered from many threads. Interpreting a page
+// touches the document, so it happens under the renderer's lock and records a
+// display list. Rasterizing the list needs only the caller's context, so
+// pages are drawn in parallel on clones from the shared pool, which share the
+// store and glyph cache.
+//
+// Recorded lists are kept within a byte budget, so rendering a page again at
+// another zoom replays its list instead of parsing the content stream.
+
+// Least a cached list is charged, so lists that reuse resources already in
+// the store still count against the budget
+#define RENDERER_MIN_LIST_BYTES (16 * 1024)
+
+typedef struct {
+    fz_rect bounds;
+    int bounded;                // bounds is valid
+    fz_display_list *list;      // Cached recording, NULL when not cached
+    size_t list_bytes;          // Heap the recording was measured to hold
+    int64_t last_used;          // Render tick, for least-recently-used eviction
+} renderer_page;
+
+struct mino_renderer {
+    pthread_mutex_t mutex;      // Serializes all use of ctx, doc and pages
+    fz_context *ctx;            // Held from open to drop, so teardown never lacks one
+    fz_document *doc;           // NULL once closed
+    int page_count;
+    renderer_page *pages;
+    int64_t tick;
+    size_t cached_bytes;        // Sum of list_bytes over cached lists
+    size_t list_budget;
+};
+
+mino_renderer* mino_renderer_open(const char *path) {
+    if (!path) {
+        set_error("Invalid path");
+        return NULL;
+    }
+
+    fz_context *ctx = mino_acquire_context();
+    if (!ctx) return NULL;
+
+    mino_renderer *renderer = calloc(1, sizeof(*renderer));
+    fz_document *doc = renderer ? mino_open_document(ctx, path) : NULL;
+    int count = doc ? mino_count_pages(ctx, doc) : -1;
+
+    if (count >= 0) {
+        renderer->pages = calloc(count > 0 ? (size_t)count : 1, sizeof(renderer_page));
+        if (!renderer->pages) {
+            set_error("Failed to allocate renderer");
+            count = -1;
+        }
+    } else if (!renderer) {
+        set_error("Failed to allocate renderer");
+    }
+
+    if (count < 0) {
+        mino_drop_document(ctx, doc);
+        mino_release_context(ctx);
+        if (renderer) {
+            free(renderer->pages);
+            free(renderer);
+        }
+        return NULL;
+    }
+
+    pthread_mutex_init(&renderer->mutex, NULL);
+    renderer->doc = doc;
+    renderer->page_count = count;
+    renderer->list_budget = MINO_DISPLAY_LIST_BUDGET;
+    renderer->ctx = ctx;
+    return renderer;
+}
+
+// Drop a page's cached list. Caller holds the mutex.
+static void renderer_evict(fz_context *ctx, mino_renderer *renderer, int page_number) {
+    renderer_page *entry = &renderer->pages[page_number];
+    fz_drop_display_list(ctx, entry->list);
+    renderer->cached_bytes -= entry->list_bytes;
+    entry->list = NULL;
+    entry->list_bytes = 0;
+}
+
+// Evict least recently used lists until `incoming` more bytes fit in the
+// budget. Caller holds the mutex.
+static void renderer_make_room(fz_context *ctx, mino_renderer *renderer, size_t incoming) {
+    while (renderer->cached_bytes > 0 && renderer->cached_bytes + incoming > renderer->list_budget) {
+        int oldest = -1;
+        for (int i = 0; i < renderer->page_count; i++) {
+            if (renderer->pages[i].list &&
+                (oldest < 0 || renderer->pages[i].last_used < renderer->pages[oldest].last_used)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) break;
+        renderer_evict(ctx, renderer, oldest);
+    }
+}
+
+// Drop the document and every cached list. Renders already replaying a list
+// still finish, since they hold their own reference.
+void mino_renderer_close(mino_renderer *renderer) {
+    if (!renderer) return;
+
+    pthread_mutex_lock(&renderer->mutex);
+    for (int i = 0; i < renderer->page_count; i++) {
+        if (renderer->pages[i].list) {
+            renderer_evict(renderer->ctx, renderer, i);
+        }
+    }
+    mino_drop_document(renderer->ctx, renderer->doc);
+    renderer->doc = NULL;
+    pthread_mutex_unlock(&renderer->mutex);
+}
+
+void mino_renderer_drop(mino_renderer *renderer) {
+    if (!renderer) return;
+
+    mino_renderer_close(renderer);
+    mino_release_context(renderer->ctx);
+    pthread_mutex_destroy(&renderer->mutex);
+    free(renderer->pages);
+    free(renderer);
+}
+
+void mino_renderer_set_list_budget(mino_renderer *renderer, size_t max_bytes) {
+    if (!renderer) return;
+
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->list_budget = max_bytes;
+    renderer_make_room(renderer->ctx, renderer, 0);
+    pthread_mutex_unlock(&renderer->mutex);
+}
+
+int mino_renderer_page_count(const mino_renderer *renderer) {
+    return renderer ? renderer->page_count : -1;
+}
+
+// Bounds of a page, loading it only the first time. Caller holds the mutex.
+static fz_rect renderer_bounds(fz_context *ctx, mino_renderer *renderer, fz_page *page, int page_number) {
+    renderer_page *entry = &renderer->pages[page_number];
+    if (!entry->bounded) {
+        fz_page *loaded = page ? NULL : fz_load_page(ctx, renderer->doc, page_number);
+        entry->bounds = fz_bound_page(ctx, page ? page : loaded);
+        entry->bounded = 1;
+        fz_drop_page(ctx, loaded);
+    }
+    return entry->bounds;
+}
+
+static void renderer_check(fz_context *ctx, const mino_renderer *renderer, int page_number) {
+    if (!renderer->doc) {
+        fz_throw(ctx, FZ_ERROR_GENERIC, "Renderer is closed");
+    }
+    if (page_number < 0 || page_number >= renderer->page_count) {
+        fz_throw(ctx, FZ_ERROR_ARGUMENT, "Page %d out of range", page_number);
+    }
+}
+
+// Look up a page's bounds on the renderer's context. Returns 0 or -1 with the error set.
+static int renderer_lookup_bounds(mino_renderer *renderer, int page_number, fz_rect *bounds) {
+    mino_clear_error();
+    int result = 0;
+
+    pthread_mutex_lock(&renderer->mutex);
+    fz_context *ctx = renderer->ctx;
+    fz_try(ctx) {
+        renderer_check(ctx, renderer, page_number);
+        *bounds = renderer_bounds(ctx, renderer, NULL, page_number);
+    }
+    fz_always(ctx) {
+        pthread_mutex_unlock(&renderer->mutex);
+    }
+    fz_catch(ctx) {
+        set_error(fz_caught_message(ctx));
+        result = -1;
+    }
+
+    return result;
+}
+
+int mino_renderer_page_size(
+    mino_renderer *renderer,
+    int page_number,
+    float *width,
+    float *height
+) {
+    if (!renderer || !width || !height) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    fz_rect bounds;
+    if (renderer_lookup_bounds(renderer, page_number, &bounds) != 0) {
+        return -1;
+    }
+
+    *width = bounds.x1 - bounds.x0;
+    *height = bounds.y1 - bounds.y0;
+    return 0;
+}
+
+int mino_renderer_pixel_size(
+    mino_renderer *renderer,
+    int page_number,
+    float zoom,
+    int *width,
+    int *height
+) {
+    if (!renderer || !width || !height) {
+        set_error("Invalid parameters");
+        return -1;
+    }
+
+    fz_rect bounds;
+    if (renderer_lookup_bounds(renderer, page_number, &bounds) != 0) {
+        return -1;
+    }
+
+    // Same rounding as the render itself
+    fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, fz_scale(zoom, zoom)));
+    *width = bbox.x1 - bbox.x0;
+    *height = bbox.y1 - bbox.y0;
+    return 0;
+}
+
+int mino_pixel_bytes(mino_pixel_format format) {
+    switch (format) {
+    case MINO_PIXEL_RGBA:
+    case MINO_PIXEL_BGRA:
+        return 4;
+    case MINO_PIXEL_RGB:
+        return 3;
+    case MINO_PIXEL_GRAY8:
+        return 1;
+    case MINO_PIXEL_RGB565:
+        return 2;
+    }
+    return 0;
+}
+
+int mino_render_stride(int width, mino_pixel_format format) {
+    int row = width > 0 ? width * mino_pixel_bytes(format) : 0;
+    return (row + MINO_RENDER_ROW_ALIGNMENT - 1) / MINO_RENDER_ROW_ALIGNMENT * MINO_RENDER_ROW_ALIGNMENT;
+}
+
+// Interpret a page into a display list and cache it. Caller holds the mutex.
+static fz_display_list* renderer_record_page(
+    fz_context *ctx,
+    mino_renderer *renderer,
+    int page_number,
+    mino_job *job
+) {
+    renderer_page *entry = &renderer->pages[page_number];
+    fz_page *page = NULL;
+    fz_device *dev = NULL;
+    fz_display_list *list = NULL;
+
+    fz_var(page);
+    fz_var(dev);
+    fz_var(list);
+
+    // Recording runs on this thread, so what it allocates and keeps is what
+    // the list holds, including the fonts and images it keeps alive
+    heap_tally_begin();
+
+    fz_try(ctx) {
+        page = fz_load_page(ctx, renderer->doc, page_number);
+        list = fz_new_display_list(ctx, renderer_bounds(ctx, renderer, page, page_number));
+        dev = fz_new_list_device(ctx, list);
+        fz_run_page(ctx, page, dev, fz_identity, job ? job->cookie : NULL);
+        fz_close_device(ctx, dev);
+
+        // The interpreter stops early when aborted; never cache a partial list
+        check_abort(ctx, job);
+
+        fz_drop_device(ctx, dev);
+        dev = NULL;
+        fz_drop_page(ctx, page);
+        page = NULL;
+
+        int64_t held = heap_tally_end();
+        size_t bytes = held > RENDERER_MIN_LIST_BYTES ? (size_t)held : RENDERER_MIN_LIST_BYTES;
+        if (renderer->list_budget > 0 && bytes <= renderer->list_budget) {
+            renderer_make_room(ctx, renderer, bytes);
+            entry->list = fz_keep_display_list(ctx, list);
+            entry->list_bytes = bytes;
+            renderer->cached_bytes += bytes;
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+        fz_drop_page(ctx, page);
+        heap_tally_end();
+    }
+    fz_catch(ctx) {
+        fz_drop_display_list(ctx, list);
+        fz_rethrow(ctx);
+    }
+
+    return list;
+}
+
+// A page's display list, replayed from the cache when possible. The caller
+// drops the returned reference.
+static fz_display_list* renderer_page_list(
+    fz_context *ctx,
+    mino_renderer *renderer,
+    int page_number,
+    fz_rect *bounds,
+    mino_job *job
+) {
+    fz_display_list *list = NULL;
+
+    pthread_mutex_lock(&renderer->mutex);
+    fz_try(ctx) {
+        renderer_check(ctx, renderer, page_number);
+
+        renderer_page *entry = &renderer->pages[page_number];
+        entry->last_used = ++renderer->tick;
+
+        if (entry->list) {
+            list = fz_keep_display_list(ctx, entry->list);
+            mino_job_stats *stats = job_stats(job);
+            if (stats) stats->display_list_hits++;
+        } else {
+            list = renderer_record_page(ctx, renderer, page_number, job);
+        }
+        *bounds = entry->bounds;
+    }
+    fz_always(ctx) {
+        pthread_mutex_unlock(&renderer->mutex);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return list;
+}
+
+// MARK: - Pixel Conversion
+//
+// MuPDF draws RGB, BGR and gray pixmaps natively. Packed 16-bit output has no
+// pixmap type, so it is drawn as RGBA and packed here.
+
+// Pack opaque RGBA pixels into native-endian RGB565, keeping the top bits
+static void pack_rgb565(const unsigned char *src, uint16_t *dst, int count) {
+    int i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t px = vld4_u8(src + (size_t)i * 4);
+        uint16x8_t out = vshll_n_u8(px.val[0], 8);
+        out = vsriq_n_u16(out, vshll_n_u8(px.val[1], 8), 5);
+        out = vsriq_n_u16(out, vshll_n_u8(px.val[2], 8), 11);
+        vst1q_u16(dst + i, out);
+    }
+#elif defined(__SSE2__)
+    const __m128i red = _mm_set1_epi32(0xF8);
+    const __m128i green = _mm_set1_epi32(0xFC00);
+    const __m128i blue = _mm_set1_epi32(0xF80000);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed[2];
+        for (int half = 0; half < 2; half++) {
+            // Each 32-bit lane holds one pixel as A B G R from the top byte down
+            __m128i px = _mm_loadu_si128((const __m128i *)(src + (size_t)(i + half * 4) * 4));
+            __m128i v = _mm_slli_epi32(_mm_and_si128(px, red), 8);
+            v = _mm_or_si128(v, _mm_srli_epi32(_mm_and_si128(px, green), 5));
+            v = _mm_or_si128(v, _mm_srli_epi32(_mm_and_si128(px, blue), 19));
+            // Sign-extend the low half so the saturating pack keeps it exactly
+            packed[half] = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(packed[0], packed[1]));
+    }
+#endif
+
+    for (; i < count; i++) {
+        const unsigned char *p = src + (size_t)i * 4;
+        dst[i] = (uint16_t)(((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3));
+    }
+}
+
+// MARK: - Renderer Output
+
+// Caller-owned memory to render into instead of a new pixmap
+typedef struct {
+    unsigned char *samples;
+    int stride;
+    size_t capacity;
+    mino_pixel_format format;
+} render_buffer;
+
+// Rows drawn at a time for formats packed after drawing
+#define RENDER_BAND_ROWS 64
+
+static fz_colorspace* format_colorspace(fz_context *ctx, mino_pixel_format format) {
+    switch (format) {
+    case MINO_PIXEL_BGRA:
+        return fz_device_bgr(ctx);
+    case MINO_PIXEL_GRAY8:
+        return fz_device_gray(ctx);
+    default:
+        return fz_device_rgb(ctx);
+    }
+}
+
+// Formats MuPDF can draw into directly
+static int format_is_native(mino_pixel_format format) {
+    return format != MINO_PIXEL_RGB565;
+}
+
+static int format_has_alpha(mino_pixel_format format) {
+    return format == MINO_PIXEL_RGBA || format == MINO_PIXEL_BGRA;
+}
+
+// A white pixmap covering bbox: RGBA, or the buffer's format in its memory
+static fz_pixmap* new_render_pixmap(fz_context *ctx, fz_irect bbox, const render_buffer *buffer) {
+    fz_pixmap *pix;
+
+    if (buffer) {
+        // Unlike fz_new_pixmap_with_bbox_and_data, this keeps the caller's
+        // row stride; the origin is then set to match the bbox
+        int w = bbox.x1 - bbox.x0;
+        int h = bbox.y1 - bbox.y0;
+        pix = fz_new_pixmap_with_data(ctx, format_colorspace(ctx, buffer->format), w, h, NULL,
+                                      format_has_alpha(buffer->format), buffer->stride, buffer->samples);
+        pix->x = bbox.x0;
+        pix->y = bbox.y0;
+    } else {
+        pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, NULL, 1);
+    }
+
+    fz_clear_pixmap_with_value(ctx, pix, 255);
+    return pix;
+}
+
+// Rasterize the part of a display list inside pix onto it
+static void draw_list(
+    fz_context *ctx,
+    fz_display_list *list,
+    fz_matrix transform,
+    fz_pixmap *pix,
+    mino_job *job
+) {
+    fz_irect bbox = { pix->x, pix->y, pix->x + pix->w, pix->y + pix->h };
+    fz_device *dev = NULL;
+
+    fz_var(dev);
+
+    fz_try(ctx) {
+        // Transform while replaying so the scissor is in device space
+        dev = fz_new_draw_device(ctx, fz_identity, pix);
+        fz_run_display_list(ctx, list, dev, transform, fz_rect_from_irect(bbox), job ? job->cookie : NULL);
+        fz_close_device(ctx, dev);
+    }
+    fz_always(ctx) {
+        fz_drop_device(ctx, dev);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Draw bbox a band at a time into a small RGBA pixmap and pack each band into
+// the buffer, so no full-size intermediate is ever allocated
+static void draw_list_packed(
+    fz_context *ctx,
+    fz_display_list *list,
+    fz_matrix transform,
+    fz_irect bbox,
+    const render_buffer *buffer,
+    mino_job *job
+) {
+    int w = bbox.x1 - bbox.x0;
+    int h = bbox.y1 - bbox.y0;
+    int band_rows = h < RENDER_BAND_ROWS ? h : RENDER_BAND_ROWS;
+    fz_pixmap *band = fz_new_pixmap(ctx, fz_device_rgb(ctx), w, band_rows, NULL, 1);
+
+    fz_try(ctx) {
+        for (int y = 0; y < h; y += band_rows) {
+            check_abort(ctx, job);
+
+            band->x = bbox.x0;
+            band->y = bbox.y0 + y;
+            band->h = h - y < band_rows ? h - y : band_rows;
+            fz_clear_pixmap_with_value(ctx, band, 255);
+            draw_list(ctx, list, transform, band, job);
+
+            for (int row = 0; row < band->h; row++) {
+                pack_rgb565(band->samples + (size_t)row * band->stride,
+                            (uint16_t *)(buffer->samples + (size_t)(y + row) * buffer->stride), w);
+            }
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_pixmap(ctx, band);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Render a whole page, or only the device-space tile when one is given,
+// into a new RGBA pixmap (returned in *pixmap) or the caller's buffer.
+// Returns a mino_status.
+static int renderer_draw(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    const fz_irect *tile,
+    const render_buffer *buffer,
+    fz_pixmap **pixmap,
+    mino_job *job
+) {
+    if (!renderer || !ctx) {
+        set_error("Invalid renderer or context");
+        return MINO_STATUS_ERROR;
+    }
+
+    mino_clear_error();
+    fz_display_list *list = NULL;
+    fz_pixmap *pix = NULL;
+    stats_mark mark;
+
+    fz_var(list);
+    fz_var(pix);
+
+    stats_begin(job, &mark);
+
+    fz_try(ctx) {
+        fz_rect bounds;
+        list = renderer_page_list(ctx, renderer, page_number, &bounds, job);
+        check_abort(ctx, job);
+
+        fz_matrix transform = fz_scale(zoom, zoom);
+        fz_irect bbox = tile ? *tile : fz_round_rect(fz_transform_rect(bounds, transform));
+        int h = bbox.y1 - bbox.y0;
+
+        if (buffer) {
+            int w = bbox.x1 - bbox.x0;
+            if (buffer->stride < w * mino_pixel_bytes(buffer->format) ||
+                (size_t)buffer->stride * (size_t)h > buffer->capacity) {
+                fz_throw(ctx, FZ_ERROR_ARGUMENT, "Buffer too small for %dx%d pixels", w, h);
+            }
+        }
+
+        if (buffer && !format_is_native(buffer->format)) {
+            draw_list_packed(ctx, list, transform, bbox, buffer, job);
+        } else {
+            pix = new_render_pixmap(ctx, bbox, buffer);
+            draw_list(ctx, list, transform, pix, job);
+        }
+        check_abort(ctx, job);
+
+        mino_job_stats *stats = job_stats(job);
+        if (stats) {
+            stats->render_ns += now_ns() - mark.start_ns;
+            stats->bytes_out += (int64_t)(buffer ? buffer->stride : fz_pixmap_stride(ctx, pix)) * h;
+        }
+    }
+    fz_always(ctx) {
+        fz_drop_display_list(ctx, list);
+        stats_end(job, &mark);
+    }
+    fz_catch(ctx) {
+        fz_drop_pixmap(ctx, pix);
+        return caught_status(ctx, job);
+    }
+
+    // The caller's memory outlives the pixmap wrapping it
+    if (pixmap) {
+        *pixmap = pix;
+    } else {
+        fz_drop_pixmap(ctx, pix);
+    }
+    return MINO_STATUS_OK;
+}
+
+static int renderer_draw_into(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    const fz_irect *tile,
+    unsigned char *samples,
+    int stride,
+    size_t capacity,
+    mino_pixel_format format,
+    mino_job *job
+) {
+    if (!samples || mino_pixel_bytes(format) == 0) {
+        set_error("Invalid buffer or pixel format");
+        return MINO_STATUS_ERROR;
+    }
+
+    render_buffer buffer = { .samples = samples, .stride = stride, .capacity = capacity, .format = format };
+    return renderer_draw(renderer, ctx, page_number, zoom, tile, &buffer, NULL, job);
+}
+
+fz_pixmap* mino_renderer_render_page(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    mino_job *job
+) {
+    fz_pixmap *pix = NULL;
+    renderer_draw(renderer, ctx, page_number, zoom, NULL, NULL, &pix, job);
+    return pix;
+}
+
+// Only the tile is allocated and drawn; content outside it is culled before
+// rasterizing, and any part of the tile beyond the page stays white
+fz_pixmap* mino_renderer_render_tile(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    fz_irect tile,
+    mino_job *job
+) {
+    if (fz_is_empty_irect(tile)) {
+        set_error("Empty tile");
+        return NULL;
+    }
+
+    fz_pixmap *pix = NULL;
+    renderer_draw(renderer, ctx, page_number, zoom, &tile, NULL, &pix, job);
+    return pix;
+}
+
+int mino_renderer_render_page_into(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    unsigned char *samples,
+    int stride,
+    size_t capacity,
+    mino_pixel_format format,
+    mino_job *job
+) {
+    return renderer_draw_into(renderer, ctx, page_number, zoom, NULL, samples, stride, capacity, format, job);
+}
+
+int mino_renderer_render_tile_into(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    fz_irect tile,
+    unsigned char *samples,
+    int stride,
+    size_t capacity,
+    mino_pixel_format format,
+    mino_job *job
+) {
+    if (fz_is_empty_irect(tile)) {
+        set_error("Empty tile");
+        return MINO_STATUS_ERROR;
+    }
+    return renderer_draw_into(renderer, ctx, page_number, zoom, &tile, samples, stride, capacity, format, job);
+}
+
+// MARK: - Streaming Compression
+//
+// For documents too large to hold in memory at once. Image DPIs are found one
+// page at a time as usual, then pages are written in windows: every object a
+// window reaches that is not yet written goes straight to the output, images
+// recompressed on the way, after which the store and the parsed objects are
+// dropped. Page tree nodes and whatever only the catalog reaches are written
+// last, followed by a classic xref table.
+//
+// The document is never modified, so parsed objects can always be re-read
+// from the file. Only reachable objects are written (as with garbage
+// collection) but they keep their numbers, and content streams are copied
+// rather than cleaned.
+
+#define STREAM_WINDOW_PAGES 16
+
+// Object states while streaming
+enum {
+    STREAM_UNSEEN = 0,
+    STREAM_QUEUED = 1,          // What push_references marks
+    STREAM_QUEUED_PAGE,         // A page of the current window
+    STREAM_DEFERRED,            // A page or page tree node met outside its window
+    STREAM_WRITTEN
+};
+
+typedef struct {
+    pdf_document *doc;
+    fz_output *out;
+    const mino_rewrite_options *opts;
+    const float *min_dpi;
+    mino_job *job;
+    int xref_len;
+    unsigned char *state;
+    int64_t *offsets;
+    int *stack;
+    int top;
+    rewrite_candidate *images;  // Reached in the current window, not yet written
+    int image_count;
+    int image_capacity;
+    int keep_unreachable;       // Garbage level 0: write objects nothing refers to as well
+} stream_writer;
+
+// Objects are read straight from MuPDF's xref entries only in object_gen and
+// evict_cached_objects. pdf_xref_entry is declared in the public pdf/xref.h;
+// the fields used (type, gen and obj) were checked against MuPDF 1.25.
+#if FZ_VERSION_MAJOR != 1 || FZ_VERSION_MINOR != 25
+#warning "Check object_gen and evict_cached_objects against this MuPDF version's pdf_xref_entry"
+#endif
+
+// Generation to write for an object. For objects inside an object stream
+// ('o' entries) MuPDF keeps their index within that stream in gen; their
+// generation is always 0.
+static int object_gen(fz_context *ctx, pdf_document *doc, int num) {
+    pdf_xref_entry *entry = pdf_get_xref_entry_no_null(ctx, doc, num);
+    return entry->type == 'n' ? entry->gen : 0;
+}
+
+// Drop parsed objects nothing else holds, so they are re-read from the file
+// when needed again. Edited objects exist only in memory, so nothing is
+// dropped once the document has changes.
+static void evict_cached_objects(fz_context *ctx, pdf_document *doc) {
+    if (pdf_has_unsaved_changes(ctx, doc)) return;
+
+    int xref_len = pdf_xref_len(ctx, doc);
+    for (int num = 1; num < xref_len; num++) {
+        pdf_xref_entry *entry = pdf_get_xref_entry_no_null(ctx, doc, num);
+
+        // The xref's own reference is the only one left
+        if (entry->obj && pdf_obj_refs(ctx, entry->obj) == 1) {
+            pdf_drop_obj(ctx, entry->obj);
+            entry->obj = NULL;
+        }
+    }
+}
+
+static void stream_begin_object(fz_context *ctx, stream_writer *w, int num) {
+    w->offsets[num] = fz_tell_output(ctx, w->out);
+    w->state[num] = STREAM_WRITTEN;
+    fz_write_printf(ctx, w->out, "%d %d obj\n", num, object_gen(ctx, w->doc, num));
+}
+
+// Write a stream object. dict is a copy, so its Length can be set directly.
+static void stream_write_stream(
+    fz_context *ctx,
+    stream_writer *w,
+    int num,
+    pdf_obj *dict,
+    const unsigned char *data,
+    size_t length
+) {
+    pdf_dict_put_int(ctx, dict, PDF_NAME(Length), (int64_t)length);
+    stream_begin_object(ctx, w, num);
+    pdf_print_obj(ctx, w->out, dict, 1, 0);
+    fz_write_string(ctx, w->out, "\nstream\n");
+    fz_write_data(ctx, w->out, data, length);
+    fz_write_string(ctx, w->out, "\nendstream\nendobj\n");
+}
+
+// Copy an object as it is in the file. Filtered streams are copied raw,
+// unfiltered ones deflated when that makes them smaller.
+static void stream_copy_object(fz_context *ctx, stream_writer *w, int num, pdf_obj *obj) {
+    if (!obj || !pdf_obj_num_is_stream(ctx, w->doc, num)) {
+        stream_begin_object(ctx, w, num);
+        pdf_print_obj(ctx, w->out, obj, 1, 0);
+        fz_write_string(ctx, w->out, "\nendobj\n");
+        return;
+    }
+
+    fz_buffer *raw = NULL;
+    pdf_obj *dict = NULL;
+    unsigned char *deflated = NULL;
+
+    fz_var(raw);
+    fz_var(dict);
+    fz_var(deflated);
+
+    fz_try(ctx) {
+        raw = pdf_load_raw_stream_number(ctx, w->doc, num);
+        dict = pdf_copy_dict(ctx, obj);
+
+        unsigned char *data = NULL;
+        size_t length = fz_buffer_storage(ctx, raw, &data);
+        if (!pdf_dict_get(ctx, dict, PDF_NAME(Filter)) && length > 0) {
+            size_t deflated_length = 0;
+            deflated = fz_new_deflated_data_from_buffer(ctx, &deflated_length, raw, FZ_DEFLATE_DEFAULT);
+            if (deflated_length < length) {
+                data = deflated;
+                length = deflated_length;
+                pdf_dict_put(ctx, dict, PDF_NAME(Filter), PDF_NAME(FlateDecode));
+                pdf_dict_del(ctx, dict, PDF_NAME(DecodeParms));
+            }
+        }
+
+        stream_write_stream(ctx, w, num, dict, data, length);
+    }
+    fz_always(ctx) {
+        fz_free(ctx, deflated);
+        pdf_drop_obj(ctx, dict);
+        fz_drop_buffer(ctx, raw);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Load an object for writing. Unreadable objects are written as null.
+static pdf_obj* stream_load_object(fz_context *ctx, stream_writer *w, int num) {
+    pdf_obj *obj = NULL;
+    fz_try(ctx) {
+        obj = pdf_load_object(ctx, w->doc, num);
+    }
+    fz_catch(ctx) {
+        if (fz_caught(ctx) == FZ_ERROR_ABORT) {
+            fz_rethrow(ctx);
+        }
+        fz_warn(ctx, "writing unreadable object %d as null", num);
+        obj = NULL;
+    }
+    return obj;
+}
+
+static void stream_copy_number(fz_context *ctx, stream_writer *w, int num) {
+    pdf_obj *obj = stream_load_object(ctx, w, num);
+    fz_try(ctx) {
+        stream_copy_object(ctx, w, num, obj);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, obj);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+static void stream_write_candidate(fz_context *ctx, stream_writer *w, const rewrite_candidate *c) {
+    pdf_obj *obj = pdf_load_object(ctx, w->doc, c->num);
+    pdf_obj *dict = NULL;
+
+    fz_var(dict);
+
+    fz_try(ctx) {
+        dict = pdf_copy_dict(ctx, obj);
+        describe_candidate(ctx, dict, c);
+
+        unsigned char *data = NULL;
+        size_t length = fz_buffer_storage(ctx, c->encoded, &data);
+        stream_write_stream(ctx, w, c->num, dict, data, length);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, dict);
+        pdf_drop_obj(ctx, obj);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
 }
 
-// Get PDF-specific document handle
-pdf_document* mino_pdf_specifics(fz_context *ctx, fz_document *doc) {
-    if (!ctx || !doc) {
-        return NULL;
+static void stream_add_image(fz_context *ctx, stream_writer *w, int num) {
+    if (w->image_count == w->image_capacity) {
+        int capacity = w->image_capacity ? w->image_capacity * 2 : 16;
+        w->images = fz_realloc_array(ctx, w->images, capacity, rewrite_candidate);
+        w->image_capacity = capacity;
     }
-    return pdf_specifics(ctx, doc);
+    rewrite_candidate *c = &w->images[w->image_count++];
+    memset(c, 0, sizeof(*c));
+    c->num = num;
+    c->min_dpi = w->min_dpi[num];
 }
 
-// Rewrite images in the PDF with compression settings
-int mino_rewrite_images(
-    fz_context *ctx,
-    pdf_document *doc,
-    int jpeg_quality,
-    int target_dpi,
-    int dpi_threshold
-) {
-    if (!ctx || !doc) {
-        set_error("Invalid context or document");
-        return -1;
+// Recompress and write the images reached by the current window, a chunk at
+// a time as in rewrite_scanned_images. Images that are not rewritten are
+// copied.
+static void stream_write_images(fz_context *ctx, stream_writer *w) {
+    const mino_rewrite_options *opts = w->opts;
+    mino_job_stats *stats = job_stats(w->job);
+    int64_t start = now_ns();
+    int threads = opts->threads > 0 ? opts->threads : available_cores();
+    int chunk_size = threads * 4;
+
+    for (int first = 0; first < w->image_count; first += chunk_size) {
+        int chunk_count = w->image_count - first < chunk_size ? w->image_count - first : chunk_size;
+        rewrite_candidate *chunk = &w->images[first];
+
+        int loaded = 0;
+        for (int i = 0; i < chunk_count; i++) {
+            rewrite_candidate c = chunk[i];
+            if (opts->cache && lookup_candidate(ctx, w->doc, opts, &c)) {
+                if (stats) stats->image_cache_hits++;
+                if (!c.keep_original) {
+                    prepare_original(ctx, w->doc, opts, &c);
+                    chunk[loaded++] = c;
+                    continue;
+                }
+                if (stats) stats->images_kept++;
+            } else if (load_candidate(ctx, w->doc, opts, &c)) {
+                prepare_original(ctx, w->doc, opts, &c);
+                chunk[loaded++] = c;
+                continue;
+            }
+            stream_copy_number(ctx, w, c.num);
+        }
+
+        rewrite_batch batch = { opts, chunk };
+        run_workers(ctx, threads, loaded, job_abort_flag(w->job), rewrite_image_job, &batch);
+        check_abort(ctx, w->job);
+
+        for (int i = 0; i < loaded; i++) {
+            rewrite_candidate *c = &chunk[i];
+            int written = 0;
+            if (c->encoded) {
+                int64_t new_length = (int64_t)fz_buffer_storage(ctx, c->encoded, NULL);
+                int64_t old_length = c->original_size;
+                int keep = opts->replace == MINO_REPLACE_IF_SMALLER && new_length >= old_length;
+
+                if (c->cache_miss) {
+                    image_cache_put(ctx, opts->cache, c, keep);
+                }
+                if (keep) {
+                    if (stats) stats->images_kept++;
+                } else {
+                    stream_write_candidate(ctx, w, c);
+                    written = 1;
+                    if (stats) {
+                        stats->images_rewritten++;
+                        stats->image_bytes_in += old_length;
+                        stats->image_bytes_out += new_length;
+                    }
+                }
+            }
+            release_candidate(ctx, c);
+            if (!written) {
+                stream_copy_number(ctx, w, c->num);
+            }
+        }
     }
 
-    mino_clear_error();
+    w->image_count = 0;
+    if (stats) stats->images_ns += now_ns() - start;
+}
 
-    // Convert quality integer to string (MuPDF uses strings for quality)
-    char quality_str[16];
-    snprintf(quality_str, sizeof(quality_str), "%d", jpeg_quality);
+static int is_page_node(fz_context *ctx, pdf_obj *obj) {
+    pdf_obj *type = pdf_dict_get(ctx, obj, PDF_NAME(Type));
+    return pdf_name_eq(ctx, type, PDF_NAME(Page)) || pdf_name_eq(ctx, type, PDF_NAME(Pages));
+}
 
-    fz_try(ctx) {
-        // Set up image rewriter options - zero initialize
-        pdf_image_rewriter_options opts = {0};
+// Write everything reachable from the queued objects. With defer_pages set,
+// pages and page tree nodes other than the queued pages are left for later,
+// so a window does not pull in the rest of the document through /Parent or
+// links to other pages.
+static void stream_drain(fz_context *ctx, stream_writer *w, int defer_pages) {
+    pdf_obj *obj = NULL;
 
-        // Color lossy images (already JPEG)
-        opts.color_lossy_image_subsample_threshold = dpi_threshold;
-        opts.color_lossy_image_subsample_to = target_dpi;
-        opts.color_lossy_image_recompress_quality = quality_str;
-        opts.color_lossy_image_recompress_method = FZ_RECOMPRESS_JPEG;
-        opts.color_lossy_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+    fz_var(obj);
+
+    fz_try(ctx) {
+        for (int visited = 0; w->top > 0; visited++) {
+            if (visited % 256 == 0) {
+                check_abort(ctx, w->job);
+            }
 
-        // Color lossless images (PNG, etc.) - convert to JPEG
-        opts.color_lossless_image_subsample_threshold = dpi_threshold;
-        opts.color_lossless_image_subsample_to = target_dpi;
-        opts.color_lossless_image_recompress_quality = quality_str;
-        opts.color_lossless_image_recompress_method = FZ_RECOMPRESS_JPEG;
-        opts.color_lossless_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+            int num = w->stack[--w->top];
+            int queued_page = w->state[num] == STREAM_QUEUED_PAGE;
+            obj = stream_load_object(ctx, w, num);
 
-        // Grayscale lossy images
-        opts.gray_lossy_image_subsample_threshold = dpi_threshold;
-        opts.gray_lossy_image_subsample_to = target_dpi;
-        opts.gray_lossy_image_recompress_quality = quality_str;
-        opts.gray_lossy_image_recompress_method = FZ_RECOMPRESS_JPEG;
-        opts.gray_lossy_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+            if (defer_pages && !queued_page && is_page_node(ctx, obj)) {
+                w->state[num] = STREAM_DEFERRED;
+            } else {
+                push_references(ctx, obj, w->state, w->stack, &w->top, w->xref_len, 0);
+                if (w->min_dpi[num] > 0 && pdf_obj_num_is_stream(ctx, w->doc, num)) {
+                    stream_add_image(ctx, w, num);
+                } else {
+                    stream_copy_object(ctx, w, num, obj);
+                }
+            }
 
-        // Grayscale lossless images
-        opts.gray_lossless_image_subsample_threshold = dpi_threshold;
-        opts.gray_lossless_image_subsample_to = target_dpi;
-        opts.gray_lossless_image_recompress_quality = quality_str;
-        opts.gray_lossless_image_recompress_method = FZ_RECOMPRESS_JPEG;
-        opts.gray_lossless_image_subsample_method = FZ_SUBSAMPLE_AVERAGE;
+            pdf_drop_obj(ctx, obj);
+            obj = NULL;
+        }
 
-        // Rewrite images in the document
-        pdf_rewrite_images(ctx, doc, &opts);
+        stream_write_images(ctx, w);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, obj);
     }
     fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        return -1;
+        fz_rethrow(ctx);
     }
-
-    return 0;
 }
 
-// Compress and save PDF
-int mino_compress_pdf(
-    fz_context *ctx,
-    pdf_document *doc,
-    const char *output_path,
-    int jpeg_quality,
-    int target_dpi,
-    int garbage_level
-) {
-    if (!ctx || !doc || !output_path) {
-        set_error("Invalid parameters");
-        return -1;
+static void stream_push(stream_writer *w, int num, int state) {
+    if (num > 0 && num < w->xref_len &&
+        (w->state[num] == STREAM_UNSEEN || w->state[num] == STREAM_DEFERRED)) {
+        w->state[num] = (unsigned char)state;
+        w->stack[w->top++] = num;
     }
+}
 
-    mino_clear_error();
+static void stream_write_xref(fz_context *ctx, stream_writer *w) {
+    int64_t xref_offset = fz_tell_output(ctx, w->out);
+    char entry[32];
 
-    fz_try(ctx) {
-        // Rewrite images first
-        int dpi_threshold = target_dpi + 50; // Allow some headroom
-        mino_rewrite_images(ctx, doc, jpeg_quality, target_dpi, dpi_threshold);
+    // Chain the objects that were not written into the free list: each free
+    // entry holds the next free number, and entry 0 the first
+    int64_t next_free = 0;
+    for (int num = w->xref_len - 1; num > 0; num--) {
+        if (w->state[num] != STREAM_WRITTEN) {
+            w->offsets[num] = next_free;
+            next_free = num;
+        }
+    }
 
-        // Set up write options from the default constant
-        pdf_write_options opts = pdf_default_write_options;
+    fz_write_printf(ctx, w->out, "xref\n0 %d\n", w->xref_len);
+    snprintf(entry, sizeof(entry), "%010lld 65535 f \n", (long long)next_free);
+    fz_write_string(ctx, w->out, entry);
+    for (int num = 1; num < w->xref_len; num++) {
+        if (w->state[num] == STREAM_WRITTEN) {
+            snprintf(entry, sizeof(entry), "%010lld %05d n \n",
+                (long long)w->offsets[num], object_gen(ctx, w->doc, num));
+        } else {
+            snprintf(entry, sizeof(entry), "%010lld 00000 f \n", (long long)w->offsets[num]);
+        }
+        fz_write_string(ctx, w->out, entry);
+    }
 
-        opts.do_garbage = garbage_level;        // 0-4, 4 is maximum
-        opts.do_compress = 1;                   // Compress streams
-        opts.do_compress_images = 1;            // Compress images
-        opts.do_compress_fonts = 1;             // Compress fonts
-        opts.do_clean = 1;                      // Clean content streams
-        opts.do_sanitize = 1;                   // Sanitize content
-        opts.do_linear = 0;                     // Don't linearize (faster)
-        opts.do_appearance = 0;                 // Don't regenerate appearances
+    pdf_obj *source = pdf_trailer(ctx, w->doc);
+    pdf_obj *trailer = pdf_new_dict(ctx, w->doc, 4);
 
-        // Save the document
-        pdf_save_document(ctx, doc, output_path, &opts);
+    fz_try(ctx) {
+        pdf_dict_put_int(ctx, trailer, PDF_NAME(Size), w->xref_len);
+        pdf_dict_put(ctx, trailer, PDF_NAME(Root), pdf_dict_get(ctx, source, PDF_NAME(Root)));
+        if (pdf_dict_get(ctx, source, PDF_NAME(Info))) {
+            pdf_dict_put(ctx, trailer, PDF_NAME(Info), pdf_dict_get(ctx, source, PDF_NAME(Info)));
+        }
+        if (pdf_dict_get(ctx, source, PDF_NAME(ID))) {
+            pdf_dict_put(ctx, trailer, PDF_NAME(ID), pdf_dict_get(ctx, source, PDF_NAME(ID)));
+        }
+
+        fz_write_string(ctx, w->out, "trailer\n");
+        pdf_print_obj(ctx, w->out, trailer, 1, 0);
+        snprintf(entry, sizeof(entry), "%lld", (long long)xref_offset);
+        fz_write_printf(ctx, w->out, "\nstartxref\n%s\n%%%%EOF\n", entry);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, trailer);
     }
     fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        return -1;
+        fz_rethrow(ctx);
     }
-
-    return 0;
 }
 
-// Get file size
-int64_t mino_get_file_size(const char *path) {
-    if (!path) return -1;
+static void stream_document(fz_context *ctx, stream_writer *w, int window_pages) {
+    int version = pdf_version(ctx, w->doc);
+    fz_write_printf(ctx, w->out, "%%PDF-%d.%d\n%%\xC2\xB5\xC2\xB6\n\n", version / 10, version % 10);
 
-    FILE *f = fopen(path, "rb");
-    if (!f) return -1;
+    int page_count = pdf_count_pages(ctx, w->doc);
+    for (int first = 0; first < page_count; first += window_pages) {
+        check_abort(ctx, w->job);
 
-    if (fseek(f, 0, SEEK_END) != 0) {
-        fclose(f);
-        return -1;
+        int last = first + window_pages < page_count ? first + window_pages : page_count;
+        for (int i = first; i < last; i++) {
+            stream_push(w, pdf_to_num(ctx, pdf_lookup_page_obj(ctx, w->doc, i)), STREAM_QUEUED_PAGE);
+        }
+        stream_drain(ctx, w, 1);
+
+        // Decoded images, fonts and parsed objects of this window are done.
+        // The store is shared with every pooled context, so only this
+        // document's resources leave it.
+        pdf_empty_store(ctx, w->doc);
+        evict_cached_objects(ctx, w->doc);
     }
 
-    int64_t size = ftell(f);
-    fclose(f);
+    // The catalog, page tree and anything else not reached through a page
+    pdf_obj *trailer = pdf_trailer(ctx, w->doc);
+    push_references(ctx, pdf_dict_get(ctx, trailer, PDF_NAME(Root)), w->state, w->stack, &w->top, w->xref_len, 0);
+    push_references(ctx, pdf_dict_get(ctx, trailer, PDF_NAME(Info)), w->state, w->stack, &w->top, w->xref_len, 0);
+    for (int num = 1; num < w->xref_len; num++) {
+        if (w->state[num] == STREAM_DEFERRED ||
+            (w->keep_unreachable && w->state[num] == STREAM_UNSEEN && pdf_object_exists(ctx, w->doc, num))) {
+            stream_push(w, num, STREAM_QUEUED);
+        }
+    }
+    stream_drain(ctx, w, 0);
 
-    return size;
+    stream_write_xref(ctx, w);
 }
 
-// Render a page to pixmap
-fz_pixmap* mino_render_page(
+// Compress a document window by window without loading it all
+int mino_compress_pdf_streaming(
     fz_context *ctx,
-    fz_document *doc,
-    int page_number,
-    float zoom
+    pdf_document *doc,
+    const char *output_path,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    int window_pages,
+    mino_job *job
 ) {
-    if (!ctx || !doc) {
-        set_error("Invalid context or document");
-        return NULL;
+    if (!ctx || !doc || !output_path) {
+        set_error("Invalid parameters");
+        return MINO_STATUS_ERROR;
     }
 
-    mino_clear_error();
-    fz_pixmap *pix = NULL;
-    fz_page *page = NULL;
-    fz_device *dev = NULL;
+    // Raw streams of an encrypted file cannot be copied as they are
+    if (doc->crypt) {
+        return mino_compress_pdf_job(ctx, doc, output_path, jpeg_quality, target_dpi, garbage_level, job);
+    }
 
-    fz_try(ctx) {
-        // Load the page
-        page = fz_load_page(ctx, doc, page_number);
+    mino_clear_error();
 
-        // Get page bounds
-        fz_rect bounds = fz_bound_page(ctx, page);
+    // The output wrapper needs a job for the ceiling and cancellation
+    mino_job local_job = {0};
+    if (!job) job = &local_job;
 
-        // Create transformation matrix with zoom
-        fz_matrix transform = fz_scale(zoom, zoom);
+    mino_rewrite_options ropts = {
+        .jpeg_quality = jpeg_quality,
+        .target_dpi = target_dpi,
+        .dpi_threshold = target_dpi + 50, // Allow some headroom
+        .threads = job_threads(job),
+        .cache = job->image_cache,
+        .replace = job->image_replace,
+    };
 
-        // Transform the bounds
-        fz_irect bbox = fz_round_rect(fz_transform_rect(bounds, transform));
+    stream_writer w = { .doc = doc, .opts = &ropts, .job = job, .keep_unreachable = garbage_level <= 0 };
+    float *min_dpi = NULL;
+    fz_output *file = NULL;
+    fz_output *out = NULL;
+    int opened = 0;
+    stats_mark mark;
 
-        // Create pixmap with RGB colorspace and alpha
-        pix = fz_new_pixmap_with_bbox(ctx, fz_device_rgb(ctx), bbox, NULL, 1);
+    fz_var(w);
+    fz_var(min_dpi);
+    fz_var(file);
+    fz_var(out);
+    fz_var(opened);
 
-        // Clear to white
-        fz_clear_pixmap_with_value(ctx, pix, 255);
+    stats_begin(job, &mark);
 
-        // Create draw device
-        dev = fz_new_draw_device(ctx, transform, pix);
+    fz_try(ctx) {
+        int xref_len = pdf_xref_len(ctx, doc);
 
-        // Render page
-        fz_run_page(ctx, page, dev, fz_identity, NULL);
+        // As in compress_images, images are left alone if they cannot be scanned
+        fz_try(ctx) {
+            min_dpi = scan_images(ctx, doc, job);
+        }
+        fz_catch(ctx) {
+            if (fz_caught(ctx) == FZ_ERROR_ABORT) {
+                fz_rethrow(ctx);
+            }
+            fz_warn(ctx, "image scan failed: %s", fz_caught_message(ctx));
+            min_dpi = fz_calloc(ctx, (size_t)xref_len, sizeof(float));
+        }
+        pdf_empty_store(ctx, doc);
+        evict_cached_objects(ctx, doc);
 
-        // Close device
-        fz_close_device(ctx, dev);
-    }
-    fz_always(ctx) {
-        fz_drop_device(ctx, dev);
-        fz_drop_page(ctx, page);
-    }
-    fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        fz_drop_pixmap(ctx, pix);
-        return NULL;
-    }
+        w.min_dpi = min_dpi;
+        w.xref_len = xref_len;
+        w.state = fz_calloc(ctx, (size_t)xref_len, 1);
+        w.offsets = fz_calloc(ctx, (size_t)xref_len, sizeof(int64_t));
+        w.stack = fz_malloc_array(ctx, xref_len, int);
 
-    return pix;
-}
+        file = fz_new_output_with_path(ctx, output_path, 0);
+        opened = 1;
 
-// Get page dimensions
-int mino_get_page_size(
-    fz_context *ctx,
-    fz_document *doc,
-    int page_number,
-    float *width,
-    float *height
-) {
-    if (!ctx || !doc || !width || !height) {
-        set_error("Invalid parameters");
-        return -1;
-    }
+        int64_t start = now_ns();
+        int64_t images_before = job_stats(job) ? job_stats(job)->images_ns : 0;
+        job_output state = {
+            .target = file,
+            .job = job,
+            .objects_total = xref_len,
+            .reported_percent = -1,
+            .xref_table = 1,
+            .xref_entries = xref_len,
+        };
+        out = fz_new_output(ctx, 8192, &state, job_output_write, NULL, NULL);
+        out->tell = job_output_tell;
+        w.out = out;
 
-    mino_clear_error();
-    fz_page *page = NULL;
+        stream_document(ctx, &w, window_pages > 0 ? window_pages : STREAM_WINDOW_PAGES);
+        fz_close_output(ctx, out);
+        fz_close_output(ctx, file);
+        report_progress(job, MINO_PHASE_WRITE, xref_len, xref_len);
 
-    fz_try(ctx) {
-        page = fz_load_page(ctx, doc, page_number);
-        fz_rect bounds = fz_bound_page(ctx, page);
-        *width = bounds.x1 - bounds.x0;
-        *height = bounds.y1 - bounds.y0;
+        mino_job_stats *stats = job_stats(job);
+        if (stats) {
+            stats->write_ns += now_ns() - start - (stats->images_ns - images_before);
+            stats->bytes_out += state.written;
+        }
     }
     fz_always(ctx) {
-        fz_drop_page(ctx, page);
+        fz_drop_output(ctx, out);
+        fz_drop_output(ctx, file);
+        for (int i = 0; i < w.image_count; i++) {
+            release_candidate(ctx, &w.images[i]);
+        }
+        fz_free(ctx, w.images);
+        fz_free(ctx, w.stack);
+        fz_free(ctx, w.offsets);
+        fz_free(ctx, w.state);
+        fz_free(ctx, min_dpi);
+        stats_end(job, &mark);
     }
     fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        return -1;
-    }
-
-    return 0;
-}
-
-// Drop pixmap
-void mino_drop_pixmap(fz_context *ctx, fz_pixmap *pix) {
-    if (ctx && pix) {
-        fz_drop_pixmap(ctx, pix);
+        if (opened) remove(output_path);
+        return caught_status(ctx, job);
     }
-}
-
-// Pixmap data accessors
-int mino_pixmap_width(fz_context *ctx, fz_pixmap *pix) {
-    if (!ctx || !pix) return 0;
-    return fz_pixmap_width(ctx, pix);
-}
-
-int mino_pixmap_height(fz_context *ctx, fz_pixmap *pix) {
-    if (!ctx || !pix) return 0;
-    return fz_pixmap_height(ctx, pix);
-}
-
-unsigned char* mino_pixmap_samples(fz_context *ctx, fz_pixmap *pix) {
-    if (!ctx || !pix) return NULL;
-    return fz_pixmap_samples(ctx, pix);
-}
 
-int mino_pixmap_stride(fz_context *ctx, fz_pixmap *pix) {
-    if (!ctx || !pix) return 0;
-    return fz_pixmap_stride(ctx, pix);
+    return MINO_STATUS_OK;
 }
 
 // MARK: - PDF Merge/Split Operations
@@ -492,14 +5085,28 @@ int mino_save_pdf(
     pdf_document *doc,
     const char *output_path,
     int garbage_level
+) {
+    return mino_save_pdf_job(ctx, doc, output_path, garbage_level, NULL);
+}
+
+// Save a PDF document to file with progress reporting and cancellation
+int mino_save_pdf_job(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int garbage_level,
+    mino_job *job
 ) {
     if (!ctx || !doc || !output_path) {
         set_error("Invalid parameters for save");
-        return -1;
+        return MINO_STATUS_ERROR;
     }
 
     mino_clear_error();
 
+    stats_mark mark;
+    stats_begin(job, &mark);
+
     fz_try(ctx) {
         pdf_write_options opts = pdf_default_write_options;
         opts.do_garbage = garbage_level;
@@ -511,14 +5118,16 @@ int mino_save_pdf(
         opts.do_linear = 0;
         opts.do_appearance = 0;
 
-        pdf_save_document(ctx, doc, output_path, &opts);
+        save_pdf(ctx, doc, output_path, &opts, job);
+    }
+    fz_always(ctx) {
+        stats_end(job, &mark);
     }
     fz_catch(ctx) {
-        set_error(fz_caught_message(ctx));
-        return -1;
+        return caught_status(ctx, job);
     }
 
-    return 0;
+    return MINO_STATUS_OK;
 }
 
 // Get page count from a pdf_document
@@ -538,3 +5147,219 @@ int mino_pdf_count_pages(fz_context *ctx, pdf_document *doc) {
 
     return count;
 }
+
+// MARK: - Batch Compression
+
+struct mino_batch {
+    mino_batch_options options;
+    int cancelled;          // Set atomically by mino_batch_cancel
+    pthread_mutex_t mutex;  // Guards cookies
+    fz_cookie *cookies;     // One per item while a run is in progress
+    int cookie_count;
+};
+
+typedef struct {
+    mino_batch *batch;
+    const mino_batch_item *items;
+    mino_batch_started_fn started;
+    mino_batch_progress_fn progress;
+    mino_batch_finished_fn finished;
+    void *user;
+} batch_run;
+
+typedef struct {
+    batch_run *run;
+    int index;
+} batch_progress;
+
+static void batch_item_progress(void *user, int phase, int done, int total) {
+    batch_progress *item = user;
+    item->run->progress(item->run->user, item->index, phase, done, total);
+}
+
+// Open, compress and close a single file on the given context
+static int compress_file(
+    fz_context *ctx,
+    const char *input_path,
+    const char *output_path,
+    const mino_batch_options *opts,
+    mino_job *job
+) {
+    fz_document *doc = mino_open_document_job(ctx, input_path, job);
+    if (!doc) {
+        return MINO_STATUS_ERROR;
+    }
+
+    int result = MINO_STATUS_ERROR;
+    pdf_document *pdf = mino_pdf_specifics(ctx, doc);
+    if (pdf && mino_pdf_count_pages(ctx, pdf) >= MINO_STREAMING_PAGE_THRESHOLD) {
+        result = mino_compress_pdf_streaming(
+            ctx, pdf, output_path,
+            opts->jpeg_quality, opts->target_dpi, opts->garbage_level, 0,
+            job
+        );
+    } else if (pdf) {
+        result = mino_compress_pdf_job(
+            ctx, pdf, output_path,
+            opts->jpeg_quality, opts->target_dpi, opts->garbage_level,
+            job
+        );
+    } else {
+        set_error("The file is not a valid PDF document");
+    }
+
+    mino_drop_document(ctx, doc);
+    return result;
+}
+
+static void batch_job(fz_context *ctx, void *arg, int index) {
+    batch_run *run = arg;
+    const mino_batch_item *item = &run->items[index];
+
+    if (run->started) {
+        run->started(run->user, index);
+    }
+
+    // Documents already run side by side, so each gets a share of the cores
+    // for its image stages rather than a thread per core
+    int workers = run->batch->options.max_workers > 0 ? run->batch->options.max_workers : available_cores();
+    int threads = available_cores() / workers;
+
+    batch_progress progress = { run, index };
+    mino_job_stats stats = {0};
+    mino_job job = {
+        .cookie = &run->batch->cookies[index],
+        .progress = run->progress ? batch_item_progress : NULL,
+        .progress_user = &progress,
+        .stats = &stats,
+        .image_cache = run->batch->options.image_cache,
+        .image_replace = run->batch->options.image_replace,
+        .size_ceiling = run->batch->options.abort_without_gain ? mino_get_file_size(item->input_path) : 0,
+        .threads = threads > 1 ? threads : 1,
+    };
+
+    mino_clear_error();
+    int64_t start = now_ns();
+    int status;
+    if (job_aborted(&job)) {
+        // Cancelled before it was dispatched
+        set_error("Operation cancelled");
+        status = MINO_STATUS_CANCELLED;
+    } else {
+        status = compress_file(ctx, item->input_path, item->output_path, &run->batch->options, &job);
+    }
+
+    int64_t output_size = -1;
+    if (status == MINO_STATUS_OK) {
+        output_size = mino_get_file_size(item->output_path);
+        if (output_size < 0) {
+            set_error("Could not verify output file");
+            status = MINO_STATUS_ERROR;
+        }
+    }
+
+    const char *error = NULL;
+    if (status != 0) {
+        error = mino_get_last_error();
+        if (!error) error = "Unknown compression error";
+    }
+
+    if (run->finished) {
+        run->finished(run->user, index, status, output_size, now_ns() - start, &stats, error);
+    }
+}
+
+// Create a batch with the given options
+mino_batch* mino_batch_create(const mino_batch_options *options) {
+    if (!options) {
+        set_error("Invalid batch options");
+        return NULL;
+    }
+
+    mino_batch *batch = calloc(1, sizeof(*batch));
+    if (!batch) {
+        set_error("Failed to allocate batch");
+        return NULL;
+    }
+
+    batch->options = *options;
+    pthread_mutex_init(&batch->mutex, NULL);
+    return batch;
+}
+
+// Compress all items, blocking until every dispatched item has finished
+int mino_batch_run(
+    mino_batch *batch,
+    const mino_batch_item *items,
+    int count,
+    mino_batch_started_fn started,
+    mino_batch_progress_fn progress,
+    mino_batch_finished_fn finished,
+    void *user
+) {
+    if (!batch || count < 0 || (count > 0 && !items)) {
+        set_error("Invalid batch parameters");
+        return -1;
+    }
+
+    fz_cookie *cookies = calloc(count > 0 ? (size_t)count : 1, sizeof(fz_cookie));
+    if (!cookies) {
+        set_error("Failed to allocate batch");
+        return -1;
+    }
+
+    mino_clear_error();
+
+    pthread_mutex_lock(&batch->mutex);
+    batch->cookies = cookies;
+    batch->cookie_count = count;
+    if (__atomic_load_n(&batch->cancelled, __ATOMIC_ACQUIRE)) {
+        for (int i = 0; i < count; i++) {
+            mino_abort_cookie(&cookies[i]);
+        }
+    }
+    pthread_mutex_unlock(&batch->mutex);
+
+    batch_run run = { batch, items, started, progress, finished, user };
+    run_workers(NULL, batch->options.max_workers, count, &batch->cancelled, batch_job, &run);
+
+    pthread_mutex_lock(&batch->mutex);
+    batch->cookies = NULL;
+    batch->cookie_count = 0;
+    pthread_mutex_unlock(&batch->mutex);
+
+    free(cookies);
+    return 0;
+}
+
+// Stop dispatching new items and abort those in flight
+void mino_batch_cancel(mino_batch *batch) {
+    if (!batch) return;
+
+    __atomic_store_n(&batch->cancelled, 1, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&batch->mutex);
+    for (int i = 0; i < batch->cookie_count; i++) {
+        mino_abort_cookie(&batch->cookies[i]);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+}
+
+// Abort a single item, whether it is running or still waiting
+void mino_batch_cancel_item(mino_batch *batch, int index) {
+    if (!batch) return;
+
+    pthread_mutex_lock(&batch->mutex);
+    if (index >= 0 && index < batch->cookie_count) {
+        mino_abort_cookie(&batch->cookies[index]);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+}
+
+// Free a batch
+void mino_batch_drop(mino_batch *batch) {
+    if (!batch) return;
+
+    pthread_mutex_destroy(&batch->mutex);
+    free(batch);
+}
@@ -18,10 +18,154 @@ extern "C" {
 
 // Context management
 fz_context* mino_create_context(void);
+
+// Create a context that, together with its clones, never holds more than
+// max_bytes (0 for no limit). Allocations over the limit first make MuPDF
+// evict cached resources from the store and fail only when nothing more can
+// be evicted, so jobs fail with an error instead of the process being killed.
+fz_context* mino_create_context_with_budget(size_t max_bytes);
+
+// Drop a context from mino_create_context*, after every clone of it
 void mino_drop_context(fz_context *ctx);
 
+// Memory use of a budgeted context family
+typedef struct {
+    int64_t limit_bytes;
+    int64_t in_use_bytes;
+    int64_t peak_bytes;         // Highest use since the context was created
+    int scavenges;              // Allocations refused so the store would evict
+} mino_memory_stats;
+
+// Fills stats for ctx or any clone of it; returns -1 if it has no budget
+int mino_context_memory(fz_context *ctx, mino_memory_stats *stats);
+
+// Context pool
+// Pooled contexts are cloned from a locked master and share its resource
+// store, so back-to-back jobs reuse warm font, colorspace and image caches.
+typedef struct mino_context_pool mino_context_pool;
+
+// capacity: maximum number of idle contexts kept (<= 0 for one per CPU core)
+mino_context_pool* mino_context_pool_create(int capacity);
+
+// As above, with every context of the pool sharing one budget (0 for no limit)
+mino_context_pool* mino_context_pool_create_with_budget(int capacity, size_t max_bytes);
+void mino_context_pool_drop(mino_context_pool *pool);
+fz_context* mino_context_pool_acquire(mino_context_pool *pool);
+void mino_context_pool_release(mino_context_pool *pool, fz_context *ctx);
+
+// Acquire/release a context from the process-wide shared pool
+fz_context* mino_acquire_context(void);
+void mino_release_context(fz_context *ctx);
+
+// Limit the shared pool to max_bytes. Must be called before the first
+// mino_acquire_context; returns -1 afterwards.
+int mino_set_shared_memory_budget(size_t max_bytes);
+
+// Jobs
+// Status codes returned by job-aware operations
+typedef enum {
+    MINO_STATUS_OK = 0,
+    MINO_STATUS_ERROR = -1,
+    MINO_STATUS_CANCELLED = -2,
+    MINO_STATUS_NO_GAIN = -3        // Output would reach the job's size ceiling; nothing was kept
+} mino_status;
+
+// Phases reported to a job's progress callback
+typedef enum {
+    MINO_PHASE_SCAN = 0,        // Interpreting pages to find image resolutions
+    MINO_PHASE_IMAGES = 1,      // Recompressing images (done/total are images)
+    MINO_PHASE_WRITE = 2,       // Writing output (done/total are objects)
+    MINO_PHASE_RENDER = 3
+} mino_phase;
+
+// Called on the thread running the job; keep it cheap
+typedef void (*mino_progress_fn)(void *user, int phase, int done, int total);
+
+// Measurements filled in by job-aware operations. Fields accumulate, so one
+// struct can cover several calls (zero it before the first).
+typedef struct {
+    int64_t open_ns;            // Opening the document and reading its xref
+    int64_t repair_ns;          // Part of open_ns spent on documents whose xref was rebuilt
+    int64_t scan_ns;            // Interpreting pages to find image resolutions
+    int64_t images_ns;          // Decoding, downsampling and re-encoding images
+    int64_t gc_ns;              // Garbage collection and renumbering before the first byte
+    int64_t write_ns;           // Serializing the output
+    int64_t render_ns;          // Rasterizing pages
+    int64_t estimate_ns;        // Sampling images to predict output size
+    int images_rewritten;
+    int images_deduplicated;    // Duplicate images merged into another before rewriting
+    int image_cache_hits;       // Recompressed images loaded from the image cache
+    int images_kept;            // Images left as they were because re-encoding did not shrink them
+    int display_list_hits;      // Renders that replayed a cached display list
+    int64_t bytes_in;           // Size of the documents opened
+    int64_t image_bytes_in;     // Encoded size of the images that were replaced
+    int64_t image_bytes_out;    // Encoded size of their replacements
+    int64_t bytes_out;          // Bytes written (or pixmap bytes when rendering)
+    int64_t peak_heap_bytes;    // Highest engine heap use, across all contexts, while measured
+    int store_evictions;        // Allocations that had to evict cached resources first
+} mino_job_stats;
+
+// Persistent cache of recompressed image streams, shared by any number of
+// jobs and threads
+typedef struct mino_image_cache mino_image_cache;
+
+// Open (creating the directory if needed) a cache holding at most max_bytes.
+// Returns NULL on failure
+mino_image_cache* mino_image_cache_open(const char *directory, int64_t max_bytes);
+void mino_image_cache_close(mino_image_cache *cache);
+
+// Bytes currently on disk
+int64_t mino_image_cache_size(mino_image_cache *cache);
+
+// Delete every entry
+void mino_image_cache_clear(mino_image_cache *cache);
+
+// When a recompressed image replaces the original. Options left zeroed
+// replace always; callers opt in to keeping originals that would not shrink.
+typedef enum {
+    MINO_REPLACE_ALWAYS = 0,        // Even when the new stream is larger
+    MINO_REPLACE_IF_SMALLER = 1     // Only when the new stream is smaller
+} mino_replace_policy;
+
+// Optional per-operation state. The cookie may be aborted from any thread to
+// cancel the operation, which then returns MINO_STATUS_CANCELLED.
+typedef struct {
+    fz_cookie *cookie;
+    mino_progress_fn progress;
+    void *progress_user;
+    mino_job_stats *stats;      // Optional
+    mino_image_cache *image_cache;  // Optional; consulted when recompressing images
+    mino_replace_policy image_replace;  // When recompressed images replace the originals
+    int64_t size_ceiling;       // Stop writing with MINO_STATUS_NO_GAIN once the output
+                                // is certain to reach this many bytes (0 for no limit)
+    int threads;                // Worker threads for image stages (<= 0 for one per core)
+} mino_job;
+
+// Cookies are plain allocations so they can outlive any context
+fz_cookie* mino_new_cookie(void);
+void mino_drop_cookie(fz_cookie *cookie);
+void mino_abort_cookie(fz_cookie *cookie);
+int mino_cookie_aborted(const fz_cookie *cookie);
+
+// Bytes currently allocated by all Mino contexts
+size_t mino_heap_in_use(void);
+
 // Document operations
 fz_document* mino_open_document(fz_context *ctx, const char *path);
+
+// Open a document, adding open time, repair time and input size to job->stats
+fz_document* mino_open_document_job(fz_context *ctx, const char *path, mino_job *job);
+// Open a PDF held in memory without copying it. The block must stay valid
+// until the document is dropped.
+fz_document* mino_open_document_from_memory(
+    fz_context *ctx,
+    const unsigned char *data,
+    size_t length
+);
+
+// Open a PDF through a read-only memory mapping instead of buffered file I/O
+fz_document* mino_open_document_mapped(fz_context *ctx, const char *path);
+
 void mino_drop_document(fz_context *ctx, fz_document *doc);
 int mino_count_pages(fz_context *ctx, fz_document *doc);
 pdf_document* mino_pdf_specifics(fz_context *ctx, fz_document *doc);
@@ -36,7 +180,126 @@ int mino_compress_pdf(
     int garbage_level
 );
 
+// Returns a mino_status; job may be NULL
+int mino_compress_pdf_job(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    mino_job *job
+);
+
+// Compress into memory instead of a file. On success *data and *length hold
+// the output, which the caller frees with mino_free_buffer_data (using any
+// context sharing ctx's allocator). Returns a mino_status; job may be NULL
+int mino_compress_pdf_to_buffer(
+    fz_context *ctx,
+    pdf_document *doc,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    unsigned char **data,
+    size_t *length,
+    mino_job *job
+);
+
+void mino_free_buffer_data(fz_context *ctx, unsigned char *data);
+
+// Documents with at least this many pages are best compressed streaming
+#define MINO_STREAMING_PAGE_THRESHOLD 400
+
+// Compress without holding the whole document in memory: pages are written
+// window_pages at a time (<= 0 for the default), each window's objects
+// flushed to the output and dropped before the next. Peak memory depends on
+// the largest window, not the page count. The document is not modified.
+// Objects keep their numbers and content streams are copied rather than
+// cleaned. A garbage_level of 0 writes every object; any higher level writes
+// only reachable ones, since renumbering and merging duplicate objects would
+// need the whole document. Encrypted documents fall back to
+// mino_compress_pdf_job at garbage_level. Returns a mino_status; job may be NULL
+int mino_compress_pdf_streaming(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int jpeg_quality,
+    int target_dpi,
+    int garbage_level,
+    int window_pages,
+    mino_job *job
+);
+
+// Size estimation
+typedef struct {
+    int jpeg_quality;           // Settings to evaluate
+    int target_dpi;
+    int64_t predicted_bytes;    // Filled in: predicted output size
+    int64_t error_bytes;        // Filled in: half-width of an approximate 95% interval
+} mino_size_estimate;
+
+// Predict the compressed size for each setting in estimates without writing
+// a file or modifying the document. Pages are scanned, duplicate images are
+// counted once as compression merges them, and a sample of the images is
+// decoded once for all settings at the highest target_dpi among them;
+// non-image bytes are measured from the objects that survive garbage
+// collection. Returns a mino_status; job may be NULL
+int mino_estimate_compression(
+    fz_context *ctx,
+    pdf_document *doc,
+    mino_size_estimate *estimates,
+    int count,
+    mino_job *job
+);
+
+// Outcome of a size-targeted compression
+typedef struct {
+    int64_t target_bytes;
+    int64_t predicted_bytes;    // Predicted size at the chosen settings
+    int64_t actual_bytes;       // Size of the file written
+    int jpeg_quality;           // Chosen settings
+    int target_dpi;
+    int probes;                 // Settings evaluated on the image sample
+    int sampled_images;
+    int target_met;             // actual_bytes <= target_bytes
+} mino_size_result;
+
+// Compress to fit within target_bytes. JPEG quality and target DPI are
+// searched on a sample of the images, decoded once and re-encoded per probe;
+// the document is then compressed once with the best setting predicted to
+// fit, or the smallest setting if none does. Returns a mino_status; job may be NULL
+int mino_compress_pdf_to_size(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int64_t target_bytes,
+    int garbage_level,
+    mino_size_result *result,
+    mino_job *job
+);
+
 // Image rewriting
+
+typedef struct {
+    int jpeg_quality;       // JPEG quality for recompressed images (1-100)
+    int target_dpi;         // Resolution images are downsampled to
+    int dpi_threshold;      // Only images drawn above this DPI are downsampled
+    int threads;            // Worker threads for decode/encode (<= 0 for one per core)
+    mino_image_cache *cache;    // Optional; hits skip decoding and encoding
+    mino_replace_policy replace;
+} mino_rewrite_options;
+
+// Recompress every image XObject drawn on a page as JPEG, downsampling those
+// above the threshold. With MINO_REPLACE_IF_SMALLER an image keeps its original
+// stream when the JPEG would not be smaller. Decoding and encoding run in
+// parallel on contexts cloned from ctx; the document itself is only modified on
+// the calling thread.
+int mino_rewrite_images_with_options(
+    fz_context *ctx,
+    pdf_document *doc,
+    const mino_rewrite_options *opts
+);
+
 int mino_rewrite_images(
     fz_context *ctx,
     pdf_document *doc,
@@ -45,6 +308,52 @@ int mino_rewrite_images(
     int dpi_threshold
 );
 
+// Document analysis
+//
+// Image columns are parallel arrays of image_count entries, one per image
+// XObject. String columns hold offsets of NUL-terminated strings in `strings`.
+typedef struct {
+    int image_count;
+    int *object_num;
+    int *width;
+    int *height;
+    int *bits_per_component;    // 1 for image masks, 0 when the stream carries it (JPX)
+    int *colorspace;            // Colorspace family, e.g. "DeviceRGB", "ICCBased"; "" if none
+    int *filters;               // Filter chain separated by spaces; "" if unfiltered
+    int64_t *stream_bytes;      // Encoded size
+    float *effective_dpi;       // Lowest DPI it is drawn at (its largest use); 0 if never drawn
+    int *use_count;             // Number of times it is drawn across all pages
+    unsigned char *rewritable;  // Whether compression can recompress it as JPEG
+    char *strings;
+    int strings_length;
+
+    // Totals
+    int page_count;
+    int64_t file_bytes;
+    int64_t image_bytes;
+    int64_t rewritable_image_bytes; // Images compression would recompress
+    int font_count;             // Font dictionaries
+    int font_file_count;        // Embedded font programs
+    int64_t font_bytes;
+    int content_stream_count;   // Page contents and form XObjects
+    int64_t content_bytes;
+    int64_t metadata_bytes;     // XMP metadata streams
+    int64_t other_stream_bytes;
+} mino_document_analysis;
+
+// Inventory the images and stream bytes of a document without modifying it.
+// Pages are run once to find where images are drawn; nothing is decoded.
+// On success the analysis must be released with mino_drop_document_analysis.
+// Returns a mino_status; job may be NULL
+int mino_analyze_document(
+    fz_context *ctx,
+    pdf_document *doc,
+    mino_document_analysis *analysis,
+    mino_job *job
+);
+
+void mino_drop_document_analysis(fz_context *ctx, mino_document_analysis *analysis);
+
 // File utilities
 int64_t mino_get_file_size(const char *path);
 
@@ -56,6 +365,15 @@ fz_pixmap* mino_render_page(
     float zoom
 );
 
+// Returns NULL with "Operation cancelled" as the error if the job is aborted
+fz_pixmap* mino_render_page_job(
+    fz_context *ctx,
+    fz_document *doc,
+    int page_number,
+    float zoom,
+    mino_job *job
+);
+
 int mino_get_page_size(
     fz_context *ctx,
     fz_document *doc,
@@ -72,6 +390,123 @@ int mino_pixmap_height(fz_context *ctx, fz_pixmap *pix);
 unsigned char* mino_pixmap_samples(fz_context *ctx, fz_pixmap *pix);
 int mino_pixmap_stride(fz_context *ctx, fz_pixmap *pix);
 
+// Returns 0 on success, -1 on error
+int mino_save_pixmap_png(fz_context *ctx, fz_pixmap *pix, const char *path);
+
+// Concurrent rendering
+// A renderer opens a document once and renders its pages from any number of
+// threads. Pages are interpreted one at a time under the renderer's lock,
+// then rasterized in parallel on the caller's context. Each page's display
+// list is cached, so later renders at any zoom replay it without parsing.
+typedef struct mino_renderer mino_renderer;
+
+// Default heap allowed for a renderer's cached display lists
+#define MINO_DISPLAY_LIST_BUDGET (32 * 1024 * 1024)
+
+// Holds one context from the shared pool until dropped, for lookups and
+// teardown; returns NULL on error
+mino_renderer* mino_renderer_open(const char *path);
+
+// Drop the document; later calls fail. Safe while other threads render.
+void mino_renderer_close(mino_renderer *renderer);
+
+// Close and free. No other thread may still be using the renderer.
+void mino_renderer_drop(mino_renderer *renderer);
+
+// Least recently rendered lists are dropped to stay within max_bytes;
+// 0 disables the cache
+void mino_renderer_set_list_budget(mino_renderer *renderer, size_t max_bytes);
+
+int mino_renderer_page_count(const mino_renderer *renderer);
+
+// Returns 0 on success, -1 on error
+int mino_renderer_page_size(
+    mino_renderer *renderer,
+    int page_number,
+    float *width,
+    float *height
+);
+
+// Pixel dimensions of the page rendered at zoom. Returns 0 or -1 on error.
+int mino_renderer_pixel_size(
+    mino_renderer *renderer,
+    int page_number,
+    float zoom,
+    int *width,
+    int *height
+);
+
+// ctx is the calling thread's own context, e.g. from mino_acquire_context,
+// and is used to drop the pixmap. Returns NULL on error or cancellation.
+fz_pixmap* mino_renderer_render_page(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    mino_job *job
+);
+
+// Render only the tile, given in device pixels at zoom (the page spans
+// 0,0 to its size times zoom). The pixmap is exactly the tile's size and
+// origin, so deep zoom needs memory for the visible tiles alone. Tiles of
+// one page may be rendered in parallel.
+fz_pixmap* mino_renderer_render_tile(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    fz_irect tile,
+    mino_job *job
+);
+
+// Rendering into caller memory
+// Rows may be padded: stride is at least width times the format's pixel size,
+// and capacity at least stride * height.
+#define MINO_RENDER_ROW_ALIGNMENT 64
+
+// Pixel layouts a render into caller memory can produce. Opaque formats are
+// drawn without alpha, which is faster as well as smaller.
+typedef enum {
+    MINO_PIXEL_RGBA = 0,    // 4 bytes, premultiplied alpha
+    MINO_PIXEL_RGB,         // 3 bytes, opaque
+    MINO_PIXEL_BGRA,        // 4 bytes, premultiplied alpha; the native iOS layout
+    MINO_PIXEL_GRAY8,       // 1 byte, opaque
+    MINO_PIXEL_RGB565       // 2 bytes, opaque, 5:6:5 bits packed in a native-endian uint16_t
+} mino_pixel_format;
+
+// Bytes per pixel, or 0 for an unknown format
+int mino_pixel_bytes(mino_pixel_format format);
+
+// Smallest stride for width pixels that keeps rows MINO_RENDER_ROW_ALIGNMENT aligned
+int mino_render_stride(int width, mino_pixel_format format);
+
+// Draw the page straight into samples, sized with mino_renderer_pixel_size.
+// Nothing else is allocated for the pixels. Returns a mino_status.
+int mino_renderer_render_page_into(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    unsigned char *samples,
+    int stride,
+    size_t capacity,
+    mino_pixel_format format,
+    mino_job *job
+);
+
+int mino_renderer_render_tile_into(
+    mino_renderer *renderer,
+    fz_context *ctx,
+    int page_number,
+    float zoom,
+    fz_irect tile,
+    unsigned char *samples,
+    int stride,
+    size_t capacity,
+    mino_pixel_format format,
+    mino_job *job
+);
+
 // Error handling
 const char* mino_get_last_error(void);
 void mino_clear_error(void);
@@ -123,9 +558,76 @@ int mino_save_pdf(
     int garbage_level
 );
 
+// Returns a mino_status; job may be NULL
+int mino_save_pdf_job(
+    fz_context *ctx,
+    pdf_document *doc,
+    const char *output_path,
+    int garbage_level,
+    mino_job *job
+);
+
 // Get page count from a pdf_document (not fz_document)
 int mino_pdf_count_pages(fz_context *ctx, pdf_document *doc);
 
+// MARK: - Batch Compression
+
+// A single document in a batch
+typedef struct {
+    const char *input_path;
+    const char *output_path;
+} mino_batch_item;
+
+typedef struct {
+    int jpeg_quality;
+    int target_dpi;
+    int garbage_level;
+    int max_workers;        // Documents compressed at once (<= 0 for one per core)
+    mino_image_cache *image_cache;  // Optional, shared by every item
+    int abort_without_gain;     // Use each input's size as its ceiling (MINO_STATUS_NO_GAIN)
+    mino_replace_policy image_replace;  // When recompressed images replace the originals
+} mino_batch_options;
+
+// Callbacks are invoked from worker threads as items start, progress and
+// finish. status is a mino_status (error holds the message when non-zero).
+typedef void (*mino_batch_started_fn)(void *user, int index);
+typedef void (*mino_batch_progress_fn)(void *user, int index, int phase, int done, int total);
+typedef void (*mino_batch_finished_fn)(
+    void *user,
+    int index,
+    int status,
+    int64_t output_size,
+    int64_t duration_ns,
+    const mino_job_stats *stats,
+    const char *error
+);
+
+typedef struct mino_batch mino_batch;
+
+mino_batch* mino_batch_create(const mino_batch_options *options);
+
+// Compress all items on a bounded pool of workers, each owning a pooled
+// context. Blocks until every dispatched item has finished.
+// Returns 0 on success, -1 on invalid parameters
+int mino_batch_run(
+    mino_batch *batch,
+    const mino_batch_item *items,
+    int count,
+    mino_batch_started_fn started,
+    mino_batch_progress_fn progress,
+    mino_batch_finished_fn finished,
+    void *user
+);
+
+// Stop dispatching new items and abort those in flight; safe to call from
+// any thread. Aborted items finish with MINO_STATUS_CANCELLED.
+void mino_batch_cancel(mino_batch *batch);
+
+// Abort one item of the current run, running or not yet started
+void mino_batch_cancel_item(mino_batch *batch, int index);
+
+void mino_batch_drop(mino_batch *batch);
+
 #ifdef __cplusplus
 }
 #endif
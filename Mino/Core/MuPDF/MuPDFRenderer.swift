@@ -7,70 +7,94 @@
 
 import UIKit
 
-/// Renders PDF pages to UIImage using MuPDF
+/// Pixel layout of rendered images
+enum RenderPixelFormat: Sendable {
+    /// Premultiplied RGBA
+    case rgba
+    /// Opaque RGB, 3 bytes per pixel
+    case rgb
+    /// Premultiplied BGRA, the layout Core Animation draws without converting
+    case bgra
+    /// Opaque 8-bit grayscale, a quarter of the memory of RGBA
+    case gray
+
+    nonisolated var engineFormat: mino_pixel_format {
+        switch self {
+        case .rgba: return MINO_PIXEL_RGBA
+        case .rgb: return MINO_PIXEL_RGB
+        case .bgra: return MINO_PIXEL_BGRA
+        case .gray: return MINO_PIXEL_GRAY8
+        }
+    }
+
+    nonisolated var bitsPerPixel: Int {
+        Int(mino_pixel_bytes(engineFormat)) * 8
+    }
+
+    nonisolated var colorSpace: CGColorSpace {
+        self == .gray ? CGColorSpaceCreateDeviceGray() : CGColorSpaceCreateDeviceRGB()
+    }
+
+    nonisolated var bitmapInfo: CGBitmapInfo {
+        switch self {
+        case .rgba:
+            return CGBitmapInfo(rawValue: CGImageAlphaInfo.premultipliedLast.rawValue)
+        case .rgb, .gray:
+            return CGBitmapInfo(rawValue: CGImageAlphaInfo.none.rawValue)
+        case .bgra:
+            return CGBitmapInfo(rawValue: CGImageAlphaInfo.premultipliedFirst.rawValue)
+                .union(.byteOrder32Little)
+        }
+    }
+}
+
+/// Renders PDF pages to UIImage using MuPDF.
+/// Safe to call from several threads at once: each call renders on its own
+/// pooled context, so pages rasterize in parallel.
 final class MuPDFRenderer: @unchecked Sendable {
 
     // MARK: - Properties
 
-    private var context: UnsafeMutablePointer<fz_context>?
-    private var document: UnsafeMutablePointer<fz_document>?
-    private let lock = NSLock()
+    private let renderer: OpaquePointer
     private let documentURL: URL
+    private let bufferPool: RenderBufferPool
 
     /// Number of pages in the document
     let pageCount: Int
 
     // MARK: - Initialization
 
-    init(url: URL) throws {
+    nonisolated init(url: URL, bufferPool: RenderBufferPool = .shared) throws {
         self.documentURL = url
+        self.bufferPool = bufferPool
 
-        context = mino_create_context()
-        guard let ctx = context else {
-            throw MuPDFError.contextCreationFailed
-        }
-
-        document = mino_open_document(ctx, url.path)
-        guard document != nil else {
-            mino_drop_context(ctx)
-            context = nil
+        guard let renderer = mino_renderer_open(url.path) else {
             let errorMsg = String(cString: mino_get_last_error() ?? "Unknown error".withCString { $0 })
             throw MuPDFError.documentOpenFailed(path: url.path, reason: errorMsg)
         }
 
-        pageCount = Int(mino_count_pages(ctx, document))
+        self.renderer = renderer
+        pageCount = Int(mino_renderer_page_count(renderer))
     }
 
     deinit {
-        close()
+        mino_renderer_drop(renderer)
     }
 
     // MARK: - Public Methods
 
     /// Closes the document and releases resources
-    func close() {
-        lock.lock()
-        defer { lock.unlock() }
-
-        if let ctx = context, let doc = document {
-            mino_drop_document(ctx, doc)
-            mino_drop_context(ctx)
-        }
-        context = nil
-        document = nil
+    nonisolated func close() {
+        mino_renderer_close(renderer)
     }
 
     /// Gets the size of a page at the given index
-    func pageSize(at index: Int) -> CGSize {
-        lock.lock()
-        defer { lock.unlock() }
-
-        guard let ctx = context, let doc = document else { return .zero }
+    nonisolated func pageSize(at index: Int) -> CGSize {
         guard index >= 0 && index < pageCount else { return .zero }
 
         var width: Float = 0
         var height: Float = 0
-        let result = mino_get_page_size(ctx, doc, Int32(index), &width, &height)
+        let result = mino_renderer_page_size(renderer, Int32(index), &width, &height)
 
         if result == 0 {
             return CGSize(width: CGFloat(width), height: CGFloat(height))
@@ -79,47 +103,106 @@ final class MuPDFRenderer: @unchecked Sendable {
     }
 
     /// Renders a page at the given index with the specified zoom level
-    func renderPage(at index: Int, zoom: CGFloat = 1.0) -> UIImage? {
-        lock.lock()
-        defer { lock.unlock() }
-
-        guard let ctx = context, let doc = document else { return nil }
+    nonisolated func renderPage(
+        at index: Int,
+        zoom: CGFloat = 1.0,
+        format: RenderPixelFormat = .bgra
+    ) -> UIImage? {
         guard index >= 0 && index < pageCount else { return nil }
 
-        // Render page to pixmap
-        guard let pixmap = mino_render_page(ctx, doc, Int32(index), Float(zoom)) else {
+        var width: Int32 = 0
+        var height: Int32 = 0
+        guard mino_renderer_pixel_size(renderer, Int32(index), Float(zoom), &width, &height) == 0 else {
             return nil
         }
-        defer { mino_drop_pixmap(ctx, pixmap) }
 
-        // Get pixmap dimensions
-        let width = Int(mino_pixmap_width(ctx, pixmap))
-        let height = Int(mino_pixmap_height(ctx, pixmap))
-        let stride = Int(mino_pixmap_stride(ctx, pixmap))
+        return render(width: Int(width), height: Int(height), format: format) { ctx, samples, stride, capacity in
+            mino_renderer_render_page_into(
+                renderer, ctx, Int32(index), Float(zoom), samples, stride, capacity, format.engineFormat, nil
+            )
+        }
+    }
 
-        guard let samples = mino_pixmap_samples(ctx, pixmap) else {
-            return nil
+    /// Renders only part of a page for tiled deep zoom. `tile` is in pixels
+    /// at `zoom`, where the page spans (0, 0) to its size times zoom; the
+    /// image is exactly the tile's size, white wherever it lies off the page.
+    nonisolated func renderTile(
+        at index: Int,
+        zoom: CGFloat,
+        tile: CGRect,
+        format: RenderPixelFormat = .bgra
+    ) -> UIImage? {
+        guard index >= 0 && index < pageCount else { return nil }
+
+        let rect = tile.integral
+        guard !rect.isEmpty else { return nil }
+
+        let bbox = fz_irect(
+            x0: Int32(rect.minX),
+            y0: Int32(rect.minY),
+            x1: Int32(rect.maxX),
+            y1: Int32(rect.maxY)
+        )
+        return render(width: Int(rect.width), height: Int(rect.height), format: format) { ctx, samples, stride, capacity in
+            mino_renderer_render_tile_into(
+                renderer, ctx, Int32(index), Float(zoom), bbox, samples, stride, capacity, format.engineFormat, nil
+            )
         }
+    }
+
+    /// Renders a thumbnail for a page (lower resolution for performance).
+    /// Thumbnails are opaque, so RGB saves a quarter of the memory by default.
+    nonisolated func renderThumbnail(
+        at index: Int,
+        maxSize: CGFloat = 150,
+        format: RenderPixelFormat = .rgb
+    ) -> UIImage? {
+        let pageSize = self.pageSize(at: index)
+        guard pageSize.width > 0 && pageSize.height > 0 else { return nil }
+
+        let scale = min(maxSize / pageSize.width, maxSize / pageSize.height)
+        return renderPage(at: index, zoom: scale, format: format)
+    }
+
+    // MARK: - Private Methods
 
-        // Create CGImage from pixmap data
+    /// Draws into a pooled buffer and wraps it as an image without copying;
+    /// the buffer returns to the pool once the image is released
+    nonisolated private func render(
+        width: Int,
+        height: Int,
+        format: RenderPixelFormat,
+        draw: (UnsafeMutablePointer<fz_context>, UnsafeMutablePointer<UInt8>, Int32, Int) -> Int32
+    ) -> UIImage? {
+        guard width > 0 && height > 0 else { return nil }
+
+        let stride = Int(mino_render_stride(Int32(width), format.engineFormat))
         let dataSize = stride * height
-        let data = Data(bytes: samples, count: dataSize)
+        let buffer = bufferPool.checkout(byteCount: dataSize)
+
+        let result: Int32
+        if let ctx = mino_acquire_context() {
+            let samples = buffer.bytes.assumingMemoryBound(to: UInt8.self)
+            result = draw(ctx, samples, Int32(stride), buffer.capacity)
+            mino_release_context(ctx)
+        } else {
+            result = MINO_STATUS_ERROR.rawValue
+        }
 
-        guard let provider = CGDataProvider(data: data as CFData) else {
+        guard result == MINO_STATUS_OK.rawValue,
+              let provider = bufferPool.dataProvider(for: buffer, size: dataSize) else {
+            bufferPool.checkin(buffer)
             return nil
         }
 
-        // MuPDF returns RGBA data
-        let bitmapInfo = CGBitmapInfo(rawValue: CGImageAlphaInfo.premultipliedLast.rawValue)
-
         guard let cgImage = CGImage(
             width: width,
             height: height,
             bitsPerComponent: 8,
-            bitsPerPixel: 32,
+            bitsPerPixel: format.bitsPerPixel,
             bytesPerRow: stride,
-            space: CGColorSpaceCreateDeviceRGB(),
-            bitmapInfo: bitmapInfo,
+            space: format.colorSpace,
+            bitmapInfo: format.bitmapInfo,
             provider: provider,
             decode: nil,
             shouldInterpolate: true,
@@ -130,13 +213,4 @@ final class MuPDFRenderer: @unchecked Sendable {
 
         return UIImage(cgImage: cgImage)
     }
-
-    /// Renders a thumbnail for a page (lower resolution for performance)
-    func renderThumbnail(at index: Int, maxSize: CGFloat = 150) -> UIImage? {
-        let pageSize = self.pageSize(at: index)
-        guard pageSize.width > 0 && pageSize.height > 0 else { return nil }
-
-        let scale = min(maxSize / pageSize.width, maxSize / pageSize.height)
-        return renderPage(at: index, zoom: scale)
-    }
 }
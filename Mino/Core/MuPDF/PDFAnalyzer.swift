@@ -0,0 +1,239 @@
+//
+//  PDFAnalyzer.swift
+//  Mino
+//
+//  Document inventory: what a PDF spends its bytes on
+//
+
+import Foundation
+
+// MARK: - Analysis Types
+
+/// An image XObject and how it is used
+struct ImageInventoryItem: Sendable, Identifiable {
+    let objectNumber: Int
+    let width: Int
+    let height: Int
+
+    /// 1 for image masks, 0 when the encoded stream carries the depth (JPX)
+    let bitsPerComponent: Int
+
+    /// Colorspace family, e.g. "DeviceRGB" or "ICCBased" (empty for masks)
+    let colorspace: String
+
+    /// Filters in decode order
+    let filters: [String]
+
+    /// Encoded size in bytes
+    let streamBytes: Int64
+
+    /// Lowest resolution the image is drawn at, nil if it is never drawn
+    let effectiveDPI: Double?
+
+    /// Number of times the image is drawn across all pages
+    let useCount: Int
+
+    /// Whether compression can recompress it as JPEG
+    let isRewritable: Bool
+
+    nonisolated var id: Int { objectNumber }
+
+    nonisolated init(
+        objectNumber: Int,
+        width: Int,
+        height: Int,
+        bitsPerComponent: Int,
+        colorspace: String,
+        filters: [String],
+        streamBytes: Int64,
+        effectiveDPI: Double?,
+        useCount: Int,
+        isRewritable: Bool
+    ) {
+        self.objectNumber = objectNumber
+        self.width = width
+        self.height = height
+        self.bitsPerComponent = bitsPerComponent
+        self.colorspace = colorspace
+        self.filters = filters
+        self.streamBytes = streamBytes
+        self.effectiveDPI = effectiveDPI
+        self.useCount = useCount
+        self.isRewritable = isRewritable
+    }
+}
+
+/// How much compression is likely to shrink a document
+enum CompressionOutlook: Sendable {
+    case significant
+    case moderate
+    case minimal
+
+    var message: String {
+        switch self {
+        case .significant:
+            return "Mostly images that can be recompressed. Compression should help a lot."
+        case .moderate:
+            return "Some images can be recompressed. Expect a moderate reduction."
+        case .minimal:
+            return "Mostly text, fonts or vector content. Compression will help little."
+        }
+    }
+}
+
+/// Breakdown of a document's size
+struct DocumentAnalysis: Sendable {
+    let pageCount: Int
+    let fileSize: Int64
+    let images: [ImageInventoryItem]
+
+    /// Encoded size of all image streams
+    let imageBytes: Int64
+
+    /// Part of imageBytes in images that are drawn and can be recompressed
+    let rewritableImageBytes: Int64
+
+    let fontCount: Int
+    let embeddedFontCount: Int
+    let fontBytes: Int64
+
+    /// Page contents and form XObjects
+    let contentStreamCount: Int
+    let contentBytes: Int64
+
+    let metadataBytes: Int64
+    let otherStreamBytes: Int64
+
+    /// Reads the columns of the native analysis in one pass
+    nonisolated init(_ analysis: mino_document_analysis) {
+        pageCount = Int(analysis.page_count)
+        fileSize = analysis.file_bytes
+        imageBytes = analysis.image_bytes
+        rewritableImageBytes = analysis.rewritable_image_bytes
+        fontCount = Int(analysis.font_count)
+        embeddedFontCount = Int(analysis.font_file_count)
+        fontBytes = analysis.font_bytes
+        contentStreamCount = Int(analysis.content_stream_count)
+        contentBytes = analysis.content_bytes
+        metadataBytes = analysis.metadata_bytes
+        otherStreamBytes = analysis.other_stream_bytes
+
+        let count = Int(analysis.image_count)
+        guard count > 0, let strings = analysis.strings else {
+            images = []
+            return
+        }
+
+        func column<T>(_ pointer: UnsafeMutablePointer<T>?) -> UnsafeBufferPointer<T> {
+            UnsafeBufferPointer(start: pointer, count: count)
+        }
+        func string(at offset: Int32) -> String {
+            String(cString: strings + Int(offset))
+        }
+
+        let objectNumbers = column(analysis.object_num)
+        let widths = column(analysis.width)
+        let heights = column(analysis.height)
+        let depths = column(analysis.bits_per_component)
+        let colorspaces = column(analysis.colorspace)
+        let filters = column(analysis.filters)
+        let streamBytes = column(analysis.stream_bytes)
+        let dpis = column(analysis.effective_dpi)
+        let uses = column(analysis.use_count)
+        let rewritable = column(analysis.rewritable)
+
+        images = (0..<count).map { i in
+            ImageInventoryItem(
+                objectNumber: Int(objectNumbers[i]),
+                width: Int(widths[i]),
+                height: Int(heights[i]),
+                bitsPerComponent: Int(depths[i]),
+                colorspace: string(at: colorspaces[i]),
+                filters: string(at: filters[i]).split(separator: " ").map(String.init),
+                streamBytes: streamBytes[i],
+                effectiveDPI: dpis[i] > 0 ? Double(dpis[i]) : nil,
+                useCount: Int(uses[i]),
+                isRewritable: rewritable[i] != 0
+            )
+        }
+    }
+
+    /// Share of the file taken by images compression can recompress
+    var rewritableFraction: Double {
+        guard fileSize > 0 else { return 0 }
+        return min(1, Double(rewritableImageBytes) / Double(fileSize))
+    }
+
+    /// Images drawn above the lowest preset's downsampling threshold
+    var oversampledImages: [ImageInventoryItem] {
+        let threshold = Double(CompressionQuality.low.dpiThreshold)
+        return images.filter { image in
+            guard let dpi = image.effectiveDPI else { return false }
+            return image.isRewritable && dpi > threshold
+        }
+    }
+
+    /// Images stored in the file but never drawn on a page
+    var unusedImages: [ImageInventoryItem] {
+        images.filter { $0.effectiveDPI == nil }
+    }
+
+    var compressionOutlook: CompressionOutlook {
+        switch rewritableFraction {
+        case 0.5...: return .significant
+        case 0.15..<0.5: return .moderate
+        default: return .minimal
+        }
+    }
+}
+
+// MARK: - PDF Analyzer
+
+/// Inventories documents without modifying them
+final class PDFAnalyzer: @unchecked Sendable {
+
+    /// Analyzes a document. Pages are interpreted once to find where images
+    /// are drawn; no image is decoded.
+    nonisolated func analyze(
+        documentURL: URL,
+        cancellation: CompressionCancellation? = nil
+    ) throws -> DocumentAnalysis {
+        guard let ctx = mino_acquire_context() else {
+            throw MuPDFError.contextCreationFailed
+        }
+        defer { mino_release_context(ctx) }
+
+        let job = EngineJob(cancellation: cancellation)
+
+        guard let doc = mino_open_document_job(ctx, documentURL.path, job.pointer) else {
+            let errorMsg = getLastError() ?? "Unknown error"
+            throw MuPDFError.documentOpenFailed(path: documentURL.path, reason: errorMsg)
+        }
+        defer { mino_drop_document(ctx, doc) }
+
+        guard let pdfDoc = mino_pdf_specifics(ctx, doc) else {
+            throw MuPDFError.invalidPDFDocument
+        }
+
+        var analysis = mino_document_analysis()
+        let result = mino_analyze_document(ctx, pdfDoc, &analysis, job.pointer)
+
+        if result == MINO_STATUS_CANCELLED.rawValue {
+            mino_clear_error()
+            throw MuPDFError.cancelled
+        }
+        if result != 0 {
+            let errorMsg = getLastError() ?? "Unknown analysis error"
+            mino_clear_error()
+            throw MuPDFError.unknownError(errorMsg)
+        }
+        defer { mino_drop_document_analysis(ctx, &analysis) }
+
+        return DocumentAnalysis(analysis)
+    }
+
+    nonisolated private func getLastError() -> String? {
+        guard let cError = mino_get_last_error() else { return nil }
+        return String(cString: cError)
+    }
+}
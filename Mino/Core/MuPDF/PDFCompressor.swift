@@ -114,6 +114,10 @@ struct CompressionSettings: Sendable, Codable {
     /// The preset this was based on (nil if fully custom)
     var preset: CompressionQuality?
 
+    /// Output size to aim for, in bytes. When set, JPEG quality and target DPI
+    /// are chosen by the engine and the values above are ignored.
+    var targetSize: Int64?
+
     /// DPI threshold (images above this DPI will be downsampled)
     var dpiThreshold: Int {
         targetDPI + 50
@@ -131,7 +135,8 @@ struct CompressionSettings: Sendable, Codable {
         compressImages: Bool = true,
         compressFonts: Bool = true,
         cleanContent: Bool = true,
-        preset: CompressionQuality? = nil
+        preset: CompressionQuality? = nil,
+        targetSize: Int64? = nil
     ) {
         self.jpegQuality = max(1, min(100, jpegQuality))
         self.targetDPI = max(50, min(300, targetDPI))
@@ -141,6 +146,7 @@ struct CompressionSettings: Sendable, Codable {
         self.compressFonts = compressFonts
         self.cleanContent = cleanContent
         self.preset = preset
+        self.targetSize = targetSize.map { max(1, $0) }
     }
 
     /// Human-readable description
@@ -153,12 +159,103 @@ struct CompressionSettings: Sendable, Codable {
 
     /// Technical description
     nonisolated var technicalDescription: String {
-        "JPEG \(jpegQuality)%, \(targetDPI) DPI"
+        if let targetSize {
+            return "Under \(ByteCountFormatter.string(fromByteCount: targetSize, countStyle: .file))"
+        }
+        return "JPEG \(jpegQuality)%, \(targetDPI) DPI"
     }
 
     /// Display name for results
     nonisolated var displayName: String {
-        preset?.rawValue ?? "Custom"
+        if targetSize != nil {
+            return "Target Size"
+        }
+        return preset?.rawValue ?? "Custom"
+    }
+}
+
+// MARK: - Size Target
+
+/// How a size-targeted compression landed
+struct SizeTargetOutcome: Sendable, Codable {
+    /// Requested maximum size in bytes
+    let targetSize: Int64
+
+    /// Size the engine predicted for the settings it chose
+    let predictedSize: Int64
+
+    /// Size actually written
+    let actualSize: Int64
+
+    /// Settings chosen by the search
+    let jpegQuality: Int
+    let targetDPI: Int
+
+    /// Number of settings evaluated on the image sample
+    let probes: Int
+
+    /// Number of images decoded for the search
+    let sampledImages: Int
+
+    nonisolated init(_ result: mino_size_result) {
+        targetSize = result.target_bytes
+        predictedSize = result.predicted_bytes
+        actualSize = result.actual_bytes
+        jpegQuality = Int(result.jpeg_quality)
+        targetDPI = Int(result.target_dpi)
+        probes = Int(result.probes)
+        sampledImages = Int(result.sampled_images)
+    }
+
+    /// Whether the output fits within the target
+    var targetMet: Bool {
+        actualSize <= targetSize
+    }
+
+    /// Relative prediction error (positive when the prediction was too high)
+    var predictionError: Double {
+        guard actualSize > 0 else { return 0 }
+        return Double(predictedSize - actualSize) / Double(actualSize)
+    }
+
+    /// Distance from the target as a fraction of it (negative when under)
+    var distanceFromTarget: Double {
+        guard targetSize > 0 else { return 0 }
+        return Double(actualSize - targetSize) / Double(targetSize)
+    }
+}
+
+// MARK: - Size Estimate
+
+/// Predicted output size for one preset, computed without compressing
+struct CompressionEstimate: Sendable {
+    let quality: CompressionQuality
+
+    /// Predicted output size in bytes
+    let predictedSize: Int64
+
+    /// Half-width of an approximate 95% interval around the prediction
+    let errorBound: Int64
+
+    nonisolated init(quality: CompressionQuality, predictedSize: Int64, errorBound: Int64) {
+        self.quality = quality
+        self.predictedSize = predictedSize
+        self.errorBound = errorBound
+    }
+
+    /// Likely range of the output size
+    var range: ClosedRange<Int64> {
+        max(0, predictedSize - errorBound)...(predictedSize + errorBound)
+    }
+
+    /// Predicted size formatted for display
+    var formattedSize: String {
+        ByteCountFormatter.string(fromByteCount: predictedSize, countStyle: .file)
+    }
+
+    /// Error bound formatted for display
+    var formattedErrorBound: String {
+        ByteCountFormatter.string(fromByteCount: errorBound, countStyle: .file)
     }
 }
 
@@ -174,6 +271,16 @@ struct CompressionResult: Sendable, Identifiable, Codable {
     let duration: TimeInterval
     let timestamp: Date
 
+    /// Engine measurements (not persisted)
+    let stats: EngineStats?
+
+    /// Outcome of the search when compressing to a target size
+    let sizeTarget: SizeTargetOutcome?
+
+    /// Compression could not make the file smaller, so the output is a copy
+    /// of the original
+    let keptOriginal: Bool
+
     /// Convenience accessor for preset quality (if using preset)
     var quality: CompressionQuality {
         settings.preset ?? .medium
@@ -184,7 +291,10 @@ struct CompressionResult: Sendable, Identifiable, Codable {
         originalSize: Int64,
         compressedSize: Int64,
         settings: CompressionSettings,
-        duration: TimeInterval
+        duration: TimeInterval,
+        stats: EngineStats? = nil,
+        sizeTarget: SizeTargetOutcome? = nil,
+        keptOriginal: Bool = false
     ) {
         self.id = UUID()
         self.outputURL = outputURL
@@ -193,6 +303,9 @@ struct CompressionResult: Sendable, Identifiable, Codable {
         self.settings = settings
         self.duration = duration
         self.timestamp = Date()
+        self.stats = stats
+        self.sizeTarget = sizeTarget
+        self.keptOriginal = keptOriginal
     }
 
     /// Full initializer for restoring from persistence
@@ -203,7 +316,10 @@ struct CompressionResult: Sendable, Identifiable, Codable {
         compressedSize: Int64,
         settings: CompressionSettings,
         duration: TimeInterval,
-        timestamp: Date
+        timestamp: Date,
+        stats: EngineStats? = nil,
+        sizeTarget: SizeTargetOutcome? = nil,
+        keptOriginal: Bool = false
     ) {
         self.id = id
         self.outputURL = outputURL
@@ -212,6 +328,9 @@ struct CompressionResult: Sendable, Identifiable, Codable {
         self.settings = settings
         self.duration = duration
         self.timestamp = timestamp
+        self.stats = stats
+        self.sizeTarget = sizeTarget
+        self.keptOriginal = keptOriginal
     }
 
     /// Legacy initializer for compatibility
@@ -287,6 +406,253 @@ struct CompressionResult: Sendable, Identifiable, Codable {
     }
 }
 
+// MARK: - Progress and Cancellation
+
+/// Phases reported by the native engine while compressing
+enum EnginePhase: Int32, Sendable {
+    case scanning = 0
+    case images = 1
+    case writing = 2
+    case rendering = 3
+
+    /// Portion of the overall run covered by this phase
+    nonisolated private var span: (start: Double, end: Double) {
+        switch self {
+        case .scanning: return (0.0, 0.1)
+        case .images: return (0.1, 0.7)
+        case .writing: return (0.7, 1.0)
+        case .rendering: return (0.0, 1.0)
+        }
+    }
+
+    /// Maps progress within this phase to overall progress (0.0 to 1.0)
+    nonisolated func overallProgress(done: Int, total: Int) -> Double {
+        let fraction = total > 0 ? min(1, Double(done) / Double(total)) : 1
+        return span.start + (span.end - span.start) * fraction
+    }
+
+    /// User-facing description
+    nonisolated var displayName: String {
+        switch self {
+        case .scanning: return "Analyzing pages..."
+        case .images: return "Compressing images..."
+        case .writing: return "Writing file..."
+        case .rendering: return "Rendering..."
+        }
+    }
+}
+
+/// Progress callback receiving the current phase and overall progress
+typealias CompressionProgressHandler = @Sendable (EnginePhase, Double) -> Void
+
+/// Token that cancels a running native operation from any thread
+final class CompressionCancellation: @unchecked Sendable {
+
+    fileprivate let cookie: UnsafeMutablePointer<fz_cookie>
+
+    nonisolated init() {
+        cookie = mino_new_cookie()
+    }
+
+    deinit {
+        mino_drop_cookie(cookie)
+    }
+
+    /// Requests cancellation; the operation stops at its next checkpoint
+    nonisolated func cancel() {
+        mino_abort_cookie(cookie)
+    }
+
+    nonisolated var isCancelled: Bool {
+        mino_cookie_aborted(cookie) != 0
+    }
+}
+
+/// Boxes a progress handler so it can be passed through a C callback
+private final class ProgressBox {
+    let handler: CompressionProgressHandler
+
+    nonisolated init(_ handler: @escaping CompressionProgressHandler) {
+        self.handler = handler
+    }
+}
+
+/// On-disk cache of recompressed image streams. A document compressed again
+/// at the same settings, or one sharing images with an earlier document,
+/// reuses the stored JPEG streams instead of decoding and encoding again.
+final class RecompressionCache: @unchecked Sendable {
+
+    /// Cache in the app's caches directory, shared by every compression
+    nonisolated static let shared = RecompressionCache(
+        directory: FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask)[0]
+            .appendingPathComponent("RecompressedImages", isDirectory: true),
+        maxBytes: 256 * 1024 * 1024
+    )
+
+    /// Nil if the directory could not be created; compression then runs uncached
+    fileprivate let handle: OpaquePointer?
+
+    nonisolated init(directory: URL, maxBytes: Int64) {
+        handle = mino_image_cache_open(directory.path, maxBytes)
+    }
+
+    deinit {
+        mino_image_cache_close(handle)
+    }
+
+    /// Bytes currently stored
+    nonisolated var size: Int64 {
+        mino_image_cache_size(handle)
+    }
+
+    /// Deletes every cached image
+    nonisolated func clear() {
+        mino_image_cache_clear(handle)
+    }
+}
+
+/// Native job state (cancellation, progress and stats) for one engine call.
+/// Must stay alive until the call it is passed to returns.
+final class EngineJob: @unchecked Sendable {
+
+    /// Pointer passed to the job-aware engine functions
+    let pointer: UnsafeMutablePointer<mino_job>
+
+    private let statsPointer: UnsafeMutablePointer<mino_job_stats>
+    private let progressUser: UnsafeMutableRawPointer?
+    private let imageCache: RecompressionCache?
+
+    /// Progress is reported on the thread running the engine call. A non-zero
+    /// `sizeCeiling` makes writes fail with MINO_STATUS_NO_GAIN as soon as the
+    /// output is certain to reach that many bytes.
+    nonisolated init(
+        cancellation: CompressionCancellation? = nil,
+        progress: CompressionProgressHandler? = nil,
+        imageCache: RecompressionCache? = nil,
+        sizeCeiling: Int64 = 0
+    ) {
+        self.imageCache = imageCache
+
+        statsPointer = .allocate(capacity: 1)
+        statsPointer.initialize(to: mino_job_stats())
+
+        progressUser = progress.map { Unmanaged.passRetained(ProgressBox($0)).toOpaque() }
+
+        let progressCallback: mino_progress_fn = { user, phase, done, total in
+            guard let user = user, let phase = EnginePhase(rawValue: phase) else { return }
+            let box = Unmanaged<ProgressBox>.fromOpaque(user).takeUnretainedValue()
+            box.handler(phase, phase.overallProgress(done: Int(done), total: Int(total)))
+        }
+
+        pointer = .allocate(capacity: 1)
+        pointer.initialize(to: mino_job(
+            cookie: cancellation?.cookie,
+            progress: progressUser != nil ? progressCallback : nil,
+            progress_user: progressUser,
+            stats: statsPointer,
+            image_cache: imageCache?.handle,
+            image_replace: MINO_REPLACE_IF_SMALLER,
+            size_ceiling: sizeCeiling,
+            threads: 0
+        ))
+    }
+
+    deinit {
+        if let progressUser {
+            Unmanaged<ProgressBox>.fromOpaque(progressUser).release()
+        }
+        pointer.deallocate()
+        statsPointer.deallocate()
+    }
+
+    /// Measurements accumulated by every call this job was passed to
+    nonisolated var stats: EngineStats {
+        EngineStats(statsPointer.pointee)
+    }
+}
+
+// MARK: - Batch Compression Types
+
+/// A single document to compress as part of a native batch
+struct BatchCompressionJob: Sendable {
+    let documentURL: URL
+    let outputURL: URL
+    let originalSize: Int64
+}
+
+/// Progress events emitted by a native batch run, in the order they occur
+enum BatchCompressionEvent: Sendable {
+    case started(index: Int)
+    case progress(index: Int, phase: EnginePhase, fraction: Double)
+    case completed(index: Int, result: CompressionResult)
+    case failed(index: Int, error: String)
+    case cancelled(index: Int)
+}
+
+/// Handle to a native batch run on the bounded worker pool
+final class CompressionBatch: @unchecked Sendable {
+
+    fileprivate let handle: OpaquePointer
+    private let imageCache = RecompressionCache.shared
+
+    /// Default number of documents compressed at once. Each document holds its
+    /// own decoded images and already spreads image work over its share of the
+    /// cores, so more documents mostly add peak memory on a phone.
+    nonisolated static let defaultConcurrentJobs = 2
+
+    /// Creates a batch that compresses up to `maxConcurrentJobs` documents at once
+    /// (0 uses one worker per CPU core)
+    nonisolated init(
+        settings: CompressionSettings,
+        maxConcurrentJobs: Int = CompressionBatch.defaultConcurrentJobs
+    ) throws {
+        var options = mino_batch_options(
+            jpeg_quality: Int32(settings.jpegQuality),
+            target_dpi: Int32(settings.targetDPI),
+            garbage_level: Int32(settings.garbageLevel),
+            max_workers: Int32(max(0, maxConcurrentJobs)),
+            image_cache: imageCache.handle,
+            abort_without_gain: 1,
+            image_replace: MINO_REPLACE_IF_SMALLER
+        )
+        guard let handle = mino_batch_create(&options) else {
+            throw MuPDFError.contextCreationFailed
+        }
+        self.handle = handle
+    }
+
+    deinit {
+        mino_batch_drop(handle)
+    }
+
+    /// Stops dispatching new documents and aborts those already running
+    nonisolated func cancel() {
+        mino_batch_cancel(handle)
+    }
+
+    /// Aborts a single document of the current run, by its index in the jobs
+    nonisolated func cancel(itemAt index: Int) {
+        mino_batch_cancel_item(handle, Int32(index))
+    }
+}
+
+/// Bridges native batch callbacks (invoked on worker threads) to an AsyncStream
+private final class BatchCallbackContext: @unchecked Sendable {
+    let jobs: [BatchCompressionJob]
+    let settings: CompressionSettings
+    let continuation: AsyncStream<BatchCompressionEvent>.Continuation
+
+    nonisolated init(
+        jobs: [BatchCompressionJob],
+        settings: CompressionSettings,
+        continuation: AsyncStream<BatchCompressionEvent>.Continuation
+    ) {
+        self.jobs = jobs
+        self.settings = settings
+        self.continuation = continuation
+    }
+}
+
 // MARK: - PDF Compressor
 
 /// Main PDF compression engine using MuPDF
@@ -298,7 +664,9 @@ final class PDFCompressor: @unchecked Sendable {
     nonisolated func compress(
         documentURL: URL,
         settings: CompressionSettings,
-        outputURL: URL
+        outputURL: URL,
+        cancellation: CompressionCancellation? = nil,
+        progress: CompressionProgressHandler? = nil
     ) throws -> CompressionResult {
         let startTime = Date()
 
@@ -311,14 +679,23 @@ final class PDFCompressor: @unchecked Sendable {
             originalSize = 0
         }
 
-        // Create context
-        guard let ctx = mino_create_context() else {
+        // Acquire a warm context from the shared pool
+        guard let ctx = mino_acquire_context() else {
             throw MuPDFError.contextCreationFailed
         }
-        defer { mino_drop_context(ctx) }
+        defer { mino_release_context(ctx) }
+
+        // A preset run stops as soon as it cannot beat the original. A size
+        // target search writes several candidates and picks its own.
+        let job = EngineJob(
+            cancellation: cancellation,
+            progress: progress,
+            imageCache: .shared,
+            sizeCeiling: settings.targetSize == nil ? originalSize : 0
+        )
 
         // Open document
-        guard let doc = mino_open_document(ctx, documentURL.path) else {
+        guard let doc = mino_open_document_job(ctx, documentURL.path, job.pointer) else {
             let errorMsg = getLastError() ?? "Unknown error"
             throw MuPDFError.documentOpenFailed(path: documentURL.path, reason: errorMsg)
         }
@@ -337,19 +714,65 @@ final class PDFCompressor: @unchecked Sendable {
         try? FileManager.default.removeItem(at: outputURL)
 
         // Perform compression using C helper
-        let result = mino_compress_pdf(
-            ctx,
-            pdfDoc,
-            outputURL.path,
-            Int32(settings.jpegQuality),
-            Int32(settings.targetDPI),
-            Int32(settings.garbageLevel)
-        )
-
-        if result != 0 {
-            let errorMsg = getLastError() ?? "Unknown compression error"
-            mino_clear_error()
-            throw MuPDFError.compressionFailed(reason: errorMsg)
+        var appliedSettings = settings
+        var sizeTarget: SizeTargetOutcome?
+
+        if let targetSize = settings.targetSize {
+            var outcome = mino_size_result()
+            let result = mino_compress_pdf_to_size(
+                ctx,
+                pdfDoc,
+                outputURL.path,
+                targetSize,
+                Int32(settings.garbageLevel),
+                &outcome,
+                job.pointer
+            )
+            try checkResult(result)
+
+            sizeTarget = SizeTargetOutcome(outcome)
+            appliedSettings.jpegQuality = Int(outcome.jpeg_quality)
+            appliedSettings.targetDPI = Int(outcome.target_dpi)
+        } else {
+            // Long documents are written a window of pages at a time so
+            // memory stays bounded
+            let result: Int32
+            if mino_pdf_count_pages(ctx, pdfDoc) >= MINO_STREAMING_PAGE_THRESHOLD {
+                result = mino_compress_pdf_streaming(
+                    ctx,
+                    pdfDoc,
+                    outputURL.path,
+                    Int32(settings.jpegQuality),
+                    Int32(settings.targetDPI),
+                    Int32(settings.garbageLevel),
+                    0,
+                    job.pointer
+                )
+            } else {
+                result = mino_compress_pdf_job(
+                    ctx,
+                    pdfDoc,
+                    outputURL.path,
+                    Int32(settings.jpegQuality),
+                    Int32(settings.targetDPI),
+                    Int32(settings.garbageLevel),
+                    job.pointer
+                )
+            }
+            if result == MINO_STATUS_NO_GAIN.rawValue {
+                mino_clear_error()
+                try FileManager.default.copyItem(at: documentURL, to: outputURL)
+                return CompressionResult(
+                    outputURL: outputURL,
+                    originalSize: originalSize,
+                    compressedSize: originalSize,
+                    settings: settings,
+                    duration: Date().timeIntervalSince(startTime),
+                    stats: job.stats,
+                    keptOriginal: true
+                )
+            }
+            try checkResult(result)
         }
 
         // Get compressed file size
@@ -364,11 +787,62 @@ final class PDFCompressor: @unchecked Sendable {
             outputURL: outputURL,
             originalSize: originalSize,
             compressedSize: compressedSize,
-            settings: settings,
-            duration: duration
+            settings: appliedSettings,
+            duration: duration,
+            stats: job.stats,
+            sizeTarget: sizeTarget
         )
     }
 
+    /// Predicts the compressed size of a document for each preset without
+    /// writing any output. Much cheaper than compressing: pages are scanned
+    /// once and only a sample of the images is re-encoded.
+    nonisolated func estimateSizes(
+        documentURL: URL,
+        qualities: [CompressionQuality] = CompressionQuality.allCases,
+        cancellation: CompressionCancellation? = nil
+    ) throws -> [CompressionQuality: CompressionEstimate] {
+        guard let ctx = mino_acquire_context() else {
+            throw MuPDFError.contextCreationFailed
+        }
+        defer { mino_release_context(ctx) }
+
+        let job = EngineJob(cancellation: cancellation, progress: nil)
+
+        guard let doc = mino_open_document_job(ctx, documentURL.path, job.pointer) else {
+            let errorMsg = getLastError() ?? "Unknown error"
+            throw MuPDFError.documentOpenFailed(path: documentURL.path, reason: errorMsg)
+        }
+        defer { mino_drop_document(ctx, doc) }
+
+        guard let pdfDoc = mino_pdf_specifics(ctx, doc) else {
+            throw MuPDFError.invalidPDFDocument
+        }
+
+        var estimates = qualities.map {
+            mino_size_estimate(
+                jpeg_quality: $0.jpegQuality,
+                target_dpi: $0.targetDPI,
+                predicted_bytes: 0,
+                error_bytes: 0
+            )
+        }
+        let result = estimates.withUnsafeMutableBufferPointer { buffer in
+            mino_estimate_compression(ctx, pdfDoc, buffer.baseAddress, Int32(buffer.count), job.pointer)
+        }
+        try checkResult(result)
+
+        var byQuality: [CompressionQuality: CompressionEstimate] = [:]
+        for (quality, estimate) in zip(qualities, estimates) {
+            byQuality[quality] = CompressionEstimate(
+                quality: quality,
+                predictedSize: estimate.predicted_bytes,
+                errorBound: estimate.error_bytes
+            )
+        }
+        return byQuality
+    }
+
     /// Compresses a PDF document with the specified quality preset
     nonisolated func compress(
         documentURL: URL,
@@ -378,6 +852,180 @@ final class PDFCompressor: @unchecked Sendable {
         try compress(documentURL: documentURL, settings: quality.settings, outputURL: outputURL)
     }
 
+    /// Compresses a PDF document into memory without writing it to disk.
+    /// The returned data references the engine's buffer directly.
+    nonisolated func compressToData(
+        documentURL: URL,
+        settings: CompressionSettings,
+        cancellation: CompressionCancellation? = nil,
+        progress: CompressionProgressHandler? = nil
+    ) throws -> Data {
+        guard let ctx = mino_acquire_context() else {
+            throw MuPDFError.contextCreationFailed
+        }
+        defer { mino_release_context(ctx) }
+
+        // Open under the job so open and repair time land in its stats
+        let job = EngineJob(cancellation: cancellation, progress: progress, imageCache: .shared)
+
+        guard let doc = mino_open_document_job(ctx, documentURL.path, job.pointer) else {
+            let errorMsg = getLastError() ?? "Unknown error"
+            throw MuPDFError.documentOpenFailed(path: documentURL.path, reason: errorMsg)
+        }
+        defer { mino_drop_document(ctx, doc) }
+
+        guard let pdfDoc = mino_pdf_specifics(ctx, doc) else {
+            throw MuPDFError.invalidPDFDocument
+        }
+
+        var bytes: UnsafeMutablePointer<UInt8>?
+        var length = 0
+        let result = mino_compress_pdf_to_buffer(
+            ctx,
+            pdfDoc,
+            Int32(settings.jpegQuality),
+            Int32(settings.targetDPI),
+            Int32(settings.garbageLevel),
+            &bytes,
+            &length,
+            job.pointer
+        )
+        try checkResult(result)
+
+        guard let bytes else {
+            return Data()
+        }
+
+        // The buffer outlives this context, so free it through a pooled one
+        return Data(bytesNoCopy: bytes, count: length, deallocator: .custom { pointer, _ in
+            guard let ctx = mino_acquire_context() else { return }
+            mino_free_buffer_data(ctx, pointer.assumingMemoryBound(to: UInt8.self))
+            mino_release_context(ctx)
+        })
+    }
+
+    // MARK: - Batch Compression
+
+    /// Compresses several documents concurrently on the native worker pool.
+    /// Events are delivered as each document starts and finishes; the stream
+    /// ends once every dispatched document is done.
+    nonisolated func compressBatch(
+        jobs: [BatchCompressionJob],
+        settings: CompressionSettings,
+        batch: CompressionBatch
+    ) -> AsyncStream<BatchCompressionEvent> {
+        AsyncStream { continuation in
+            Task.detached(priority: .userInitiated) {
+                let callbackContext = BatchCallbackContext(
+                    jobs: jobs,
+                    settings: settings,
+                    continuation: continuation
+                )
+
+                // C strings must outlive the native run
+                let paths = jobs.map { (strdup($0.documentURL.path), strdup($0.outputURL.path)) }
+                defer {
+                    for (input, output) in paths {
+                        free(input)
+                        free(output)
+                    }
+                }
+
+                // Create output directories up front; workers only write files
+                for job in jobs {
+                    let outputDir = job.outputURL.deletingLastPathComponent()
+                    try? FileManager.default.createDirectory(at: outputDir, withIntermediateDirectories: true)
+                    try? FileManager.default.removeItem(at: job.outputURL)
+                }
+
+                let items = paths.map { mino_batch_item(input_path: $0.0, output_path: $0.1) }
+                let user = Unmanaged.passRetained(callbackContext).toOpaque()
+                defer { Unmanaged<BatchCallbackContext>.fromOpaque(user).release() }
+
+                let started: mino_batch_started_fn = { user, index in
+                    guard let user = user else { return }
+                    let context = Unmanaged<BatchCallbackContext>.fromOpaque(user).takeUnretainedValue()
+                    context.continuation.yield(.started(index: Int(index)))
+                }
+
+                let progress: mino_batch_progress_fn = { user, index, phase, done, total in
+                    guard let user = user, let phase = EnginePhase(rawValue: phase) else { return }
+                    let context = Unmanaged<BatchCallbackContext>.fromOpaque(user).takeUnretainedValue()
+                    let fraction = phase.overallProgress(done: Int(done), total: Int(total))
+                    context.continuation.yield(.progress(index: Int(index), phase: phase, fraction: fraction))
+                }
+
+                let finished: mino_batch_finished_fn = { user, index, status, outputSize, durationNs, stats, error in
+                    guard let user = user else { return }
+                    let context = Unmanaged<BatchCallbackContext>.fromOpaque(user).takeUnretainedValue()
+                    let job = context.jobs[Int(index)]
+
+                    if status == MINO_STATUS_CANCELLED.rawValue {
+                        context.continuation.yield(.cancelled(index: Int(index)))
+                    } else if status == MINO_STATUS_NO_GAIN.rawValue {
+                        // Hand back the original rather than a larger file
+                        do {
+                            try FileManager.default.copyItem(at: job.documentURL, to: job.outputURL)
+                            let result = CompressionResult(
+                                outputURL: job.outputURL,
+                                originalSize: job.originalSize,
+                                compressedSize: job.originalSize,
+                                settings: context.settings,
+                                duration: TimeInterval(durationNs) / 1_000_000_000,
+                                stats: stats.map { EngineStats($0.pointee) },
+                                keptOriginal: true
+                            )
+                            context.continuation.yield(.completed(index: Int(index), result: result))
+                        } catch {
+                            context.continuation.yield(.failed(index: Int(index), error: error.localizedDescription))
+                        }
+                    } else if status == 0 {
+                        let result = CompressionResult(
+                            outputURL: job.outputURL,
+                            originalSize: job.originalSize,
+                            compressedSize: outputSize,
+                            settings: context.settings,
+                            duration: TimeInterval(durationNs) / 1_000_000_000,
+                            stats: stats.map { EngineStats($0.pointee) }
+                        )
+                        context.continuation.yield(.completed(index: Int(index), result: result))
+                    } else {
+                        let message = error.map { String(cString: $0) } ?? "Unknown compression error"
+                        context.continuation.yield(.failed(index: Int(index), error: message))
+                    }
+                }
+
+                items.withUnsafeBufferPointer { buffer in
+                    _ = mino_batch_run(
+                        batch.handle,
+                        buffer.baseAddress,
+                        Int32(buffer.count),
+                        started,
+                        progress,
+                        finished,
+                        user
+                    )
+                }
+
+                continuation.finish()
+            }
+        }
+    }
+
+    /// Converts a mino_status into a thrown error
+    nonisolated private func checkResult(_ result: Int32) throws {
+        if result == MINO_STATUS_CANCELLED.rawValue {
+            mino_clear_error()
+            throw MuPDFError.cancelled
+        }
+
+        if result != 0 {
+            let errorMsg = getLastError() ?? "Unknown compression error"
+            mino_clear_error()
+            throw MuPDFError.compressionFailed(reason: errorMsg)
+        }
+    }
+
     nonisolated private func getLastError() -> String? {
         guard let cError = mino_get_last_error() else { return nil }
         return String(cString: cError)
@@ -29,11 +29,14 @@ final class PDFMerger: @unchecked Sendable {
             throw MuPDFError.invalidParameters
         }
 
-        // Create context
-        guard let ctx = mino_create_context() else {
+        // Acquire a warm context from the shared pool
+        guard let ctx = mino_acquire_context() else {
             throw MuPDFError.contextCreationFailed
         }
-        defer { mino_drop_context(ctx) }
+        defer { mino_release_context(ctx) }
+
+        // Collects engine stats across every open and the save
+        let job = EngineJob()
 
         // Create destination document
         guard let dstDoc = mino_create_pdf_document(ctx) else {
@@ -51,7 +54,7 @@ final class PDFMerger: @unchecked Sendable {
             progressHandler?(progress, fileName)
 
             // Open source document
-            guard let srcDoc = mino_open_document(ctx, sourceURL.path) else {
+            guard let srcDoc = mino_open_document_job(ctx, sourceURL.path, job.pointer) else {
                 let errorMsg = getLastError() ?? "Unknown error"
                 throw MuPDFError.documentOpenFailed(path: sourceURL.path, reason: errorMsg)
             }
@@ -95,7 +98,7 @@ final class PDFMerger: @unchecked Sendable {
         try? FileManager.default.removeItem(at: outputURL)
 
         // Save the merged document
-        let saveResult = mino_save_pdf(ctx, dstDoc, outputURL.path, 3)
+        let saveResult = mino_save_pdf_job(ctx, dstDoc, outputURL.path, 3, job.pointer)
         if saveResult != 0 {
             let errorMsg = getLastError() ?? "Unknown error"
             mino_clear_error()
@@ -118,7 +121,8 @@ final class PDFMerger: @unchecked Sendable {
             totalPages: totalPages,
             outputSize: outputSize,
             duration: duration,
-            timestamp: Date()
+            timestamp: Date(),
+            stats: job.stats
         )
     }
 
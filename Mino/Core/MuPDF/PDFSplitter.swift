@@ -27,14 +27,16 @@ final class PDFSplitter: @unchecked Sendable {
         let startPage = range.start - 1
         let endPage = range.end - 1
 
-        // Create context
-        guard let ctx = mino_create_context() else {
+        // Acquire a warm context from the shared pool
+        guard let ctx = mino_acquire_context() else {
             throw MuPDFError.contextCreationFailed
         }
-        defer { mino_drop_context(ctx) }
+        defer { mino_release_context(ctx) }
+
+        let job = EngineJob()
 
         // Open source document
-        guard let srcDoc = mino_open_document(ctx, sourceURL.path) else {
+        guard let srcDoc = mino_open_document_job(ctx, sourceURL.path, job.pointer) else {
             let errorMsg = getLastError() ?? "Unknown error"
             throw MuPDFError.documentOpenFailed(path: sourceURL.path, reason: errorMsg)
         }
@@ -81,7 +83,7 @@ final class PDFSplitter: @unchecked Sendable {
         try? FileManager.default.removeItem(at: outputURL)
 
         // Save the extracted pages
-        let saveResult = mino_save_pdf(ctx, dstDoc, outputURL.path, 3)
+        let saveResult = mino_save_pdf_job(ctx, dstDoc, outputURL.path, 3, job.pointer)
         if saveResult != 0 {
             let errorMsg = getLastError() ?? "Unknown error"
             mino_clear_error()
@@ -100,7 +102,8 @@ final class PDFSplitter: @unchecked Sendable {
             pageRange: range.displayString,
             pageCount: range.pageCount,
             outputSize: outputSize,
-            timestamp: Date()
+            timestamp: Date(),
+            stats: job.stats
         )
     }
 
@@ -119,14 +122,16 @@ final class PDFSplitter: @unchecked Sendable {
         outputURL1: URL,
         outputURL2: URL
     ) throws -> [SplitResult] {
-        // Create context
-        guard let ctx = mino_create_context() else {
+        // Acquire a warm context from the shared pool
+        guard let ctx = mino_acquire_context() else {
             throw MuPDFError.contextCreationFailed
         }
-        defer { mino_drop_context(ctx) }
+        defer { mino_release_context(ctx) }
+
+        let job = EngineJob()
 
         // Open source document
-        guard let srcDoc = mino_open_document(ctx, sourceURL.path) else {
+        guard let srcDoc = mino_open_document_job(ctx, sourceURL.path, job.pointer) else {
             let errorMsg = getLastError() ?? "Unknown error"
             throw MuPDFError.documentOpenFailed(path: sourceURL.path, reason: errorMsg)
         }
@@ -182,7 +187,7 @@ final class PDFSplitter: @unchecked Sendable {
         try? FileManager.default.removeItem(at: outputURL1)
 
         // Save Part 1
-        let saveResult1 = mino_save_pdf(ctx, dstDoc1, outputURL1.path, 3)
+        let saveResult1 = mino_save_pdf_job(ctx, dstDoc1, outputURL1.path, 3, job.pointer)
         mino_drop_pdf_document(ctx, dstDoc1)
 
         if saveResult1 != 0 {
@@ -202,12 +207,14 @@ final class PDFSplitter: @unchecked Sendable {
             pageRange: part1PageCount == 1 ? "1" : "1-\(part1PageCount)",
             pageCount: part1PageCount,
             outputSize: outputSize1,
-            timestamp: Date()
+            timestamp: Date(),
+            stats: job.stats
         )
         results.append(result1)
 
         // --- Part 2: Pages splitPage to end ---
         let part2PageCount = pageCount - part1PageCount
+        let job2 = EngineJob()
 
         guard let dstDoc2 = mino_create_pdf_document(ctx) else {
             throw MuPDFError.documentCreationFailed
@@ -235,7 +242,7 @@ final class PDFSplitter: @unchecked Sendable {
         try? FileManager.default.removeItem(at: outputURL2)
 
         // Save Part 2
-        let saveResult2 = mino_save_pdf(ctx, dstDoc2, outputURL2.path, 3)
+        let saveResult2 = mino_save_pdf_job(ctx, dstDoc2, outputURL2.path, 3, job2.pointer)
         mino_drop_pdf_document(ctx, dstDoc2)
 
         if saveResult2 != 0 {
@@ -255,7 +262,8 @@ final class PDFSplitter: @unchecked Sendable {
             pageRange: part2PageCount == 1 ? "\(splitPage)" : "\(splitPage)-\(pageCount)",
             pageCount: part2PageCount,
             outputSize: outputSize2,
-            timestamp: Date()
+            timestamp: Date(),
+            stats: job2.stats
         )
         results.append(result2)
 
@@ -0,0 +1,113 @@
+//
+//  RenderBufferPool.swift
+//  Mino
+//
+//  Reusable pixel buffers that rendered images wrap without copying
+//
+
+import CoreGraphics
+import Foundation
+
+/// A block of pixel memory handed out by a RenderBufferPool
+final class RenderBuffer: @unchecked Sendable {
+    let bytes: UnsafeMutableRawPointer
+    let capacity: Int
+
+    nonisolated init(capacity: Int) {
+        self.capacity = capacity
+        bytes = UnsafeMutableRawPointer.allocate(
+            byteCount: capacity,
+            alignment: Int(MINO_RENDER_ROW_ALIGNMENT)
+        )
+    }
+
+    deinit {
+        bytes.deallocate()
+    }
+}
+
+/// Keeps released render buffers for reuse, so scrolling through pages of
+/// one size stops allocating once the first few are drawn
+final class RenderBufferPool: @unchecked Sendable {
+
+    static let shared = RenderBufferPool()
+
+    /// Capacities are rounded up to this, so nearby sizes share buffers
+    private static let granularity = 64 * 1024
+
+    private let lock = NSLock()
+    private var idle: [RenderBuffer] = []
+    private var idleBytes = 0
+
+    /// Most memory kept in idle buffers
+    let maxIdleBytes: Int
+
+    nonisolated init(maxIdleBytes: Int = 64 * 1024 * 1024) {
+        self.maxIdleBytes = maxIdleBytes
+    }
+
+    /// A buffer of at least `byteCount` bytes; the smallest idle one that fits
+    nonisolated func checkout(byteCount: Int) -> RenderBuffer {
+        lock.lock()
+        let index = idle.indices
+            .filter { idle[$0].capacity >= byteCount }
+            .min { idle[$0].capacity < idle[$1].capacity }
+        if let index {
+            let buffer = idle.remove(at: index)
+            idleBytes -= buffer.capacity
+            lock.unlock()
+            return buffer
+        }
+        lock.unlock()
+
+        let granularity = Self.granularity
+        let capacity = (byteCount + granularity - 1) / granularity * granularity
+        return RenderBuffer(capacity: max(capacity, granularity))
+    }
+
+    /// Returns a buffer for reuse; the oldest idle buffers go first when full
+    nonisolated func checkin(_ buffer: RenderBuffer) {
+        guard buffer.capacity <= maxIdleBytes else { return }
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        idle.append(buffer)
+        idleBytes += buffer.capacity
+        while idleBytes > maxIdleBytes {
+            idleBytes -= idle.removeFirst().capacity
+        }
+    }
+
+    /// A data provider reading `size` bytes of the buffer in place. The
+    /// buffer comes back to the pool when the provider is released.
+    nonisolated func dataProvider(for buffer: RenderBuffer, size: Int) -> CGDataProvider? {
+        let lease = Unmanaged.passRetained(Lease(pool: self, buffer: buffer))
+
+        let provider = CGDataProvider(
+            dataInfo: lease.toOpaque(),
+            data: buffer.bytes,
+            size: size
+        ) { info, _, _ in
+            guard let info else { return }
+            let lease = Unmanaged<Lease>.fromOpaque(info).takeRetainedValue()
+            lease.pool.checkin(lease.buffer)
+        }
+
+        if provider == nil {
+            lease.release()
+        }
+        return provider
+    }
+
+    /// Carried through the data provider's info pointer
+    private final class Lease {
+        let pool: RenderBufferPool
+        let buffer: RenderBuffer
+
+        nonisolated init(pool: RenderBufferPool, buffer: RenderBuffer) {
+            self.pool = pool
+            self.buffer = buffer
+        }
+    }
+}
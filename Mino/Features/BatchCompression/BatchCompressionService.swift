@@ -23,12 +23,24 @@ final class BatchCompressionService {
     /// Whether batch compression is in progress
     private(set) var isProcessing = false
 
+    /// Maximum number of documents compressed at once
+    var maxConcurrentJobs = CompressionBatch.defaultConcurrentJobs
+
     /// Whether the batch was cancelled
     private var isCancelled = false
 
+    /// The native batch currently running
+    private var activeBatch: CompressionBatch?
+
+    /// Items of the native batch currently running, in job order
+    private var activeItems: [BatchCompressionItem] = []
+
+    /// The run in flight, kept so a resume can wait for a paused run to drain
+    private var processingTask: Task<Void, Error>?
+
     // MARK: - Batch Operations
 
-    /// Starts batch compression of multiple documents (sequential processing)
+    /// Starts batch compression of multiple documents (concurrent processing)
     func startBatch(
         documents: [PDFDocumentInfo],
         settings: CompressionSettings
@@ -40,62 +52,10 @@ final class BatchCompressionService {
         // Create queue
         let queue = BatchCompressionQueue(documents: documents, settings: settings)
         currentQueue = queue
-        isProcessing = true
         isCancelled = false
 
-        // Start processing
-        queue.updateState(.processing(currentIndex: 0, total: queue.count))
-
-        var results: [CompressionResult] = []
-        let compressor = self.compressor
-
-        // Process documents sequentially
-        for (index, item) in queue.items.enumerated() {
-            // Check for cancellation
-            if isCancelled {
-                queue.updateState(.cancelled)
-                break
-            }
-
-            // Update queue state
-            queue.updateState(.processing(currentIndex: index, total: queue.count))
-
-            // Update item state
-            item.updateState(.compressing(progress: 0))
-
-            // Generate output URL
-            let outputURL = PDFCompressor.generateOutputURL(for: item.document.url, settings: settings)
-
-            do {
-                // Capture values for detached task
-                let documentURL = item.document.url
-
-                // Perform compression on background thread
-                let result = try await Task.detached(priority: .userInitiated) {
-                    try compressor.compress(
-                        documentURL: documentURL,
-                        settings: settings,
-                        outputURL: outputURL
-                    )
-                }.value
-
-                // Update item state
-                item.updateState(.completed(result: result))
-                results.append(result)
-
-            } catch {
-                // Mark item as failed but continue with next
-                item.updateState(.failed(error: error.localizedDescription))
-            }
-        }
-
-        // Update final state
-        if !isCancelled {
-            queue.updateState(.completed)
-        }
-
-        isProcessing = false
-        return results
+        try await run(queue.items, in: queue)
+        return queue.results
     }
 
     /// Starts batch compression with a quality preset
@@ -109,13 +69,16 @@ final class BatchCompressionService {
     /// Cancels the current batch
     func cancelBatch() {
         isCancelled = true
+        activeBatch?.cancel()
     }
 
-    /// Pauses the current batch (marks state but doesn't stop current item)
+    /// Pauses the current batch. Items already running are aborted and return
+    /// to pending, so resuming compresses them again from the start.
     func pauseBatch() {
         guard let queue = currentQueue else { return }
         if case .processing(let index, let total) = queue.state {
             queue.updateState(.paused(currentIndex: index, total: total))
+            activeBatch?.cancel()
         }
     }
 
@@ -125,66 +88,28 @@ final class BatchCompressionService {
             throw MuPDFError.invalidParameters
         }
 
+        // Items aborted by the pause only return to pending as the paused run
+        // drains, so wait for it before collecting them
+        while let running = processingTask {
+            _ = try? await running.value
+            if processingTask == running { break }
+        }
+
         // Get remaining items
-        let completedCount = queue.completedCount
-        let remainingDocuments = queue.items
-            .dropFirst(completedCount)
-            .filter { !$0.state.isCompleted && !$0.state.isFailed }
-            .map { $0.document }
+        let remainingItems = queue.items.filter {
+            if case .pending = $0.state { return true }
+            return false
+        }
 
-        guard !remainingDocuments.isEmpty else {
+        guard !remainingItems.isEmpty else {
             return queue.results
         }
 
-        // Continue processing
-        isProcessing = true
         isCancelled = false
-
-        var newResults: [CompressionResult] = []
-        let settings = queue.settings
-        let compressor = self.compressor
-
-        for (offset, item) in queue.items.enumerated() where offset >= completedCount {
-            // Skip already completed or failed
-            guard !item.state.isCompleted && !item.state.isFailed else { continue }
-
-            // Check for cancellation
-            if isCancelled {
-                queue.updateState(.cancelled)
-                break
-            }
-
-            // Update states
-            queue.updateState(.processing(currentIndex: offset, total: queue.count))
-            item.updateState(.compressing(progress: 0))
-
-            // Generate output URL
-            let outputURL = PDFCompressor.generateOutputURL(for: item.document.url, settings: settings)
-
-            do {
-                let documentURL = item.document.url
-
-                let result = try await Task.detached(priority: .userInitiated) {
-                    try compressor.compress(
-                        documentURL: documentURL,
-                        settings: settings,
-                        outputURL: outputURL
-                    )
-                }.value
-
-                item.updateState(.completed(result: result))
-                newResults.append(result)
-
-            } catch {
-                item.updateState(.failed(error: error.localizedDescription))
-            }
+        if case .paused(let index, let total) = queue.state {
+            queue.updateState(.processing(currentIndex: index, total: total))
         }
-
-        if !isCancelled {
-            queue.updateState(.completed)
-        }
-
-        isProcessing = false
+        try await run(remainingItems, in: queue)
         return queue.results
     }
 
@@ -200,5 +125,98 @@ final class BatchCompressionService {
               let currentIndex = queue.currentIndex,
               let item = queue.item(at: currentIndex) else { return }
         item.updateState(.skipped)
+
+        // Abort the native work so the worker moves on to the next document
+        if let index = activeItems.firstIndex(of: item) {
+            activeBatch?.cancel(itemAt: index)
+        }
+    }
+
+    // MARK: - Private Methods
+
+    /// Runs `process` as the in-flight task and waits for it
+    private func run(_ items: [BatchCompressionItem], in queue: BatchCompressionQueue) async throws {
+        let task = Task { try await process(items, in: queue) }
+        processingTask = task
+        defer {
+            if processingTask == task {
+                processingTask = nil
+            }
+        }
+        try await task.value
+    }
+
+    /// Compresses the given items concurrently, updating their state as they finish
+    private func process(_ items: [BatchCompressionItem], in queue: BatchCompressionQueue) async throws {
+        let settings = queue.settings
+        let batch = try CompressionBatch(settings: settings, maxConcurrentJobs: maxConcurrentJobs)
+
+        let jobs = items.map { item in
+            BatchCompressionJob(
+                documentURL: item.document.url,
+                outputURL: PDFCompressor.generateOutputURL(for: item.document.url, settings: settings),
+                originalSize: item.document.fileSize
+            )
+        }
+
+        activeBatch = batch
+        activeItems = items
+        isProcessing = true
+        updateProgress(of: queue)
+
+        for await event in compressor.compressBatch(jobs: jobs, settings: settings, batch: batch) {
+            switch event {
+            case .started(let index):
+                // Items skipped while waiting are left alone
+                if case .pending = items[index].state {
+                    items[index].updateState(.compressing(progress: 0))
+                }
+
+            case .progress(let index, _, let fraction):
+                if items[index].state.isActive {
+                    items[index].updateState(.compressing(progress: fraction))
+                }
+
+            case .completed(let index, let result):
+                let item = items[index]
+                if case .skipped = item.state {
+                    try? FileManager.default.removeItem(at: result.outputURL)
+                } else {
+                    item.updateState(.completed(result: result))
+                }
+
+            case .failed(let index, let error):
+                let item = items[index]
+                if case .skipped = item.state { break }
+                // Mark item as failed; other items continue
+                item.updateState(.failed(error: error))
+
+            case .cancelled(let index):
+                // Paused or cancelled mid-run; the item can be compressed again
+                let item = items[index]
+                if case .skipped = item.state { break }
+                item.updateState(.pending)
+            }
+
+            updateProgress(of: queue)
+        }
+
+        activeBatch = nil
+        activeItems = []
+        isProcessing = false
+
+        // Update final state
+        if isCancelled {
+            queue.updateState(.cancelled)
+        } else if !queue.state.isPaused {
+            queue.updateState(.completed)
+        }
+    }
+
+    /// Reflects the number of finished items in the queue state
+    private func updateProgress(of queue: BatchCompressionQueue) {
+        guard !queue.state.isPaused else { return }
+        let index = min(queue.processedCount, max(0, queue.count - 1))
+        queue.updateState(.processing(currentIndex: index, total: queue.count))
     }
 }
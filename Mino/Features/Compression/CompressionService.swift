@@ -17,6 +17,9 @@ final class CompressionService {
     /// The compression engine
     private let compressor = PDFCompressor()
 
+    /// Document inventory, used to tell whether compression will help
+    private let analyzer = PDFAnalyzer()
+
     /// The current compression job
     private(set) var currentJob: CompressionJob?
 
@@ -26,6 +29,9 @@ final class CompressionService {
     /// Whether compression is in progress
     private(set) var isCompressing = false
 
+    /// Cancels the compression in progress
+    private var activeCancellation: CompressionCancellation?
+
     /// Maximum number of recent results to keep
     private let maxRecentResults = 50
 
@@ -56,9 +62,13 @@ final class CompressionService {
         // Generate output URL
         let outputURL = PDFCompressor.generateOutputURL(for: document.url, settings: settings)
 
+        let cancellation = CompressionCancellation()
+        activeCancellation = cancellation
+        defer { activeCancellation = nil }
+
         do {
             // Update state
-            job.updateState(.compressing(progress: 0.5, phase: "Compressing..."))
+            job.updateState(.compressing(progress: 0, phase: "Compressing..."))
 
             // Capture values for detached task
             let compressor = self.compressor
@@ -69,7 +79,14 @@ final class CompressionService {
                 try compressor.compress(
                     documentURL: documentURL,
                     settings: settings,
-                    outputURL: outputURL
+                    outputURL: outputURL,
+                    cancellation: cancellation,
+                    progress: { phase, progress in
+                        Task { @MainActor in
+                            guard job.state.isActive else { return }
+                            job.updateState(.compressing(progress: progress, phase: phase.displayName))
+                        }
+                    }
                 )
             }.value
 
@@ -97,6 +114,38 @@ final class CompressionService {
         try await compress(document: document, settings: quality.settings)
     }
 
+    /// Predicts the compressed size of a document for every preset.
+    /// Returns an empty dictionary if the document cannot be estimated.
+    func estimateSizes(
+        for document: PDFDocumentInfo
+    ) async -> [CompressionQuality: CompressionEstimate] {
+        let compressor = self.compressor
+        let documentURL = document.url
+
+        let estimates = try? await Task.detached(priority: .utility) {
+            try compressor.estimateSizes(documentURL: documentURL)
+        }.value
+
+        return estimates ?? [:]
+    }
+
+    /// Breaks down what a document spends its bytes on.
+    /// Returns nil if the document cannot be analyzed.
+    func analyze(document: PDFDocumentInfo) async -> DocumentAnalysis? {
+        let analyzer = self.analyzer
+        let documentURL = document.url
+
+        return try? await Task.detached(priority: .utility) {
+            try analyzer.analyze(documentURL: documentURL)
+        }.value
+    }
+
+    /// Cancels the compression in progress; compress(document:settings:) then
+    /// throws MuPDFError.cancelled
+    func cancelCompression() {
+        activeCancellation?.cancel()
+    }
+
     /// Clears the current job
     func clearCurrentJob() {
         currentJob = nil
@@ -139,8 +188,9 @@ final class CompressionService {
         recentResults.removeAll()
         // Persist changes
         persistResults()
-        // Also clear statistics
+        // Also clear statistics and images cached from these documents
         HistoryManager.shared.clearHistory()
+        RecompressionCache.shared.clear()
     }
 
     // MARK: - Private Methods
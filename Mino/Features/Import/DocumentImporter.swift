@@ -134,23 +134,24 @@ final class DocumentImporter {
             .deletingPathExtension()
             .appendingPathExtension("pdf")
 
-        // Write data to file
+        // Validate with MuPDF straight from memory before anything is persisted
+        let pageCount: Int
         do {
-            try data.write(to: destinationURL)
+            let muDocument = try MuPDFDocument(data: data, sourceURL: destinationURL)
+            pageCount = muDocument.pageCount
+            muDocument.close()
         } catch {
-            throw ImportError.copyFailed(error)
+            throw ImportError.invalidPDF(error)
         }
 
-        // Validate and open with MuPDF
+        // Write data to file
         do {
-            let muDocument = try MuPDFDocument(url: destinationURL)
-            let documentInfo = PDFDocumentInfo(from: muDocument)
-            muDocument.close()
-            return documentInfo
+            try data.write(to: destinationURL)
         } catch {
-            try? fileManager.removeItem(at: destinationURL)
-            throw ImportError.invalidPDF(error)
+            throw ImportError.copyFailed(error)
         }
+
+        return PDFDocumentInfo(url: destinationURL, pageCount: pageCount)
     }
 
     // MARK: - Private Methods
@@ -12,6 +12,10 @@ struct MinoApp: App {
     /// Global application state
     @State private var appState = AppState()
 
+    init() {
+        EngineMemory.configure()
+    }
+
     var body: some Scene {
         WindowGroup {
             ContentView()
@@ -18,6 +18,8 @@ struct CompressionView: View {
     @State private var customSettings = CompressionSettings.default
     @State private var isCompressing = false
     @State private var currentPhase: CompressionPhase = .opening
+    @State private var estimates: [CompressionQuality: CompressionEstimate] = [:]
+    @State private var analysis: DocumentAnalysis?
 
     /// Whether this is a batch compression (multiple files)
     private var isBatch: Bool { documents.count > 1 }
@@ -50,6 +52,10 @@ struct CompressionView: View {
                                 DocumentListHeader(documents: documents)
                             } else if let document = documents.first {
                                 DocumentInfoHeader(document: document)
+
+                                if let analysis {
+                                    CompressionOutlookNote(analysis: analysis)
+                                }
                             }
 
                             Divider()
@@ -64,7 +70,7 @@ struct CompressionView: View {
                                 AdvancedSettingsView(settings: $customSettings)
                                     .disabled(isCompressing)
                             } else {
-                                QualitySelector(selectedQuality: $selectedQuality)
+                                QualitySelector(selectedQuality: $selectedQuality, estimates: estimates)
                                     .disabled(isCompressing)
                             }
 
@@ -113,6 +119,12 @@ struct CompressionView: View {
                 }
             }
             .interactiveDismissDisabled(isCompressing)
+            .task {
+                // Size predictions are only shown for a single document
+                guard !isBatch, let document = documents.first else { return }
+                analysis = await appState.compressionService.analyze(document: document)
+                estimates = await appState.compressionService.estimateSizes(for: document)
+            }
         }
     }
 
@@ -510,37 +522,67 @@ struct IndeterminateProgressBar: View {
 struct AdvancedSettingsView: View {
     @Binding var settings: CompressionSettings
 
+    private static let megabyte: Double = 1024 * 1024
+    private static let defaultTargetSize: Int64 = 10 * 1024 * 1024
+
     var body: some View {
         VStack(alignment: .leading, spacing: 20) {
             Text("Custom Settings")
                 .font(.headline)
                 .foregroundStyle(.white)
 
-            // JPEG Quality
-            SettingSlider(
-                title: "Image Quality",
-                value: Binding(
-                    get: { Double(settings.jpegQuality) },
-                    set: { settings.jpegQuality = Int($0) }
+            // Target size
+            SettingToggle(
+                title: "Target File Size",
+                isOn: Binding(
+                    get: { settings.targetSize != nil },
+                    set: { settings.targetSize = $0 ? Self.defaultTargetSize : nil }
                 ),
-                range: 10...100,
-                step: 5,
-                unit: "%",
-                description: "Lower = smaller file, reduced quality"
+                description: "Pick quality and DPI automatically to fit a size"
             )
 
-            // Target DPI
-            SettingSlider(
-                title: "Target DPI",
-                value: Binding(
-                    get: { Double(settings.targetDPI) },
-                    set: { settings.targetDPI = Int($0) }
-                ),
-                range: 50...300,
-                step: 10,
-                unit: " DPI",
-                description: "Resolution for downsampled images"
-            )
+            if settings.targetSize != nil {
+                SettingSlider(
+                    title: "Maximum Size",
+                    value: Binding(
+                        get: { Double(settings.targetSize ?? Self.defaultTargetSize) / Self.megabyte },
+                        set: { settings.targetSize = Int64($0 * Self.megabyte) }
+                    ),
+                    range: 1...50,
+                    step: 1,
+                    unit: " MB",
+                    description: "Common email attachment limits are 10-25 MB"
+                )
+            }
+
+            // Chosen by the engine when a target size is set
+            if settings.targetSize == nil {
+                // JPEG Quality
+                SettingSlider(
+                    title: "Image Quality",
+                    value: Binding(
+                        get: { Double(settings.jpegQuality) },
+                        set: { settings.jpegQuality = Int($0) }
+                    ),
+                    range: 10...100,
+                    step: 5,
+                    unit: "%",
+                    description: "Lower = smaller file, reduced quality"
+                )
+
+                // Target DPI
+                SettingSlider(
+                    title: "Target DPI",
+                    value: Binding(
+                        get: { Double(settings.targetDPI) },
+                        set: { settings.targetDPI = Int($0) }
+                    ),
+                    range: 50...300,
+                    step: 10,
+                    unit: " DPI",
+                    description: "Resolution for downsampled images"
+                )
+            }
 
             // Garbage Collection Level
             SettingSlider(
@@ -1039,10 +1081,45 @@ struct BatchFileProgressRow: View {
     }
 }
 
+// MARK: - Compression Outlook
+
+struct CompressionOutlookNote: View {
+    let analysis: DocumentAnalysis
+
+    private var iconName: String {
+        switch analysis.compressionOutlook {
+        case .significant: return "arrow.down.circle.fill"
+        case .moderate: return "arrow.down.circle"
+        case .minimal: return "info.circle"
+        }
+    }
+
+    var body: some View {
+        HStack(alignment: .top, spacing: 10) {
+            Image(systemName: iconName)
+                .foregroundStyle(Color.minoAccent)
+
+            VStack(alignment: .leading, spacing: 4) {
+                Text(analysis.compressionOutlook.message)
+                    .font(.caption)
+                    .foregroundStyle(.white.opacity(0.7))
+
+                Text("Images: \(ByteCountFormatter.string(fromByteCount: analysis.imageBytes, countStyle: .file)) · Fonts: \(ByteCountFormatter.string(fromByteCount: analysis.fontBytes, countStyle: .file))")
+                    .font(.caption2)
+                    .foregroundStyle(.white.opacity(0.4))
+            }
+
+            Spacer()
+        }
+        .padding(.horizontal)
+    }
+}
+
 // MARK: - Quality Selector
 
 struct QualitySelector: View {
     @Binding var selectedQuality: CompressionQuality
+    var estimates: [CompressionQuality: CompressionEstimate] = [:]
 
     var body: some View {
         VStack(alignment: .leading, spacing: 12) {
@@ -1054,7 +1131,8 @@ struct QualitySelector: View {
                 ForEach(CompressionQuality.allCases) { quality in
                     QualityOptionRow(
                         quality: quality,
-                        isSelected: selectedQuality == quality
+                        isSelected: selectedQuality == quality,
+                        estimate: estimates[quality]
                     )
                     .onTapGesture {
                         withAnimation(.easeInOut(duration: 0.2)) {
@@ -1072,6 +1150,7 @@ struct QualitySelector: View {
 struct QualityOptionRow: View {
     let quality: CompressionQuality
     let isSelected: Bool
+    var estimate: CompressionEstimate? = nil
 
     var body: some View {
         HStack(spacing: 12) {
@@ -1090,9 +1169,15 @@ struct QualityOptionRow: View {
                     .font(.caption)
                     .foregroundStyle(.white.opacity(0.6))
 
-                Text("Expected reduction: \(quality.expectedReduction)")
-                    .font(.caption2)
-                    .foregroundStyle(.white.opacity(0.4))
+                if let estimate {
+                    Text("Estimated size: \(estimate.formattedSize) (±\(estimate.formattedErrorBound))")
+                        .font(.caption2)
+                        .foregroundStyle(.white.opacity(0.4))
+                } else {
+                    Text("Expected reduction: \(quality.expectedReduction)")
+                        .font(.caption2)
+                        .foregroundStyle(.white.opacity(0.4))
+                }
             }
 
             Spacer()
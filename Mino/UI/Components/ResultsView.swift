@@ -176,6 +176,34 @@ struct ResultsView: View {
                     color: .indigo
                 )
             }
+
+            if result.keptOriginal {
+                Divider()
+                    .background(Color.minoCardBorder)
+
+                StatisticRow(
+                    icon: "doc.on.doc",
+                    label: "Output",
+                    value: "Original kept",
+                    color: .orange
+                )
+            }
+
+            if let target = result.sizeTarget {
+                Divider()
+                    .background(Color.minoCardBorder)
+
+                StatisticRow(
+                    icon: target.targetMet ? "checkmark.seal" : "exclamationmark.triangle",
+                    label: "Target Size",
+                    value: String(
+                        format: "%@ (%+.0f%%)",
+                        ByteCountFormatter.string(fromByteCount: target.targetSize, countStyle: .file),
+                        target.distanceFromTarget * 100
+                    ),
+                    color: target.targetMet ? .green : .orange
+                )
+            }
         }
         .padding()
         .background(Color.minoCardBackground)
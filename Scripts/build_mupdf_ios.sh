@@ -69,8 +69,14 @@ build_for_target() {
     export AR="$(xcrun --sdk $SDK --find ar)"
     export RANLIB="$(xcrun --sdk $SDK --find ranlib)"
 
-    # Disable optional features at compile time
-    local FEATURE_FLAGS="-DFZ_ENABLE_ICC=0 -DFZ_ENABLE_JS=0"
+    # Disable optional features at compile time. Mino only opens PDFs, so
+    # the other document handlers and the fonts and CSS only they use are
+    # left out; keep in sync with FEATURE_FLAGS in Tools/Makefile.
+    local FEATURE_FLAGS="-DFZ_ENABLE_ICC=0 -DFZ_ENABLE_JS=0 \
+        -DFZ_ENABLE_XPS=0 -DFZ_ENABLE_SVG=0 -DFZ_ENABLE_CBZ=0 -DFZ_ENABLE_IMG=0 \
+        -DFZ_ENABLE_HTML=0 -DFZ_ENABLE_EPUB=0 -DFZ_ENABLE_FB2=0 -DFZ_ENABLE_MOBI=0 \
+        -DFZ_ENABLE_TXT=0 -DFZ_ENABLE_OFFICE=0 -DFZ_ENABLE_HTML_ENGINE=0 \
+        -DTOFU_CJK_EXT -DTOFU_EMOJI -DTOFU_HISTORIC -DTOFU_SIL"
 
     if [ "$PLATFORM" = "iphoneos" ]; then
         export CFLAGS="$COMMON_CFLAGS $FEATURE_FLAGS -arch $ARCH -isysroot $SDK -miphoneos-version-min=$MIN_IOS_VERSION -target $ARCH-apple-ios$MIN_IOS_VERSION"
@@ -0,0 +1,168 @@
+#!/bin/bash
+#
+# Corpus checks for the in-memory compression paths. Each case generates a
+# small file with mino-gen, runs mino-cli on it and checks one engine
+# behaviour from the JSON reports:
+#
+#   indexed    Indexed images rewritten as JPEG name the colorspace they decode to
+#   mask       stencil masks (/ImageMask) count as drawn, with an effective DPI
+#   icc        copies with equal pixels but different ICC profiles stay apart
+#   no-gain    a tripped --ceiling reports "no_gain" and leaves no output
+#   estimate   an estimate above 200 dpi lands near the real compressed size
+#
+# Usage: Tools/check-engine.sh [work-dir]
+
+set -e
+
+TOOLS_DIR="$(cd "$(dirname "$0")" && pwd)"
+GEN="${MINO_GEN:-$TOOLS_DIR/build/mino-gen}"
+CLI="${MINO_CLI:-$TOOLS_DIR/build/mino-cli}"
+WORK="${1:-$(mktemp -d)}"
+
+for tool in "$GEN" "$CLI"; do
+    if [ ! -x "$tool" ]; then
+        echo "$(basename "$tool") not found at $tool; run: make -C Tools" >&2
+        exit 1
+    fi
+done
+
+mkdir -p "$WORK"
+failures=0
+
+# Value of the first integer field with this name in mino-cli's JSON report
+field() {
+    grep -o "\"$2\":[0-9-]*" "$1" | head -n 1 | cut -d: -f2
+}
+
+# Value of the first string field with this name
+string_field() {
+    grep -o "\"$2\":\"[^\"]*\"" "$1" | head -n 1 | cut -d'"' -f4
+}
+
+pass() {
+    echo "ok   $1 ($2)" >&2
+}
+
+fail() {
+    echo "FAIL $1: $2" >&2
+    failures=$((failures + 1))
+}
+
+check_indexed() {
+    local input="$WORK/indexed.pdf" output="$WORK/indexed-out.pdf"
+
+    "$GEN" -o "$input" --profile image-heavy --seed 4 --pages 4 \
+        --image-format indexed --image-size 600x450 > /dev/null
+    "$CLI" compress "$input" -o "$output" --replace always > "$WORK/indexed-compress.json"
+
+    if ! "$CLI" analyze "$output" > "$WORK/indexed-output.json"; then
+        fail indexed "output does not open"
+    elif grep -q '"colorspace":"Indexed","filters":"[^"]*DCTDecode' "$WORK/indexed-output.json"; then
+        fail indexed "a JPEG stream still names its palette"
+    elif [ "$(field "$WORK/indexed-compress.json" images_rewritten)" = "0" ]; then
+        fail indexed "no image was rewritten"
+    else
+        pass indexed "$(field "$WORK/indexed-compress.json" images_rewritten) rewritten"
+    fi
+}
+
+check_mask() {
+    local input="$WORK/mask.pdf"
+
+    "$GEN" -o "$input" --profile scanned --seed 5 --pages 3 \
+        --image-format mask --image-size 850x1100 > /dev/null
+    "$CLI" analyze "$input" > "$WORK/mask-input.json"
+
+    local images
+    images=$(field "$WORK/mask-input.json" images)
+    if [ "$images" != "3" ]; then
+        fail mask "expected 3 images, found $images"
+    elif grep -q '"uses":0' "$WORK/mask-input.json"; then
+        fail mask "a stencil mask was reported as never drawn"
+    elif grep -q '"effective_dpi":0[,}]' "$WORK/mask-input.json"; then
+        fail mask "a stencil mask has no effective DPI"
+    else
+        pass mask "$images masks drawn"
+    fi
+}
+
+# 12 placements of 3 distinct images stored as separate objects: without
+# profiles all repeats merge (9); with 2 profiles in rotation each image
+# survives once per profile (6)
+check_icc() {
+    local plain="$WORK/icc-plain.pdf" tagged="$WORK/icc-tagged.pdf"
+    local args=(--seed 6 --pages 6 --images 2 --unique-images 3 --duplicate-resources
+        --image-format flate --image-size 300x200 --fonts 0 --paths 0)
+
+    "$GEN" -o "$plain" "${args[@]}" > /dev/null
+    "$GEN" -o "$tagged" "${args[@]}" --icc-profiles 2 > /dev/null
+    "$CLI" compress "$plain" -o "$WORK/icc-plain-out.pdf" > "$WORK/icc-plain.json"
+    "$CLI" compress "$tagged" -o "$WORK/icc-tagged-out.pdf" > "$WORK/icc-tagged.json"
+
+    local merged_plain merged_tagged
+    merged_plain=$(field "$WORK/icc-plain.json" images_deduplicated)
+    merged_tagged=$(field "$WORK/icc-tagged.json" images_deduplicated)
+    if [ "$merged_plain" != "9" ]; then
+        fail icc "expected 9 duplicates without profiles, merged $merged_plain"
+    elif [ "$merged_tagged" != "6" ]; then
+        fail icc "expected 6 duplicates across 2 profiles, merged $merged_tagged"
+    else
+        pass icc "$merged_plain and $merged_tagged merged"
+    fi
+}
+
+check_no_gain() {
+    local input="$WORK/no-gain.pdf" output="$WORK/no-gain-out.pdf"
+
+    "$GEN" -o "$input" --profile image-heavy --seed 9 --pages 4 > /dev/null
+    rm -f "$output"
+    "$CLI" compress "$input" -o "$output" --ceiling 1K > "$WORK/no-gain.json" || true
+
+    local status
+    status=$(string_field "$WORK/no-gain.json" status)
+    if [ "$status" != "no_gain" ]; then
+        fail no-gain "status is $status"
+    elif [ -e "$output" ]; then
+        fail no-gain "a partial output was left behind"
+    else
+        pass no-gain "$status"
+    fi
+}
+
+# Scans drawn at about 340 dpi, estimated and compressed at 300 dpi, where
+# they keep their full resolution
+check_estimate() {
+    local input="$WORK/estimate.pdf" output="$WORK/estimate-out.pdf"
+    local settings=(--jpeg-quality 80 --dpi 300)
+
+    "$GEN" -o "$input" --profile scanned --seed 2 --pages 4 --image-size 2550x3400 > /dev/null
+    "$CLI" estimate "$input" "${settings[@]}" > "$WORK/estimate.json"
+    "$CLI" compress "$input" -o "$output" "${settings[@]}" --replace always > "$WORK/estimate-compress.json"
+
+    local predicted error actual
+    predicted=$(field "$WORK/estimate.json" predicted_bytes)
+    error=$(field "$WORK/estimate.json" error_bytes)
+    actual=$(field "$WORK/estimate-compress.json" output_bytes)
+
+    if [ -z "$actual" ] || [ -z "$predicted" ]; then
+        fail estimate "missing sizes in the reports"
+        return
+    fi
+
+    # Within the reported interval, or 15% of the real size
+    local allowed=$((error > actual * 15 / 100 ? error : actual * 15 / 100))
+    local diff=$((predicted > actual ? predicted - actual : actual - predicted))
+    if [ "$diff" -gt "$allowed" ]; then
+        fail estimate "predicted $predicted bytes, wrote $actual"
+    else
+        pass estimate "predicted $predicted, wrote $actual"
+    fi
+}
+
+check_indexed
+check_mask
+check_icc
+check_no_gain
+check_estimate
+
+exit $((failures > 0))
@@ -0,0 +1,73 @@
+#!/bin/bash
+#
+# Round-trip check for streaming compression: compress files that keep their
+# objects in object streams with mino-cli --window, then reopen the output
+# and make sure it parses cleanly with every page present. Images are
+# replaced under both policies, so the originals are also written verbatim,
+# and Indexed images must come out naming the colorspace they decode to.
+#
+# Usage: Tools/check-streaming.sh [work-dir]
+
+set -e
+
+TOOLS_DIR="$(cd "$(dirname "$0")" && pwd)"
+GEN="${MINO_GEN:-$TOOLS_DIR/build/mino-gen}"
+CLI="${MINO_CLI:-$TOOLS_DIR/build/mino-cli}"
+WORK="${1:-$(mktemp -d)}"
+
+for tool in "$GEN" "$CLI"; do
+    if [ ! -x "$tool" ]; then
+        echo "$(basename "$tool") not found at $tool; run: make -C Tools" >&2
+        exit 1
+    fi
+done
+
+mkdir -p "$WORK"
+failures=0
+
+# Value of a top-level integer field in mino-cli's JSON report
+field() {
+    grep -o "\"$2\":[0-9-]*" "$1" | head -n 1 | cut -d: -f2
+}
+
+check() {
+    local name="$1" replace="$2"
+    shift 2
+    local input="$WORK/$name.pdf" output="$WORK/$name-streamed.pdf"
+
+    "$GEN" -o "$input" --object-streams "$@" > /dev/null
+    "$CLI" analyze "$input" > "$WORK/$name-input.json"
+    "$CLI" compress "$input" -o "$output" --window 4 --replace "$replace" > /dev/null
+
+    if ! "$CLI" analyze "$output" > "$WORK/$name-output.json"; then
+        echo "FAIL $name: output does not open" >&2
+        failures=$((failures + 1))
+        return
+    fi
+
+    local pages_in pages_out repair
+    pages_in=$(field "$WORK/$name-input.json" pages)
+    pages_out=$(field "$WORK/$name-output.json" pages)
+    repair=$(field "$WORK/$name-output.json" repair_ns)
+
+    if [ "$pages_in" != "$pages_out" ]; then
+        echo "FAIL $name: $pages_in pages in, $pages_out out" >&2
+        failures=$((failures + 1))
+    elif [ "$repair" != "0" ]; then
+        echo "FAIL $name: output xref had to be repaired" >&2
+        failures=$((failures + 1))
+    elif grep -q '"colorspace":"Indexed","filters":"[^"]*DCTDecode' "$WORK/$name-output.json"; then
+        echo "FAIL $name: a JPEG stream still names its palette" >&2
+        failures=$((failures + 1))
+    else
+        echo "ok   $name ($pages_out pages)" >&2
+    fi
+}
+
+check vector-objstm if-smaller --profile vector-heavy --seed 7 --pages 12
+check image-objstm if-smaller --profile image-heavy --seed 3 --pages 12
+check image-objstm-always always --profile image-heavy --seed 3 --pages 12
+check indexed-objstm always --profile image-heavy --seed 4 --pages 6 --image-format indexed --image-size 600x450
+check text-objstm if-smaller --profile text-only --seed 8 --pages 30
+
+exit $((failures > 0))
@@ -0,0 +1,144 @@
+//
+//  json.c
+//  Mino Tools
+//
+//  Minimal streaming JSON writer for machine-readable tool output
+//
+
+#include "json.h"
+#include <math.h>
+
+void json_init(json_writer *w, FILE *out) {
+    w->out = out;
+    w->depth = 0;
+    w->needs_comma[0] = 0;
+}
+
+static void write_escaped(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        switch (c) {
+        case '"': fputs("\\\"", out); break;
+        case '\\': fputs("\\\\", out); break;
+        case '\n': fputs("\\n", out); break;
+        case '\r': fputs("\\r", out); break;
+        case '\t': fputs("\\t", out); break;
+        default:
+            if (c < 0x20) {
+                fprintf(out, "\\u%04x", c);
+            } else {
+                fputc(c, out);
+            }
+        }
+    }
+    fputc('"', out);
+}
+
+// Emit the separator and key that precede a value
+static void begin_value(json_writer *w, const char *key) {
+    if (w->needs_comma[w->depth]) {
+        fputc(',', w->out);
+    }
+    w->needs_comma[w->depth] = 1;
+
+    if (key) {
+        write_escaped(w->out, key);
+        fputc(':', w->out);
+    }
+}
+
+static void push(json_writer *w, char open) {
+    fputc(open, w->out);
+    if (w->depth < JSON_MAX_DEPTH - 1) {
+        w->depth++;
+    }
+    w->needs_comma[w->depth] = 0;
+}
+
+static void pop(json_writer *w, char close) {
+    fputc(close, w->out);
+    if (w->depth > 0) {
+        w->depth--;
+    }
+    if (w->depth == 0) {
+        fputc('\n', w->out);
+        fflush(w->out);
+    }
+}
+
+void json_begin_object(json_writer *w, const char *key) {
+    begin_value(w, key);
+    push(w, '{');
+}
+
+void json_end_object(json_writer *w) {
+    pop(w, '}');
+}
+
+void json_begin_array(json_writer *w, const char *key) {
+    begin_value(w, key);
+    push(w, '[');
+}
+
+void json_end_array(json_writer *w) {
+    pop(w, ']');
+}
+
+void json_string(json_writer *w, const char *key, const char *value) {
+    if (!value) {
+        json_null(w, key);
+        return;
+    }
+    begin_value(w, key);
+    write_escaped(w->out, value);
+}
+
+void json_int(json_writer *w, const char *key, int64_t value) {
+    begin_value(w, key);
+    fprintf(w->out, "%lld", (long long)value);
+}
+
+void json_double(json_writer *w, const char *key, double value) {
+    // JSON has no representation for NaN or infinity
+    if (!isfinite(value)) {
+        json_null(w, key);
+        return;
+    }
+    begin_value(w, key);
+    fprintf(w->out, "%.6g", value);
+}
+
+void json_bool(json_writer *w, const char *key, int value) {
+    begin_value(w, key);
+    fputs(value ? "true" : "false", w->out);
+}
+
+void json_null(json_writer *w, const char *key) {
+    begin_value(w, key);
+    fputs("null", w->out);
+}
+
+void json_stats(json_writer *w, const char *key, const mino_job_stats *stats) {
+    json_begin_object(w, key);
+    json_int(w, "open_ns", stats->open_ns);
+    json_int(w, "repair_ns", stats->repair_ns);
+    json_int(w, "scan_ns", stats->scan_ns);
+    json_int(w, "images_ns", stats->images_ns);
+    json_int(w, "gc_ns", stats->gc_ns);
+    json_int(w, "write_ns", stats->write_ns);
+    json_int(w, "render_ns", stats->render_ns);
+    json_int(w, "estimate_ns", stats->estimate_ns);
+    json_int(w, "images_rewritten", stats->images_rewritten);
+    json_int(w, "images_deduplicated", stats->images_deduplicated);
+    json_int(w, "image_cache_hits", stats->image_cache_hits);
+    json_int(w, "images_kept", stats->images_kept);
+    json_int(w, "display_list_hits", stats->display_list_hits);
+    json_int(w, "bytes_in", stats->bytes_in);
+    json_int(w, "image_bytes_in", stats->image_bytes_in);
+    json_int(w, "image_bytes_out", stats->image_bytes_out);
+    json_int(w, "bytes_out", stats->bytes_out);
+    json_int(w, "peak_heap_bytes", stats->peak_heap_bytes);
+    json_int(w, "store_evictions", stats->store_evictions);
+    json_end_object(w);
+}
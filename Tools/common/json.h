@@ -0,0 +1,42 @@
+//
+//  json.h
+//  Mino Tools
+//
+//  Minimal streaming JSON writer for machine-readable tool output
+//
+
+#ifndef MINO_TOOLS_JSON_H
+#define MINO_TOOLS_JSON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "MuPDFHelpers.h"
+
+// Writes one JSON value to a FILE, tracking where commas are needed.
+// Nesting is limited to JSON_MAX_DEPTH levels.
+#define JSON_MAX_DEPTH 16
+
+typedef struct {
+    FILE *out;
+    int depth;
+    int needs_comma[JSON_MAX_DEPTH];
+} json_writer;
+
+void json_init(json_writer *w, FILE *out);
+
+void json_begin_object(json_writer *w, const char *key);
+void json_end_object(json_writer *w);
+void json_begin_array(json_writer *w, const char *key);
+void json_end_array(json_writer *w);
+
+// key is NULL for array elements
+void json_string(json_writer *w, const char *key, const char *value);
+void json_int(json_writer *w, const char *key, int64_t value);
+void json_double(json_writer *w, const char *key, double value);
+void json_bool(json_writer *w, const char *key, int value);
+void json_null(json_writer *w, const char *key);
+
+// Writes the engine's per-phase measurements as an object
+void json_stats(json_writer *w, const char *key, const mino_job_stats *stats);
+
+#endif /* MINO_TOOLS_JSON_H */
@@ -0,0 +1,52 @@
+#!/bin/bash
+#
+# Generate the mino-bench corpus with mino-gen.
+#
+# Usage: Tools/generate-corpus.sh [corpus-dir]
+#
+# Every file is derived from its options and seed, so the same MuPDF version
+# produces the same corpus on every machine. Set JPX_SOURCE to a .jp2 file to
+# include JPEG 2000 images as well.
+
+set -e
+
+TOOLS_DIR="$(cd "$(dirname "$0")" && pwd)"
+GEN="${MINO_GEN:-$TOOLS_DIR/build/mino-gen}"
+CORPUS="${1:-$TOOLS_DIR/corpus}"
+
+if [ ! -x "$GEN" ]; then
+    echo "mino-gen not found at $GEN; run: make -C Tools mino-gen" >&2
+    exit 1
+fi
+
+gen() {
+    local category="$1" name="$2"
+    shift 2
+    mkdir -p "$CORPUS/$category"
+    echo "  $category/$name.pdf" >&2
+    "$GEN" --profile "$category" -o "$CORPUS/$category/$name.pdf" "$@" > /dev/null
+}
+
+echo "Generating corpus in $CORPUS" >&2
+
+gen scanned gray-jpeg --seed 1
+gen scanned gray-flate --seed 2 --image-format flate --pages 10
+
+gen image-heavy mixed --seed 3
+gen image-heavy jpeg-duplicates --seed 4 --image-format jpeg --unique-images 4 --duplicate-resources
+gen image-heavy flate --seed 5 --image-format flate --image-size 1000x750
+
+gen vector-heavy paths --seed 6
+gen vector-heavy paths-objstm --seed 7 --object-streams
+
+gen text-only fonts4 --seed 8
+gen text-only fonts14-duplicates --seed 9 --fonts 14 --duplicate-resources
+
+gen large pages1500 --seed 10
+gen large pages10000 --seed 11 --pages 10000 --images 0
+
+if [ -n "$JPX_SOURCE" ]; then
+    gen image-heavy jpx --seed 12 --image-format jpx --jpx-source "$JPX_SOURCE" --unique-images 1 --duplicate-resources
+fi
+
+echo "Done" >&2
@@ -0,0 +1,530 @@
+//
+//  main.c
+//  mino-bench
+//
+//  Benchmarks the Mino engine over a PDF corpus: compression at each
+//  CompressionQuality preset, merge, split and render. Every measurement runs
+//  in a forked child so peak RSS is per measurement; results are JSON.
+//
+//  Corpus layout: <corpus>/<category>/*.pdf, where category is one of
+//  scanned, image-heavy, vector-heavy, text-only or large (1000+ pages).
+//  Any other directory name is benchmarked under its own name.
+//
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "MuPDFHelpers.h"
+#include "json.h"
+
+#define MAX_FILES 4096
+#define MAX_ITERATIONS 50
+#define RENDER_PAGE_LIMIT 10
+
+// MARK: - Operations
+
+typedef enum {
+    OP_COMPRESS,
+    OP_MERGE,
+    OP_SPLIT,
+    OP_RENDER,
+    OP_COUNT
+} bench_op;
+
+static const char *const op_names[OP_COUNT] = { "compress", "merge", "split", "render" };
+
+// Matches CompressionQuality in the app
+typedef struct {
+    const char *name;
+    int jpeg_quality;
+    int target_dpi;
+    int garbage_level;
+} bench_preset;
+
+static const bench_preset presets[] = {
+    { "low", 30, 72, 4 },
+    { "medium", 50, 100, 4 },
+    { "high", 70, 150, 4 },
+};
+
+#define PRESET_COUNT ((int)(sizeof(presets) / sizeof(presets[0])))
+
+// Written by the child to the parent through a pipe
+typedef struct {
+    int status;
+    int pages;              // Pages processed
+    int64_t output_bytes;
+    int64_t duration_ns;
+    mino_job_stats stats;
+    char error[160];
+} op_result;
+
+typedef struct {
+    char path[1024];
+    char category[128];
+    int64_t bytes;
+} corpus_file;
+
+typedef struct {
+    const char *corpus;
+    const char *output;
+    const char *work_dir;
+    int iterations;
+    int ops[OP_COUNT];
+    int presets[PRESET_COUNT];
+} bench_options;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void fail(op_result *result, const char *fallback) {
+    const char *error = mino_get_last_error();
+    result->status = MINO_STATUS_ERROR;
+    snprintf(result->error, sizeof(result->error), "%s", error ? error : fallback);
+}
+
+// Graft pages [first, last] of src onto the end of dst
+static int graft_range(fz_context *ctx, pdf_document *dst, pdf_document *src, int first, int last) {
+    pdf_graft_map *map = mino_new_graft_map(ctx, dst);
+    if (!map) return -1;
+
+    int result = 0;
+    for (int i = first; i <= last && result == 0; i++) {
+        result = mino_graft_page(ctx, map, -1, src, i);
+    }
+    mino_drop_graft_map(ctx, map);
+    return result;
+}
+
+static int save_range(
+    fz_context *ctx,
+    pdf_document *src,
+    int first,
+    int last,
+    const char *path,
+    mino_job *job
+) {
+    pdf_document *dst = mino_create_pdf_document(ctx);
+    if (!dst) return -1;
+
+    int result = graft_range(ctx, dst, src, first, last);
+    if (result == 0) {
+        result = mino_save_pdf_job(ctx, dst, path, 3, job);
+    }
+    mino_drop_pdf_document(ctx, dst);
+    return result;
+}
+
+// Run one operation on one file; called in the child process
+static void run_op(
+    bench_op op,
+    const bench_preset *preset,
+    const corpus_file *file,
+    const char *work_dir,
+    op_result *result
+) {
+    memset(result, 0, sizeof(*result));
+
+    char out1[1200];
+    char out2[1200];
+    snprintf(out1, sizeof(out1), "%s/out1.%s", work_dir, op == OP_RENDER ? "png" : "pdf");
+    snprintf(out2, sizeof(out2), "%s/out2.pdf", work_dir);
+
+    fz_context *ctx = mino_create_context();
+    if (!ctx) {
+        fail(result, "Failed to create context");
+        return;
+    }
+
+    mino_job job = { .stats = &result->stats, .image_replace = MINO_REPLACE_IF_SMALLER };
+    int64_t start = now_ns();
+
+    fz_document *doc = mino_open_document_job(ctx, file->path, &job);
+    pdf_document *pdf = doc ? mino_pdf_specifics(ctx, doc) : NULL;
+    int pages = doc ? mino_count_pages(ctx, doc) : -1;
+
+    if (!pdf || pages <= 0) {
+        fail(result, "The file is not a valid PDF document");
+    } else if (op == OP_COMPRESS) {
+        result->pages = pages;
+        if (mino_compress_pdf_job(ctx, pdf, out1, preset->jpeg_quality, preset->target_dpi,
+                                  preset->garbage_level, &job) != MINO_STATUS_OK) {
+            fail(result, "Compression failed");
+        }
+    } else if (op == OP_MERGE) {
+        // Merge the document with a second copy of itself
+        result->pages = pages * 2;
+        pdf_document *dst = mino_create_pdf_document(ctx);
+        if (!dst ||
+            graft_range(ctx, dst, pdf, 0, pages - 1) != 0 ||
+            graft_range(ctx, dst, pdf, 0, pages - 1) != 0 ||
+            mino_save_pdf_job(ctx, dst, out1, 3, &job) != MINO_STATUS_OK) {
+            fail(result, "Merge failed");
+        }
+        mino_drop_pdf_document(ctx, dst);
+    } else if (op == OP_SPLIT) {
+        // Split in the middle, like PDFSplitter.splitAtPage
+        result->pages = pages;
+        if (pages < 2) {
+            fail(result, "Document must have at least 2 pages to split");
+        } else if (save_range(ctx, pdf, 0, pages / 2 - 1, out1, &job) != 0 ||
+                   save_range(ctx, pdf, pages / 2, pages - 1, out2, &job) != 0) {
+            fail(result, "Split failed");
+        }
+    } else {
+        int count = pages < RENDER_PAGE_LIMIT ? pages : RENDER_PAGE_LIMIT;
+        result->pages = count;
+        for (int i = 0; i < count && result->status == MINO_STATUS_OK; i++) {
+            fz_pixmap *pix = mino_render_page_job(ctx, doc, i, 1.0f, &job);
+            if (!pix) {
+                fail(result, "Render failed");
+            } else {
+                result->output_bytes += (int64_t)mino_pixmap_stride(ctx, pix) * mino_pixmap_height(ctx, pix);
+                mino_drop_pixmap(ctx, pix);
+            }
+        }
+    }
+
+    result->duration_ns = now_ns() - start;
+
+    if (result->status == MINO_STATUS_OK && op != OP_RENDER) {
+        result->output_bytes = mino_get_file_size(out1);
+        if (op == OP_SPLIT) {
+            result->output_bytes += mino_get_file_size(out2);
+        }
+    }
+
+    mino_drop_document(ctx, doc);
+    mino_drop_context(ctx);
+    unlink(out1);
+    unlink(out2);
+}
+
+// MARK: - Measurement
+
+// Fork, run the operation in the child and collect its result and peak RSS
+static int measure(
+    bench_op op,
+    const bench_preset *preset,
+    const corpus_file *file,
+    const char *work_dir,
+    op_result *result,
+    int64_t *peak_rss
+) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        op_result child;
+        run_op(op, preset, file, work_dir, &child);
+        ssize_t written = write(fds[1], &child, sizeof(child));
+        close(fds[1]);
+        _exit(written == (ssize_t)sizeof(child) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    size_t got = 0;
+    while (got < sizeof(*result)) {
+        ssize_t n = read(fds[0], (char *)result + got, sizeof(*result) - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    close(fds[0]);
+
+    int wstatus = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    while (wait4(pid, &wstatus, 0, &usage) < 0 && errno == EINTR) {
+    }
+
+#ifdef __APPLE__
+    *peak_rss = (int64_t)usage.ru_maxrss;           // Bytes
+#else
+    *peak_rss = (int64_t)usage.ru_maxrss * 1024;    // Kilobytes
+#endif
+
+    if (got != sizeof(*result)) {
+        memset(result, 0, sizeof(*result));
+        result->status = MINO_STATUS_ERROR;
+        snprintf(result->error, sizeof(result->error), "Benchmark process exited abnormally (status %d)", wstatus);
+    }
+    return 0;
+}
+
+static int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Run one measurement `iterations` times and report the median
+static void bench_one(
+    json_writer *w,
+    const bench_options *opts,
+    bench_op op,
+    const bench_preset *preset,
+    const corpus_file *file
+) {
+    int64_t durations[MAX_ITERATIONS];
+    int64_t peak_rss = 0;
+    op_result result;
+    int runs = 0;
+
+    for (int i = 0; i < opts->iterations; i++) {
+        int64_t rss = 0;
+        if (measure(op, preset, file, opts->work_dir, &result, &rss) != 0) {
+            memset(&result, 0, sizeof(result));
+            result.status = MINO_STATUS_ERROR;
+            snprintf(result.error, sizeof(result.error), "%s", strerror(errno));
+        }
+        if (result.status != MINO_STATUS_OK) break;
+
+        durations[runs++] = result.duration_ns;
+        if (rss > peak_rss) peak_rss = rss;
+    }
+
+    json_begin_object(w, NULL);
+    json_string(w, "file", file->path);
+    json_string(w, "category", file->category);
+    json_string(w, "operation", op_names[op]);
+    if (preset) {
+        json_string(w, "preset", preset->name);
+    } else {
+        json_null(w, "preset");
+    }
+    json_int(w, "input_bytes", file->bytes);
+
+    if (result.status == MINO_STATUS_OK && runs > 0) {
+        qsort(durations, (size_t)runs, sizeof(int64_t), compare_int64);
+        int64_t median = durations[runs / 2];
+        double seconds = (double)median / 1e9;
+
+        json_string(w, "status", "ok");
+        json_int(w, "iterations", runs);
+        json_int(w, "pages", result.pages);
+        json_int(w, "output_bytes", result.output_bytes);
+        json_double(w, "seconds", seconds);
+        json_double(w, "min_seconds", (double)durations[0] / 1e9);
+        json_double(w, "max_seconds", (double)durations[runs - 1] / 1e9);
+        json_double(w, "mb_per_s", seconds > 0 ? (double)file->bytes / (1024.0 * 1024.0) / seconds : 0);
+        json_double(w, "pages_per_s", seconds > 0 ? result.pages / seconds : 0);
+        json_int(w, "peak_rss_bytes", peak_rss);
+        if (op == OP_RENDER) {
+            json_null(w, "ratio");
+        } else {
+            json_double(w, "ratio", file->bytes > 0 ? (double)result.output_bytes / (double)file->bytes : 1.0);
+        }
+        json_stats(w, "stats", &result.stats);
+    } else {
+        json_string(w, "status", "error");
+        json_string(w, "error", result.error);
+    }
+    json_end_object(w);
+
+    fprintf(stderr, "%-8s %-6s %s: %s\n",
+        op_names[op], preset ? preset->name : "-", file->path,
+        result.status == MINO_STATUS_OK ? "ok" : result.error);
+}
+
+// MARK: - Corpus
+
+static int is_pdf(const char *name) {
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".pdf") == 0;
+}
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const corpus_file *)a)->path, ((const corpus_file *)b)->path);
+}
+
+// Collect <corpus>/<category>/*.pdf, sorted by path so runs line up
+static int scan_corpus(const char *root, corpus_file *files, int max_files) {
+    DIR *top = opendir(root);
+    if (!top) return -1;
+
+    int count = 0;
+    struct dirent *category;
+    while ((category = readdir(top)) != NULL && count < max_files) {
+        if (category->d_name[0] == '.') continue;
+
+        char dir_path[1024];
+        snprintf(dir_path, sizeof(dir_path), "%s/%s", root, category->d_name);
+        DIR *dir = opendir(dir_path);
+        if (!dir) continue;
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL && count < max_files) {
+            if (!is_pdf(entry->d_name)) continue;
+
+            corpus_file *file = &files[count];
+            snprintf(file->path, sizeof(file->path), "%s/%s", dir_path, entry->d_name);
+            snprintf(file->category, sizeof(file->category), "%s", category->d_name);
+
+            struct stat st;
+            if (stat(file->path, &st) == 0 && S_ISREG(st.st_mode)) {
+                file->bytes = (int64_t)st.st_size;
+                count++;
+            }
+        }
+        closedir(dir);
+    }
+    closedir(top);
+
+    qsort(files, (size_t)count, sizeof(corpus_file), compare_files);
+    return count;
+}
+
+// MARK: - Options
+
+static void usage(FILE *out) {
+    fputs(
+        "usage: mino-bench [--corpus DIR] [--output FILE] [--iterations N]\n"
+        "                  [--ops compress,merge,split,render] [--presets low,medium,high]\n"
+        "\n"
+        "The corpus is laid out as DIR/<category>/*.pdf (default: Tools/corpus).\n"
+        "Results are written as JSON to FILE, or stdout; progress goes to stderr.\n",
+        out
+    );
+}
+
+// Parse a comma-separated list of names into enabled flags
+static int parse_list(const char *text, const char *const *names, int count, int *enabled) {
+    memset(enabled, 0, sizeof(int) * (size_t)count);
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text);
+    for (char *token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+        int found = 0;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(token, names[i]) == 0) {
+                enabled[i] = 1;
+                found = 1;
+            }
+        }
+        if (!found) return -1;
+    }
+    return 0;
+}
+
+static int parse_options(int argc, char **argv, bench_options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->corpus = "Tools/corpus";
+    opts->iterations = 3;
+    for (int i = 0; i < OP_COUNT; i++) opts->ops[i] = 1;
+    for (int i = 0; i < PRESET_COUNT; i++) opts->presets[i] = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) return -1;
+        i++;
+
+        if (strcmp(arg, "--corpus") == 0) {
+            opts->corpus = value;
+        } else if (strcmp(arg, "--output") == 0 || strcmp(arg, "-o") == 0) {
+            opts->output = value;
+        } else if (strcmp(arg, "--iterations") == 0) {
+            opts->iterations = atoi(value);
+            if (opts->iterations < 1 || opts->iterations > MAX_ITERATIONS) return -1;
+        } else if (strcmp(arg, "--ops") == 0) {
+            if (parse_list(value, op_names, OP_COUNT, opts->ops) != 0) return -1;
+        } else if (strcmp(arg, "--presets") == 0) {
+            const char *names[PRESET_COUNT];
+            for (int p = 0; p < PRESET_COUNT; p++) names[p] = presets[p].name;
+            if (parse_list(value, names, PRESET_COUNT, opts->presets) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// MARK: - Main
+
+int main(int argc, char **argv) {
+    bench_options opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        usage(stderr);
+        return 2;
+    }
+
+    static corpus_file files[MAX_FILES];
+    int count = scan_corpus(opts.corpus, files, MAX_FILES);
+    if (count <= 0) {
+        fprintf(stderr, "mino-bench: no PDFs found under %s/<category>/\n", opts.corpus);
+        return 1;
+    }
+
+    char work_dir[] = "/tmp/mino-bench-XXXXXX";
+    if (!mkdtemp(work_dir)) {
+        perror("mino-bench: mkdtemp");
+        return 1;
+    }
+    opts.work_dir = work_dir;
+
+    FILE *out = stdout;
+    if (opts.output) {
+        out = fopen(opts.output, "w");
+        if (!out) {
+            perror("mino-bench: output");
+            rmdir(work_dir);
+            return 1;
+        }
+    }
+
+    json_writer w;
+    json_init(&w, out);
+    json_begin_object(&w, NULL);
+    json_string(&w, "corpus", opts.corpus);
+    json_int(&w, "timestamp", (int64_t)time(NULL));
+    json_int(&w, "cores", sysconf(_SC_NPROCESSORS_ONLN));
+    json_int(&w, "iterations", opts.iterations);
+    json_begin_array(&w, "results");
+
+    for (int i = 0; i < count; i++) {
+        for (int op = 0; op < OP_COUNT; op++) {
+            if (!opts.ops[op]) continue;
+
+            if (op == OP_COMPRESS) {
+                for (int p = 0; p < PRESET_COUNT; p++) {
+                    if (opts.presets[p]) {
+                        bench_one(&w, &opts, (bench_op)op, &presets[p], &files[i]);
+                    }
+                }
+            } else {
+                bench_one(&w, &opts, (bench_op)op, NULL, &files[i]);
+            }
+        }
+    }
+
+    json_end_array(&w);
+    json_end_object(&w);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    rmdir(work_dir);
+    return 0;
+}
@@ -0,0 +1,739 @@
+//
+//  main.c
+//  mino-cli
+//
+//  Headless front end for the Mino engine: compress, merge, split and render
+//  PDFs with the same code the app ships, reporting results as JSON.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MuPDFHelpers.h"
+#include "json.h"
+
+#define MAX_INPUTS 256
+#define IMAGE_CACHE_BYTES ((int64_t)256 * 1024 * 1024)    // Matches RecompressionCache.shared
+
+enum {
+    EXIT_OK = 0,
+    EXIT_FAILED = 1,
+    EXIT_USAGE = 2
+};
+
+// MARK: - Options
+
+// Mirrors CompressionSettings (and its clamping) in the app
+typedef struct {
+    int jpeg_quality;
+    int target_dpi;
+    int garbage_level;
+    int64_t target_size;    // Bytes; 0 to use the quality settings
+    int64_t size_ceiling;   // Bytes; 0 for no limit, -1 for the input's size
+    int window_pages;       // Compress streaming, this many pages at a time (0 for off)
+    mino_replace_policy replace;
+} compress_settings;
+
+typedef struct {
+    const char *command;
+    const char *inputs[MAX_INPUTS];
+    int input_count;
+    const char *outputs[2];
+    int output_count;
+    compress_settings settings;
+    int settings_given;     // --quality, --jpeg-quality or --dpi appeared
+    int range_start;        // 1-based, inclusive
+    int range_end;
+    int split_at;           // 1-based first page of the second part
+    int page;               // 1-based
+    float zoom;
+    const char *image_cache_dir;
+    mino_image_cache *image_cache;  // Opened by main when image_cache_dir is set
+    int64_t memory_limit;   // Bytes the engine may allocate; 0 for no limit
+} cli_options;
+
+static void usage(FILE *out) {
+    fputs(
+        "usage: mino-cli <command> [options]\n"
+        "\n"
+        "commands:\n"
+        "  compress <input.pdf> -o <output.pdf> [--quality low|medium|high]\n"
+        "           [--jpeg-quality 1-100] [--dpi 50-300] [--garbage 0-4]\n"
+        "           [--target-size SIZE[K|M|G]] [--image-cache DIR]\n"
+        "           [--ceiling SIZE[K|M|G]|input] [--window PAGES]\n"
+        "           [--replace if-smaller|always]\n"
+        "  estimate <input.pdf> [--quality low|medium|high]\n"
+        "           [--jpeg-quality 1-100] [--dpi 50-300]\n"
+        "  analyze  <input.pdf>\n"
+        "  merge    <input.pdf>... -o <output.pdf>\n"
+        "  split    <input.pdf> --range <first>-<last> -o <output.pdf>\n"
+        "  split    <input.pdf> --at <page> -o <part1.pdf> -o <part2.pdf>\n"
+        "  render   <input.pdf> -o <output.png> [--page N] [--zoom Z]\n"
+        "\n"
+        "Every command accepts --memory-limit SIZE[K|M|G] to cap the engine's heap.\n"
+        "Pages are numbered from 1. Results are written to stdout as JSON;\n"
+        "the exit status is 0 on success, 1 on failure and 2 on bad usage.\n",
+        out
+    );
+}
+
+static int clamp(int value, int low, int high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+// Presets match CompressionQuality
+static int apply_preset(compress_settings *settings, const char *name) {
+    if (strcmp(name, "low") == 0) {
+        settings->jpeg_quality = 30;
+        settings->target_dpi = 72;
+    } else if (strcmp(name, "medium") == 0) {
+        settings->jpeg_quality = 50;
+        settings->target_dpi = 100;
+    } else if (strcmp(name, "high") == 0) {
+        settings->jpeg_quality = 70;
+        settings->target_dpi = 150;
+    } else {
+        return -1;
+    }
+    settings->garbage_level = 4;
+    return 0;
+}
+
+static int parse_int(const char *text, int *value) {
+    char *end = NULL;
+    long parsed = strtol(text, &end, 10);
+    if (!text[0] || *end) return -1;
+    *value = (int)parsed;
+    return 0;
+}
+
+// Byte count with an optional binary K, M or G suffix
+static int parse_size(const char *text, int64_t *value) {
+    char *end = NULL;
+    double parsed = strtod(text, &end);
+    if (end == text || parsed <= 0) return -1;
+
+    switch (*end) {
+    case 'K': case 'k': parsed *= 1024.0; end++; break;
+    case 'M': case 'm': parsed *= 1024.0 * 1024.0; end++; break;
+    case 'G': case 'g': parsed *= 1024.0 * 1024.0 * 1024.0; end++; break;
+    default: break;
+    }
+    if (*end) return -1;
+
+    *value = (int64_t)parsed;
+    return *value > 0 ? 0 : -1;
+}
+
+static int parse_range(const char *text, int *first, int *last) {
+    char *end = NULL;
+    long a = strtol(text, &end, 10);
+    if (end == text) return -1;
+
+    long b = a;
+    if (*end == '-') {
+        const char *second = end + 1;
+        b = strtol(second, &end, 10);
+        if (end == second) return -1;
+    }
+    if (*end) return -1;
+
+    *first = (int)a;
+    *last = (int)b;
+    return 0;
+}
+
+static int parse_options(int argc, char **argv, cli_options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    apply_preset(&opts->settings, "medium");
+    opts->settings.replace = MINO_REPLACE_IF_SMALLER;
+    opts->page = 1;
+    opts->zoom = 1.0f;
+
+    if (argc < 2) return -1;
+    opts->command = argv[1];
+
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (arg[0] != '-' || arg[1] == '\0') {
+            if (opts->input_count == MAX_INPUTS) return -1;
+            opts->inputs[opts->input_count++] = arg;
+            continue;
+        }
+
+        if (!value) return -1;
+        i++;
+
+        if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+            if (opts->output_count == 2) return -1;
+            opts->outputs[opts->output_count++] = value;
+        } else if (strcmp(arg, "--quality") == 0) {
+            if (apply_preset(&opts->settings, value) != 0) return -1;
+            opts->settings_given = 1;
+        } else if (strcmp(arg, "--jpeg-quality") == 0) {
+            if (parse_int(value, &opts->settings.jpeg_quality) != 0) return -1;
+            opts->settings_given = 1;
+        } else if (strcmp(arg, "--dpi") == 0) {
+            if (parse_int(value, &opts->settings.target_dpi) != 0) return -1;
+            opts->settings_given = 1;
+        } else if (strcmp(arg, "--garbage") == 0) {
+            if (parse_int(value, &opts->settings.garbage_level) != 0) return -1;
+        } else if (strcmp(arg, "--target-size") == 0) {
+            if (parse_size(value, &opts->settings.target_size) != 0) return -1;
+        } else if (strcmp(arg, "--ceiling") == 0) {
+            if (strcmp(value, "input") == 0) {
+                opts->settings.size_ceiling = -1;
+            } else if (parse_size(value, &opts->settings.size_ceiling) != 0) {
+                return -1;
+            }
+        } else if (strcmp(arg, "--window") == 0) {
+            if (parse_int(value, &opts->settings.window_pages) != 0 || opts->settings.window_pages < 1) return -1;
+        } else if (strcmp(arg, "--replace") == 0) {
+            if (strcmp(value, "if-smaller") == 0) {
+                opts->settings.replace = MINO_REPLACE_IF_SMALLER;
+            } else if (strcmp(value, "always") == 0) {
+                opts->settings.replace = MINO_REPLACE_ALWAYS;
+            } else {
+                return -1;
+            }
+        } else if (strcmp(arg, "--memory-limit") == 0) {
+            if (parse_size(value, &opts->memory_limit) != 0) return -1;
+        } else if (strcmp(arg, "--image-cache") == 0) {
+            opts->image_cache_dir = value;
+        } else if (strcmp(arg, "--range") == 0) {
+            if (parse_range(value, &opts->range_start, &opts->range_end) != 0) return -1;
+        } else if (strcmp(arg, "--at") == 0) {
+            if (parse_int(value, &opts->split_at) != 0) return -1;
+        } else if (strcmp(arg, "--page") == 0) {
+            if (parse_int(value, &opts->page) != 0) return -1;
+        } else if (strcmp(arg, "--zoom") == 0) {
+            opts->zoom = strtof(value, NULL);
+            if (opts->zoom <= 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+
+    opts->settings.jpeg_quality = clamp(opts->settings.jpeg_quality, 1, 100);
+    opts->settings.target_dpi = clamp(opts->settings.target_dpi, 50, 300);
+    opts->settings.garbage_level = clamp(opts->settings.garbage_level, 0, 4);
+    return 0;
+}
+
+// MARK: - Reporting
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char* last_error(const char *fallback) {
+    const char *error = mino_get_last_error();
+    return error ? error : fallback;
+}
+
+// Every command reports one object: command, status, then its own fields
+static void begin_report(json_writer *w, const char *command, int status, const char *error) {
+    json_begin_object(w, NULL);
+    json_string(w, "command", command);
+    json_string(w, "status",
+        status == MINO_STATUS_OK ? "ok" :
+        status == MINO_STATUS_CANCELLED ? "cancelled" :
+        status == MINO_STATUS_NO_GAIN ? "no_gain" : "error");
+    if (status != MINO_STATUS_OK) {
+        json_string(w, "error", error);
+    }
+}
+
+static void report_output(json_writer *w, const char *path) {
+    json_begin_object(w, NULL);
+    json_string(w, "path", path);
+    json_int(w, "bytes", mino_get_file_size(path));
+    json_end_object(w);
+}
+
+// MARK: - Commands
+
+static int run_compress(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    if (opts->input_count != 1 || opts->output_count != 1) return EXIT_USAGE;
+
+    const char *input = opts->inputs[0];
+    const char *output = opts->outputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats, .image_cache = opts->image_cache };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    compress_settings settings = opts->settings;
+
+    if (settings.size_ceiling < 0) {
+        settings.size_ceiling = mino_get_file_size(input);
+    }
+    job.size_ceiling = settings.size_ceiling > 0 ? settings.size_ceiling : 0;
+    job.image_replace = settings.replace;
+    mino_size_result target = {0};
+
+    fz_document *doc = mino_open_document_job(ctx, input, &job);
+    if (doc) {
+        pdf_document *pdf = mino_pdf_specifics(ctx, doc);
+        if (pdf && settings.target_size > 0) {
+            status = mino_compress_pdf_to_size(
+                ctx, pdf, output,
+                settings.target_size,
+                settings.garbage_level,
+                &target,
+                &job
+            );
+            settings.jpeg_quality = target.jpeg_quality;
+            settings.target_dpi = target.target_dpi;
+        } else if (pdf && settings.window_pages > 0) {
+            status = mino_compress_pdf_streaming(
+                ctx, pdf, output,
+                settings.jpeg_quality,
+                settings.target_dpi,
+                settings.garbage_level,
+                settings.window_pages,
+                &job
+            );
+        } else if (pdf) {
+            status = mino_compress_pdf_job(
+                ctx, pdf, output,
+                settings.jpeg_quality,
+                settings.target_dpi,
+                settings.garbage_level,
+                &job
+            );
+        }
+        mino_drop_document(ctx, doc);
+    }
+
+    begin_report(w, "compress", status, last_error("The file is not a valid PDF document"));
+    json_string(w, "input", input);
+    json_int(w, "input_bytes", mino_get_file_size(input));
+    json_begin_object(w, "settings");
+    json_int(w, "jpeg_quality", settings.jpeg_quality);
+    json_int(w, "target_dpi", settings.target_dpi);
+    json_int(w, "garbage_level", settings.garbage_level);
+    json_string(w, "replace", settings.replace == MINO_REPLACE_ALWAYS ? "always" : "if-smaller");
+    if (settings.size_ceiling > 0) {
+        json_int(w, "size_ceiling", settings.size_ceiling);
+    }
+    if (settings.window_pages > 0) {
+        json_int(w, "window_pages", settings.window_pages);
+    }
+    json_end_object(w);
+    if (settings.target_size > 0 && status == MINO_STATUS_OK) {
+        json_begin_object(w, "target");
+        json_int(w, "target_bytes", target.target_bytes);
+        json_int(w, "predicted_bytes", target.predicted_bytes);
+        json_int(w, "actual_bytes", target.actual_bytes);
+        json_double(w, "prediction_error",
+            target.actual_bytes > 0
+                ? (double)(target.predicted_bytes - target.actual_bytes) / (double)target.actual_bytes
+                : 0);
+        json_int(w, "probes", target.probes);
+        json_int(w, "sampled_images", target.sampled_images);
+        json_bool(w, "met", target.target_met);
+        json_end_object(w);
+    }
+    if (status == MINO_STATUS_OK) {
+        int64_t input_bytes = mino_get_file_size(input);
+        int64_t output_bytes = mino_get_file_size(output);
+        json_string(w, "output", output);
+        json_int(w, "output_bytes", output_bytes);
+        json_double(w, "ratio", input_bytes > 0 ? (double)output_bytes / (double)input_bytes : 1.0);
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+// Predicted output size of every preset, or of the settings given, without
+// writing anything
+static int run_estimate(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    if (opts->input_count != 1 || opts->output_count != 0) return EXIT_USAGE;
+
+    static const char *const presets[] = { "low", "medium", "high" };
+    enum { PRESET_COUNT = sizeof(presets) / sizeof(presets[0]) };
+
+    const char *input = opts->inputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    mino_size_estimate estimates[PRESET_COUNT] = {{0}};
+    int count = opts->settings_given ? 1 : PRESET_COUNT;
+
+    if (opts->settings_given) {
+        estimates[0].jpeg_quality = opts->settings.jpeg_quality;
+        estimates[0].target_dpi = opts->settings.target_dpi;
+    } else {
+        for (int i = 0; i < PRESET_COUNT; i++) {
+            compress_settings settings;
+            apply_preset(&settings, presets[i]);
+            estimates[i].jpeg_quality = settings.jpeg_quality;
+            estimates[i].target_dpi = settings.target_dpi;
+        }
+    }
+
+    fz_document *doc = mino_open_document_job(ctx, input, &job);
+    if (doc) {
+        pdf_document *pdf = mino_pdf_specifics(ctx, doc);
+        if (pdf) {
+            status = mino_estimate_compression(ctx, pdf, estimates, count, &job);
+        }
+        mino_drop_document(ctx, doc);
+    }
+
+    begin_report(w, "estimate", status, last_error("The file is not a valid PDF document"));
+    json_string(w, "input", input);
+    json_int(w, "input_bytes", mino_get_file_size(input));
+    if (status == MINO_STATUS_OK) {
+        json_begin_array(w, "estimates");
+        for (int i = 0; i < count; i++) {
+            json_begin_object(w, NULL);
+            json_string(w, "preset", opts->settings_given ? "custom" : presets[i]);
+            json_int(w, "jpeg_quality", estimates[i].jpeg_quality);
+            json_int(w, "target_dpi", estimates[i].target_dpi);
+            json_int(w, "predicted_bytes", estimates[i].predicted_bytes);
+            json_int(w, "error_bytes", estimates[i].error_bytes);
+            json_end_object(w);
+        }
+        json_end_array(w);
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+// Where the bytes of a document go, image by image
+static int run_analyze(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    if (opts->input_count != 1 || opts->output_count != 0) return EXIT_USAGE;
+
+    const char *input = opts->inputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    mino_document_analysis a;
+
+    memset(&a, 0, sizeof(a));
+
+    fz_document *doc = mino_open_document_job(ctx, input, &job);
+    if (doc) {
+        pdf_document *pdf = mino_pdf_specifics(ctx, doc);
+        if (pdf) {
+            status = mino_analyze_document(ctx, pdf, &a, &job);
+        }
+        mino_drop_document(ctx, doc);
+    }
+
+    begin_report(w, "analyze", status, last_error("The file is not a valid PDF document"));
+    json_string(w, "input", input);
+    if (status == MINO_STATUS_OK) {
+        json_int(w, "input_bytes", a.file_bytes);
+        json_int(w, "pages", a.page_count);
+        json_begin_object(w, "totals");
+        json_int(w, "images", a.image_count);
+        json_int(w, "image_bytes", a.image_bytes);
+        json_int(w, "rewritable_image_bytes", a.rewritable_image_bytes);
+        json_int(w, "fonts", a.font_count);
+        json_int(w, "embedded_fonts", a.font_file_count);
+        json_int(w, "font_bytes", a.font_bytes);
+        json_int(w, "content_streams", a.content_stream_count);
+        json_int(w, "content_bytes", a.content_bytes);
+        json_int(w, "metadata_bytes", a.metadata_bytes);
+        json_int(w, "other_stream_bytes", a.other_stream_bytes);
+        json_end_object(w);
+
+        json_begin_array(w, "images");
+        for (int i = 0; i < a.image_count; i++) {
+            json_begin_object(w, NULL);
+            json_int(w, "object", a.object_num[i]);
+            json_int(w, "width", a.width[i]);
+            json_int(w, "height", a.height[i]);
+            json_int(w, "bits_per_component", a.bits_per_component[i]);
+            json_string(w, "colorspace", a.strings + a.colorspace[i]);
+            json_string(w, "filters", a.strings + a.filters[i]);
+            json_int(w, "stream_bytes", a.stream_bytes[i]);
+            json_double(w, "effective_dpi", a.effective_dpi[i]);
+            json_int(w, "uses", a.use_count[i]);
+            json_bool(w, "rewritable", a.rewritable[i]);
+            json_end_object(w);
+        }
+        json_end_array(w);
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    mino_drop_document_analysis(ctx, &a);
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+// Graft every page of one source onto the end of dst
+static int append_document(
+    fz_context *ctx,
+    pdf_document *dst,
+    const char *path,
+    mino_job *job,
+    int *pages_added
+) {
+    fz_document *doc = mino_open_document_job(ctx, path, job);
+    if (!doc) return -1;
+
+    int result = -1;
+    pdf_document *src = mino_pdf_specifics(ctx, doc);
+    pdf_graft_map *map = src ? mino_new_graft_map(ctx, dst) : NULL;
+    if (map) {
+        int count = mino_count_pages(ctx, doc);
+        result = count < 0 ? -1 : 0;
+        for (int i = 0; i < count && result == 0; i++) {
+            result = mino_graft_page(ctx, map, -1, src, i);
+            if (result == 0) (*pages_added)++;
+        }
+        mino_drop_graft_map(ctx, map);
+    }
+
+    mino_drop_document(ctx, doc);
+    return result;
+}
+
+static int run_merge(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    if (opts->input_count < 2 || opts->output_count != 1) return EXIT_USAGE;
+
+    const char *output = opts->outputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    int pages = 0;
+    const char *failed_input = NULL;
+
+    pdf_document *dst = mino_create_pdf_document(ctx);
+    if (dst) {
+        status = MINO_STATUS_OK;
+        for (int i = 0; i < opts->input_count && status == MINO_STATUS_OK; i++) {
+            if (append_document(ctx, dst, opts->inputs[i], &job, &pages) != 0) {
+                failed_input = opts->inputs[i];
+                status = MINO_STATUS_ERROR;
+            }
+        }
+        if (status == MINO_STATUS_OK) {
+            status = mino_save_pdf_job(ctx, dst, output, 3, &job);
+        }
+        mino_drop_pdf_document(ctx, dst);
+    }
+
+    begin_report(w, "merge", status, last_error("Merge failed"));
+    json_begin_array(w, "inputs");
+    for (int i = 0; i < opts->input_count; i++) {
+        json_string(w, NULL, opts->inputs[i]);
+    }
+    json_end_array(w);
+    if (failed_input) {
+        json_string(w, "failed_input", failed_input);
+    }
+    if (status == MINO_STATUS_OK) {
+        json_string(w, "output", output);
+        json_int(w, "output_bytes", mino_get_file_size(output));
+        json_int(w, "pages", pages);
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+// Copy pages [first, last] (0-based, inclusive) of src into a new file
+static int extract_pages(
+    fz_context *ctx,
+    pdf_document *src,
+    int first,
+    int last,
+    const char *output,
+    mino_job *job
+) {
+    pdf_document *dst = mino_create_pdf_document(ctx);
+    if (!dst) return MINO_STATUS_ERROR;
+
+    int status = MINO_STATUS_ERROR;
+    pdf_graft_map *map = mino_new_graft_map(ctx, dst);
+    if (map) {
+        status = MINO_STATUS_OK;
+        for (int i = first; i <= last && status == MINO_STATUS_OK; i++) {
+            if (mino_graft_page(ctx, map, -1, src, i) != 0) {
+                status = MINO_STATUS_ERROR;
+            }
+        }
+        mino_drop_graft_map(ctx, map);
+    }
+
+    if (status == MINO_STATUS_OK) {
+        status = mino_save_pdf_job(ctx, dst, output, 3, job);
+    }
+    mino_drop_pdf_document(ctx, dst);
+    return status;
+}
+
+static int run_split(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    int by_range = opts->range_start > 0;
+    int by_page = opts->split_at > 0;
+    if (opts->input_count != 1 || by_range == by_page) return EXIT_USAGE;
+    if (opts->output_count != (by_range ? 1 : 2)) return EXIT_USAGE;
+
+    const char *input = opts->inputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    const char *error = NULL;
+    int page_count = -1;
+
+    fz_document *doc = mino_open_document_job(ctx, input, &job);
+    pdf_document *src = doc ? mino_pdf_specifics(ctx, doc) : NULL;
+    if (src) {
+        page_count = mino_count_pages(ctx, doc);
+
+        if (by_range) {
+            if (opts->range_start > opts->range_end || opts->range_end > page_count) {
+                error = "Invalid page range";
+            } else {
+                status = extract_pages(
+                    ctx, src, opts->range_start - 1, opts->range_end - 1, opts->outputs[0], &job
+                );
+            }
+        } else if (opts->split_at < 2 || opts->split_at > page_count) {
+            error = "Split page must be between 2 and the page count";
+        } else {
+            status = extract_pages(ctx, src, 0, opts->split_at - 2, opts->outputs[0], &job);
+            if (status == MINO_STATUS_OK) {
+                status = extract_pages(
+                    ctx, src, opts->split_at - 1, page_count - 1, opts->outputs[1], &job
+                );
+            }
+        }
+    } else if (doc) {
+        error = "The file is not a valid PDF document";
+    }
+    if (doc) {
+        mino_drop_document(ctx, doc);
+    }
+
+    begin_report(w, "split", status, error ? error : last_error("Split failed"));
+    json_string(w, "input", input);
+    json_int(w, "page_count", page_count);
+    if (status == MINO_STATUS_OK) {
+        json_begin_array(w, "outputs");
+        for (int i = 0; i < opts->output_count; i++) {
+            report_output(w, opts->outputs[i]);
+        }
+        json_end_array(w);
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+static int run_render(fz_context *ctx, const cli_options *opts, json_writer *w) {
+    if (opts->input_count != 1 || opts->output_count != 1 || opts->page < 1) return EXIT_USAGE;
+
+    const char *input = opts->inputs[0];
+    const char *output = opts->outputs[0];
+    mino_job_stats stats = {0};
+    mino_job job = { .stats = &stats };
+    int64_t start = now_ns();
+    int status = MINO_STATUS_ERROR;
+    int width = 0;
+    int height = 0;
+
+    fz_document *doc = mino_open_document_job(ctx, input, &job);
+    if (doc) {
+        fz_pixmap *pix = mino_render_page_job(ctx, doc, opts->page - 1, opts->zoom, &job);
+        if (pix) {
+            width = mino_pixmap_width(ctx, pix);
+            height = mino_pixmap_height(ctx, pix);
+            status = mino_save_pixmap_png(ctx, pix, output) == 0 ? MINO_STATUS_OK : MINO_STATUS_ERROR;
+            mino_drop_pixmap(ctx, pix);
+        }
+        mino_drop_document(ctx, doc);
+    }
+
+    begin_report(w, "render", status, last_error("Render failed"));
+    json_string(w, "input", input);
+    json_int(w, "page", opts->page);
+    json_double(w, "zoom", opts->zoom);
+    if (status == MINO_STATUS_OK) {
+        json_string(w, "output", output);
+        json_int(w, "width", width);
+        json_int(w, "height", height);
+        json_int(w, "output_bytes", mino_get_file_size(output));
+    }
+    json_int(w, "duration_ns", now_ns() - start);
+    json_stats(w, "stats", &stats);
+    json_end_object(w);
+
+    return status == MINO_STATUS_OK ? EXIT_OK : EXIT_FAILED;
+}
+
+// MARK: - Main
+
+int main(int argc, char **argv) {
+    cli_options opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        usage(stderr);
+        return EXIT_USAGE;
+    }
+
+    int (*command)(fz_context *, const cli_options *, json_writer *) = NULL;
+    if (strcmp(opts.command, "compress") == 0) command = run_compress;
+    else if (strcmp(opts.command, "estimate") == 0) command = run_estimate;
+    else if (strcmp(opts.command, "analyze") == 0) command = run_analyze;
+    else if (strcmp(opts.command, "merge") == 0) command = run_merge;
+    else if (strcmp(opts.command, "split") == 0) command = run_split;
+    else if (strcmp(opts.command, "render") == 0) command = run_render;
+    else if (strcmp(opts.command, "help") == 0 || strcmp(opts.command, "--help") == 0) {
+        usage(stdout);
+        return EXIT_OK;
+    }
+
+    if (!command) {
+        usage(stderr);
+        return EXIT_USAGE;
+    }
+
+    fz_context *ctx = mino_create_context_with_budget((size_t)opts.memory_limit);
+    if (!ctx) {
+        fprintf(stderr, "mino-cli: %s\n", last_error("Failed to create MuPDF context"));
+        return EXIT_FAILED;
+    }
+
+    if (opts.image_cache_dir) {
+        opts.image_cache = mino_image_cache_open(opts.image_cache_dir, IMAGE_CACHE_BYTES);
+        if (!opts.image_cache) {
+            fprintf(stderr, "mino-cli: %s\n", last_error("Failed to open image cache"));
+        }
+    }
+
+    json_writer w;
+    json_init(&w, stdout);
+
+    int result = command(ctx, &opts, &w);
+    if (result == EXIT_USAGE) {
+        usage(stderr);
+    }
+
+    mino_image_cache_close(opts.image_cache);
+    mino_drop_context(ctx);
+    return result;
+}
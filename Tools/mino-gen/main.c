@@ -0,0 +1,913 @@
+//
+//  main.c
+//  mino-gen
+//
+//  Generates synthetic PDFs for benchmarking. Output depends only on the
+//  options and the seed (and the MuPDF version), so a corpus can be rebuilt
+//  byte for byte instead of being checked in.
+//
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "MuPDFHelpers.h"
+#include "json.h"
+
+#define PAGE_WIDTH 612.0f
+#define PAGE_HEIGHT 792.0f
+#define MARGIN 36.0f
+#define MAX_PAGES 1000000
+#define MAX_FONTS 64
+#define MAX_PROFILES 16
+
+enum {
+    EXIT_OK = 0,
+    EXIT_FAILED = 1,
+    EXIT_USAGE = 2
+};
+
+typedef enum {
+    IMAGE_JPEG,
+    IMAGE_FLATE,
+    IMAGE_JPX,
+    IMAGE_MIXED,    // Alternate JPEG and Flate
+    IMAGE_INDEXED,  // 8-bit palette over DeviceRGB, stored uncompressed
+    IMAGE_MASK      // 1-bit stencil (/ImageMask), painted in the fill color
+} image_format;
+
+static const char *const format_names[] = { "jpeg", "flate", "jpx", "mixed", "indexed", "mask" };
+
+typedef struct {
+    const char *output;
+    const char *jpx_source;     // JP2/J2K file embedded for JPX images
+    uint64_t seed;
+    int pages;
+    int images_per_page;
+    int image_width;
+    int image_height;
+    int gray;
+    image_format format;
+    int jpeg_quality;
+    int unique_images;          // Distinct images placed in rotation; 0 = all distinct
+    int fonts;
+    int text_lines;             // Text lines per page
+    int paths;                  // Vector operations per page
+    int duplicate_resources;    // Store each use of an image or font as its own object
+    int icc_profiles;           // ICCBased profiles rotated over repeats of an image; 0 = device
+    int object_streams;
+} gen_options;
+
+// Defaults for each corpus category read by mino-bench
+typedef struct {
+    const char *name;
+    gen_options options;
+} gen_profile;
+
+static const gen_profile profiles[] = {
+    { "scanned", {
+        .pages = 20, .images_per_page = 1, .image_width = 1700, .image_height = 2200,
+        .gray = 1, .format = IMAGE_JPEG, .jpeg_quality = 85,
+    } },
+    { "image-heavy", {
+        .pages = 20, .images_per_page = 6, .image_width = 1600, .image_height = 1200,
+        .format = IMAGE_MIXED, .jpeg_quality = 92, .fonts = 2, .text_lines = 10, .paths = 20,
+    } },
+    { "vector-heavy", {
+        .pages = 50, .fonts = 1, .text_lines = 5, .paths = 2000,
+    } },
+    { "text-only", {
+        .pages = 100, .fonts = 4, .text_lines = 60,
+    } },
+    { "large", {
+        .pages = 1500, .images_per_page = 1, .image_width = 400, .image_height = 300,
+        .format = IMAGE_JPEG, .jpeg_quality = 80, .unique_images = 25,
+        .fonts = 3, .text_lines = 40, .paths = 10, .object_streams = 1,
+    } },
+};
+
+#define PROFILE_COUNT ((int)(sizeof(profiles) / sizeof(profiles[0])))
+
+static const char *const base14_fonts[] = {
+    "Helvetica", "Times-Roman", "Courier", "Helvetica-Bold", "Times-Bold",
+    "Courier-Bold", "Helvetica-Oblique", "Times-Italic", "Courier-Oblique",
+    "Helvetica-BoldOblique", "Times-BoldItalic", "Courier-BoldOblique",
+    "Symbol", "ZapfDingbats",
+};
+
+static const char *const words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+    "magna", "aliqua", "enim", "ad", "minim", "veniam", "quis", "nostrud",
+    "exercitation", "ullamco", "laboris", "nisi", "aliquip", "ex", "ea", "commodo",
+};
+
+// MARK: - Random Numbers
+
+// splitmix64: small, fast and identical on every platform
+typedef struct {
+    uint64_t state;
+} gen_rng;
+
+static uint64_t rng_next(gen_rng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Uniform integer in [0, bound)
+static int rng_int(gen_rng *rng, int bound) {
+    return bound > 0 ? (int)(rng_next(rng) % (uint64_t)bound) : 0;
+}
+
+// Uniform float in [lo, hi)
+static float rng_float(gen_rng *rng, float lo, float hi) {
+    return lo + (hi - lo) * (float)((rng_next(rng) >> 40) / (double)(1ull << 24));
+}
+
+// Independent stream per image or page, so output does not depend on visit order
+static gen_rng rng_for(uint64_t seed, uint64_t stream) {
+    gen_rng rng = { seed ^ (stream * 0xD1B54A32D192ED03ull) };
+    rng_next(&rng);
+    return rng;
+}
+
+// MARK: - Images
+
+static unsigned char clamp_byte(int value) {
+    return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+// Scanned-page look: paper tone, lines of dark "words" and sensor noise
+static void fill_scan(unsigned char *samples, int w, int h, int stride, gen_rng *rng) {
+    int paper = 235 + rng_int(rng, 15);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            samples[y * stride + x] = clamp_byte(paper + rng_int(rng, 13) - 6);
+        }
+    }
+
+    int line_height = h / 45 > 4 ? h / 45 : 4;
+    for (int top = h / 12; top + line_height < h - h / 12; top += line_height * 2) {
+        int x = w / 10;
+        while (x < w - w / 10) {
+            int word = line_height * (2 + rng_int(rng, 6));
+            int ink = 20 + rng_int(rng, 50);
+            for (int y = top; y < top + line_height; y++) {
+                for (int i = x; i < x + word && i < w - w / 10; i++) {
+                    if (rng_int(rng, 4) != 0) {
+                        samples[y * stride + i] = clamp_byte(ink + rng_int(rng, 20));
+                    }
+                }
+            }
+            x += word + line_height;
+        }
+    }
+}
+
+// Photo-like content: a smooth gradient, a few soft shapes and fine noise
+static void fill_photo(unsigned char *samples, int w, int h, int n, int stride, gen_rng *rng) {
+    float corners[4][3];
+    for (int c = 0; c < 4; c++) {
+        for (int k = 0; k < 3; k++) {
+            corners[c][k] = rng_float(rng, 0, 255);
+        }
+    }
+
+    for (int y = 0; y < h; y++) {
+        float fy = h > 1 ? (float)y / (float)(h - 1) : 0;
+        for (int x = 0; x < w; x++) {
+            float fx = w > 1 ? (float)x / (float)(w - 1) : 0;
+            unsigned char *p = samples + y * stride + x * n;
+            for (int k = 0; k < n; k++) {
+                float top = corners[0][k] + (corners[1][k] - corners[0][k]) * fx;
+                float bottom = corners[2][k] + (corners[3][k] - corners[2][k]) * fx;
+                p[k] = clamp_byte((int)(top + (bottom - top) * fy) + rng_int(rng, 9) - 4);
+            }
+        }
+    }
+
+    int shapes = 3 + rng_int(rng, 8);
+    for (int s = 0; s < shapes; s++) {
+        float cx = rng_float(rng, 0, (float)w);
+        float cy = rng_float(rng, 0, (float)h);
+        float radius = rng_float(rng, 0.05f, 0.3f) * (float)(w < h ? w : h);
+        float color[3] = { rng_float(rng, 0, 255), rng_float(rng, 0, 255), rng_float(rng, 0, 255) };
+
+        int y0 = (int)fmaxf(0, cy - radius), y1 = (int)fminf((float)h, cy + radius);
+        int x0 = (int)fmaxf(0, cx - radius), x1 = (int)fminf((float)w, cx + radius);
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) {
+                float d = sqrtf((x - cx) * (x - cx) + (y - cy) * (y - cy)) / radius;
+                if (d >= 1) continue;
+                float a = 1 - d * d;
+                unsigned char *p = samples + y * stride + x * n;
+                for (int k = 0; k < n; k++) {
+                    p[k] = clamp_byte((int)(p[k] + (color[k] - p[k]) * a));
+                }
+            }
+        }
+    }
+}
+
+// An image dictionary over raw samples; the writer deflates the stream
+static pdf_obj *add_raw_image(
+    fz_context *ctx,
+    pdf_document *doc,
+    int w,
+    int h,
+    int bpc,
+    pdf_obj *colorspace,
+    fz_buffer *samples
+) {
+    pdf_obj *dict = pdf_new_dict(ctx, doc, 6);
+    pdf_obj *ref = NULL;
+
+    fz_try(ctx) {
+        pdf_dict_put(ctx, dict, PDF_NAME(Type), PDF_NAME(XObject));
+        pdf_dict_put(ctx, dict, PDF_NAME(Subtype), PDF_NAME(Image));
+        pdf_dict_put_int(ctx, dict, PDF_NAME(Width), w);
+        pdf_dict_put_int(ctx, dict, PDF_NAME(Height), h);
+        pdf_dict_put_int(ctx, dict, PDF_NAME(BitsPerComponent), bpc);
+        if (colorspace) {
+            pdf_dict_put(ctx, dict, PDF_NAME(ColorSpace), colorspace);
+        } else {
+            pdf_dict_put_bool(ctx, dict, PDF_NAME(ImageMask), 1);
+        }
+        ref = pdf_add_stream(ctx, doc, samples, dict, 0);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, dict);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return ref;
+}
+
+// Photo content quantized to a 6x6x6 color cube, as an Indexed image
+static pdf_obj *add_indexed_image(fz_context *ctx, pdf_document *doc, const gen_options *opts, gen_rng *rng) {
+    int w = opts->image_width, h = opts->image_height;
+    unsigned char *rgb = NULL;
+    fz_buffer *samples = NULL;
+    pdf_obj *colorspace = NULL;
+    pdf_obj *ref = NULL;
+
+    fz_var(rgb);
+    fz_var(samples);
+    fz_var(colorspace);
+
+    fz_try(ctx) {
+        rgb = fz_malloc(ctx, (size_t)w * (size_t)h * 3);
+        fill_photo(rgb, w, h, 3, w * 3, rng);
+
+        samples = fz_new_buffer(ctx, (size_t)w * (size_t)h);
+        for (int i = 0; i < w * h; i++) {
+            const unsigned char *p = rgb + i * 3;
+            fz_append_byte(ctx, samples, (p[0] / 43) * 36 + (p[1] / 43) * 6 + p[2] / 43);
+        }
+
+        unsigned char lookup[216 * 3];
+        for (int i = 0; i < 216; i++) {
+            lookup[i * 3] = (unsigned char)(i / 36 * 51);
+            lookup[i * 3 + 1] = (unsigned char)(i / 6 % 6 * 51);
+            lookup[i * 3 + 2] = (unsigned char)(i % 6 * 51);
+        }
+        colorspace = pdf_new_array(ctx, doc, 4);
+        pdf_array_push(ctx, colorspace, PDF_NAME(Indexed));
+        pdf_array_push(ctx, colorspace, PDF_NAME(DeviceRGB));
+        pdf_array_push_int(ctx, colorspace, 215);
+        pdf_array_push_string(ctx, colorspace, (const char *)lookup, sizeof(lookup));
+
+        ref = add_raw_image(ctx, doc, w, h, 8, colorspace, samples);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, colorspace);
+        fz_drop_buffer(ctx, samples);
+        fz_free(ctx, rgb);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return ref;
+}
+
+// Scanned-page content thresholded to a 1-bit stencil mask
+static pdf_obj *add_mask_image(fz_context *ctx, pdf_document *doc, const gen_options *opts, gen_rng *rng) {
+    int w = opts->image_width, h = opts->image_height;
+    int row = (w + 7) / 8;
+    unsigned char *gray = NULL;
+    fz_buffer *samples = NULL;
+    pdf_obj *ref = NULL;
+
+    fz_var(gray);
+    fz_var(samples);
+
+    fz_try(ctx) {
+        gray = fz_malloc(ctx, (size_t)w * (size_t)h);
+        fill_scan(gray, w, h, w, rng);
+
+        // Sample 0 paints: ink becomes 0 bits
+        samples = fz_new_buffer(ctx, (size_t)row * (size_t)h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < row * 8; x += 8) {
+                unsigned char bits = 0;
+                for (int b = 0; b < 8; b++) {
+                    int paper = x + b >= w || gray[y * w + x + b] >= 128;
+                    bits = (unsigned char)(bits << 1 | paper);
+                }
+                fz_append_byte(ctx, samples, bits);
+            }
+        }
+
+        ref = add_raw_image(ctx, doc, w, h, 1, NULL, samples);
+    }
+    fz_always(ctx) {
+        fz_drop_buffer(ctx, samples);
+        fz_free(ctx, gray);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return ref;
+}
+
+static image_format format_for(const gen_options *opts, int index) {
+    if (opts->format == IMAGE_MIXED) {
+        return index % 2 == 0 ? IMAGE_JPEG : IMAGE_FLATE;
+    }
+    return opts->format;
+}
+
+// Create image number `index` and add it to the document
+static pdf_obj *add_image(
+    fz_context *ctx,
+    pdf_document *doc,
+    const gen_options *opts,
+    fz_buffer *jpx_data,
+    int index
+) {
+    image_format format = format_for(opts, index);
+    fz_pixmap *pix = NULL;
+    fz_buffer *encoded = NULL;
+    fz_image *image = NULL;
+    pdf_obj *ref = NULL;
+
+    if (format == IMAGE_INDEXED || format == IMAGE_MASK) {
+        gen_rng rng = rng_for(opts->seed, 0x100000000ull + (uint64_t)index);
+        return format == IMAGE_INDEXED
+            ? add_indexed_image(ctx, doc, opts, &rng)
+            : add_mask_image(ctx, doc, opts, &rng);
+    }
+
+    fz_var(pix);
+    fz_var(encoded);
+    fz_var(image);
+
+    fz_try(ctx) {
+        if (format == IMAGE_JPX) {
+            // MuPDF cannot encode JPEG 2000; embed the supplied file as is
+            image = fz_new_image_from_buffer(ctx, jpx_data);
+        } else {
+            fz_colorspace *cs = opts->gray ? fz_device_gray(ctx) : fz_device_rgb(ctx);
+            pix = fz_new_pixmap(ctx, cs, opts->image_width, opts->image_height, NULL, 0);
+
+            gen_rng rng = rng_for(opts->seed, 0x100000000ull + (uint64_t)index);
+            unsigned char *samples = fz_pixmap_samples(ctx, pix);
+            int stride = fz_pixmap_stride(ctx, pix);
+            if (opts->gray) {
+                fill_scan(samples, opts->image_width, opts->image_height, stride, &rng);
+            } else {
+                fill_photo(samples, opts->image_width, opts->image_height, 3, stride, &rng);
+            }
+
+            if (format == IMAGE_JPEG) {
+                encoded = fz_new_buffer_from_pixmap_as_jpeg(
+                    ctx, pix, fz_default_color_params, opts->jpeg_quality, 0
+                );
+                image = fz_new_image_from_buffer(ctx, encoded);
+            } else {
+                // Stored uncompressed; the writer deflates it
+                image = fz_new_image_from_pixmap(ctx, pix, NULL);
+            }
+        }
+        ref = pdf_add_image(ctx, doc, image);
+    }
+    fz_always(ctx) {
+        fz_drop_image(ctx, image);
+        fz_drop_buffer(ctx, encoded);
+        fz_drop_pixmap(ctx, pix);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return ref;
+}
+
+// MARK: - Generation
+
+typedef struct {
+    fz_context *ctx;
+    pdf_document *doc;
+    const gen_options *opts;
+    fz_buffer *jpx_data;
+    pdf_obj **image_pool;       // Shared image objects, indexed like unique_images
+    pdf_obj **fonts;            // Shared font objects
+    pdf_obj *profiles[MAX_PROFILES];    // Indirect [/ICCBased stream] arrays
+    int placements;             // Images placed so far
+    int image_objects;          // Image objects created
+} generator;
+
+static pdf_obj *add_font(fz_context *ctx, pdf_document *doc, int index) {
+    const char *name = base14_fonts[index % (int)(sizeof(base14_fonts) / sizeof(base14_fonts[0]))];
+    pdf_obj *font = pdf_new_dict(ctx, doc, 4);
+    pdf_obj *ref = NULL;
+
+    fz_try(ctx) {
+        pdf_dict_put(ctx, font, PDF_NAME(Type), PDF_NAME(Font));
+        pdf_dict_put(ctx, font, PDF_NAME(Subtype), PDF_NAME(Type1));
+        pdf_dict_put_name(ctx, font, PDF_NAME(BaseFont), name);
+        pdf_dict_put(ctx, font, PDF_NAME(Encoding), PDF_NAME(WinAnsiEncoding));
+        ref = pdf_add_object(ctx, doc, font);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, font);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+
+    return ref;
+}
+
+// ICC profile streams that differ only in their bytes. MuPDF is built without
+// ICC support, so every one of them draws through its alternate device space.
+static void add_profiles(generator *gen) {
+    fz_context *ctx = gen->ctx;
+    int n = gen->opts->gray ? 1 : 3;
+    fz_buffer *data = NULL;
+    pdf_obj *dict = NULL;
+    pdf_obj *stream = NULL;
+    pdf_obj *array = NULL;
+
+    fz_var(data);
+    fz_var(dict);
+    fz_var(stream);
+    fz_var(array);
+
+    fz_try(ctx) {
+        for (int i = 0; i < gen->opts->icc_profiles; i++) {
+            data = fz_new_buffer(ctx, 64);
+            fz_append_printf(ctx, data, "mino-gen profile %d of %d\n", i + 1, gen->opts->icc_profiles);
+            dict = pdf_new_dict(ctx, gen->doc, 2);
+            pdf_dict_put_int(ctx, dict, PDF_NAME(N), n);
+            pdf_dict_put(ctx, dict, PDF_NAME(Alternate), n == 1 ? PDF_NAME(DeviceGray) : PDF_NAME(DeviceRGB));
+            stream = pdf_add_stream(ctx, gen->doc, data, dict, 0);
+
+            array = pdf_new_array(ctx, gen->doc, 2);
+            pdf_array_push(ctx, array, PDF_NAME(ICCBased));
+            pdf_array_push(ctx, array, stream);
+            gen->profiles[i] = pdf_add_object(ctx, gen->doc, array);
+
+            pdf_drop_obj(ctx, array);
+            array = NULL;
+            pdf_drop_obj(ctx, stream);
+            stream = NULL;
+            pdf_drop_obj(ctx, dict);
+            dict = NULL;
+            fz_drop_buffer(ctx, data);
+            data = NULL;
+        }
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, array);
+        pdf_drop_obj(ctx, stream);
+        pdf_drop_obj(ctx, dict);
+        fz_drop_buffer(ctx, data);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Image object for the next placement: shared from the pool, or new
+static pdf_obj *next_image(generator *gen) {
+    const gen_options *opts = gen->opts;
+    int placement = gen->placements++;
+    int index = opts->unique_images > 0 ? placement % opts->unique_images : placement;
+
+    if (opts->unique_images > 0 && !opts->duplicate_resources) {
+        if (!gen->image_pool[index]) {
+            gen->image_pool[index] = add_image(gen->ctx, gen->doc, opts, gen->jpx_data, index);
+            gen->image_objects++;
+        }
+        return pdf_keep_obj(gen->ctx, gen->image_pool[index]);
+    }
+
+    gen->image_objects++;
+    pdf_obj *image = add_image(gen->ctx, gen->doc, opts, gen->jpx_data, index);
+
+    // Each round through the unique images moves on to the next profile, so the
+    // same samples are stored under every profile and under each more than once
+    image_format format = format_for(opts, index);
+    if (opts->icc_profiles > 0 && (format == IMAGE_JPEG || format == IMAGE_FLATE)) {
+        int round = opts->unique_images > 0 ? placement / opts->unique_images : 0;
+        pdf_dict_put(gen->ctx, image, PDF_NAME(ColorSpace), gen->profiles[round % opts->icc_profiles]);
+    }
+    return image;
+}
+
+static void append_text(fz_context *ctx, fz_buffer *buf, const gen_options *opts, gen_rng *rng) {
+    float leading = (PAGE_HEIGHT - 2 * MARGIN) / (float)opts->text_lines;
+    float size = leading * 0.8f < 12 ? leading * 0.8f : 12;
+    if (size < 2) size = 2;
+
+    fz_append_string(ctx, buf, "BT\n");
+    for (int i = 0; i < opts->text_lines; i++) {
+        float y = PAGE_HEIGHT - MARGIN - leading * (float)(i + 1);
+        fz_append_printf(ctx, buf, "/F%d %g Tf 1 0 0 1 %g %g Tm (",
+            rng_int(rng, opts->fonts), size, MARGIN, y);
+
+        int length = 0;
+        int limit = (int)((PAGE_WIDTH - 2 * MARGIN) / (size * 0.5f));
+        while (length < limit) {
+            const char *word = words[rng_int(rng, (int)(sizeof(words) / sizeof(words[0])))];
+            fz_append_printf(ctx, buf, "%s ", word);
+            length += (int)strlen(word) + 1;
+        }
+        fz_append_string(ctx, buf, ") Tj\n");
+    }
+    fz_append_string(ctx, buf, "ET\n");
+}
+
+static void append_paths(fz_context *ctx, fz_buffer *buf, const gen_options *opts, gen_rng *rng) {
+    for (int i = 0; i < opts->paths; i++) {
+        float r = rng_float(rng, 0, 1), g = rng_float(rng, 0, 1), b = rng_float(rng, 0, 1);
+        float x = rng_float(rng, 0, PAGE_WIDTH), y = rng_float(rng, 0, PAGE_HEIGHT);
+
+        switch (rng_int(rng, 3)) {
+        case 0:
+            fz_append_printf(ctx, buf, "%g %g %g rg %g %g %g %g re f\n",
+                r, g, b, x, y, rng_float(rng, 2, 120), rng_float(rng, 2, 120));
+            break;
+        case 1:
+            fz_append_printf(ctx, buf, "%g %g %g RG %g w %g %g m %g %g l S\n",
+                r, g, b, rng_float(rng, 0.1f, 3), x, y,
+                rng_float(rng, 0, PAGE_WIDTH), rng_float(rng, 0, PAGE_HEIGHT));
+            break;
+        default:
+            fz_append_printf(ctx, buf, "%g %g %g rg %g %g m %g %g %g %g %g %g c %g %g %g %g %g %g c f\n",
+                r, g, b, x, y,
+                x + rng_float(rng, -80, 80), y + rng_float(rng, -80, 80),
+                x + rng_float(rng, -80, 80), y + rng_float(rng, -80, 80),
+                x + rng_float(rng, -80, 80), y + rng_float(rng, -80, 80),
+                x + rng_float(rng, -80, 80), y + rng_float(rng, -80, 80),
+                x + rng_float(rng, -80, 80), y + rng_float(rng, -80, 80),
+                x, y);
+            break;
+        }
+    }
+}
+
+static void add_page(generator *gen, int number) {
+    fz_context *ctx = gen->ctx;
+    const gen_options *opts = gen->opts;
+    gen_rng rng = rng_for(opts->seed, (uint64_t)number);
+
+    fz_buffer *contents = NULL;
+    pdf_obj *resources = NULL;
+    pdf_obj *image = NULL;
+    pdf_obj *font = NULL;
+    pdf_obj *page = NULL;
+
+    fz_var(contents);
+    fz_var(resources);
+    fz_var(image);
+    fz_var(font);
+    fz_var(page);
+
+    fz_try(ctx) {
+        contents = fz_new_buffer(ctx, 4096);
+        resources = pdf_new_dict(ctx, gen->doc, 2);
+
+        if (opts->images_per_page > 0) {
+            pdf_obj *xobjects = pdf_dict_put_dict(ctx, resources, PDF_NAME(XObject), opts->images_per_page);
+            int cols = (int)ceil(sqrt((double)opts->images_per_page));
+            int rows = (opts->images_per_page + cols - 1) / cols;
+            float cell_w = (PAGE_WIDTH - 2 * MARGIN) / (float)cols;
+            float cell_h = (PAGE_HEIGHT - 2 * MARGIN) / (float)rows;
+
+            for (int i = 0; i < opts->images_per_page; i++) {
+                char name[16];
+                snprintf(name, sizeof(name), "Im%d", i);
+                image = next_image(gen);
+                pdf_dict_puts(ctx, xobjects, name, image);
+                pdf_drop_obj(ctx, image);
+                image = NULL;
+
+                float x = MARGIN + cell_w * (float)(i % cols);
+                float y = PAGE_HEIGHT - MARGIN - cell_h * (float)(i / cols + 1);
+                fz_append_printf(ctx, contents, "q %g 0 0 %g %g %g cm /%s Do Q\n",
+                    cell_w, cell_h, x, y, name);
+            }
+        }
+
+        append_paths(ctx, contents, opts, &rng);
+
+        if (opts->fonts > 0 && opts->text_lines > 0) {
+            pdf_obj *fonts = pdf_dict_put_dict(ctx, resources, PDF_NAME(Font), opts->fonts);
+            for (int i = 0; i < opts->fonts; i++) {
+                char name[16];
+                snprintf(name, sizeof(name), "F%d", i);
+                font = opts->duplicate_resources
+                    ? add_font(ctx, gen->doc, i)
+                    : pdf_keep_obj(ctx, gen->fonts[i]);
+                pdf_dict_puts(ctx, fonts, name, font);
+                pdf_drop_obj(ctx, font);
+                font = NULL;
+            }
+            append_text(ctx, contents, opts, &rng);
+        }
+
+        fz_rect mediabox = { 0, 0, PAGE_WIDTH, PAGE_HEIGHT };
+        page = pdf_add_page(ctx, gen->doc, mediabox, 0, resources, contents);
+        pdf_insert_page(ctx, gen->doc, INT_MAX, page);
+    }
+    fz_always(ctx) {
+        pdf_drop_obj(ctx, page);
+        pdf_drop_obj(ctx, font);
+        pdf_drop_obj(ctx, image);
+        pdf_drop_obj(ctx, resources);
+        fz_drop_buffer(ctx, contents);
+    }
+    fz_catch(ctx) {
+        fz_rethrow(ctx);
+    }
+}
+
+// Fixed document ID derived from the seed, so the writer does not make one up
+static void set_document_id(fz_context *ctx, pdf_document *doc, const gen_options *opts) {
+    unsigned char id[16];
+    gen_rng rng = rng_for(opts->seed, 0xFFFFFFFFull);
+    for (int i = 0; i < 16; i++) {
+        id[i] = (unsigned char)rng_next(&rng);
+    }
+
+    pdf_obj *array = pdf_dict_put_array(ctx, pdf_trailer(ctx, doc), PDF_NAME(ID), 2);
+    pdf_array_push_string(ctx, array, (const char *)id, sizeof(id));
+    pdf_array_push_string(ctx, array, (const char *)id, sizeof(id));
+}
+
+static void generate(generator *gen) {
+    fz_context *ctx = gen->ctx;
+    const gen_options *opts = gen->opts;
+
+    for (int i = 0; i < opts->fonts && !opts->duplicate_resources; i++) {
+        gen->fonts[i] = add_font(ctx, gen->doc, i);
+    }
+    add_profiles(gen);
+
+    for (int i = 0; i < opts->pages; i++) {
+        add_page(gen, i);
+    }
+
+    set_document_id(ctx, gen->doc, opts);
+
+    // No garbage collection: duplicated resources must survive the write
+    pdf_write_options write_opts = pdf_default_write_options;
+    write_opts.do_compress = 1;
+    write_opts.do_compress_images = 1;
+    write_opts.do_use_objstms = opts->object_streams;
+    write_opts.dont_regenerate_id = 1;
+    pdf_save_document(ctx, gen->doc, opts->output, &write_opts);
+}
+
+// MARK: - Options
+
+static void usage(FILE *out) {
+    fputs(
+        "usage: mino-gen -o OUTPUT [--profile NAME] [--seed N] [--pages N]\n"
+        "                [--images N] [--image-size WxH] [--gray]\n"
+        "                [--image-format jpeg|flate|jpx|mixed|indexed|mask]\n"
+        "                [--jpx-source FILE]\n"
+        "                [--jpeg-quality N] [--unique-images N] [--fonts N]\n"
+        "                [--text-lines N] [--paths N] [--duplicate-resources]\n"
+        "                [--icc-profiles N] [--object-streams]\n"
+        "\n"
+        "profiles: scanned, image-heavy, vector-heavy, text-only, large\n"
+        "--images is per page; --text-lines and --paths set content per page.\n"
+        "--unique-images N places N distinct images in rotation (0: all distinct).\n"
+        "--duplicate-resources stores every use of an image or font as its own object.\n"
+        "--icc-profiles N tags repeated jpeg and flate images with N ICCBased\n"
+        "profiles in rotation, one per pass through --unique-images.\n"
+        "jpx images embed --jpx-source as is, since MuPDF has no JPEG 2000 encoder.\n",
+        out
+    );
+}
+
+static int parse_int(const char *text, int min, int max, int *value) {
+    char *end = NULL;
+    long parsed = strtol(text, &end, 10);
+    if (!text[0] || *end || parsed < min || parsed > max) return -1;
+    *value = (int)parsed;
+    return 0;
+}
+
+static int parse_options(int argc, char **argv, gen_options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->pages = 1;
+    opts->image_width = 800;
+    opts->image_height = 600;
+    opts->jpeg_quality = 85;
+    opts->fonts = 1;
+    opts->text_lines = 20;
+
+    // The profile sets defaults; the other options override it wherever they appear
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--profile") != 0) continue;
+
+        int found = 0;
+        for (int p = 0; p < PROFILE_COUNT; p++) {
+            if (strcmp(argv[i + 1], profiles[p].name) == 0) {
+                *opts = profiles[p].options;
+                found = 1;
+            }
+        }
+        if (!found) return -1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (strcmp(arg, "--gray") == 0) {
+            opts->gray = 1;
+            continue;
+        }
+        if (strcmp(arg, "--duplicate-resources") == 0) {
+            opts->duplicate_resources = 1;
+            continue;
+        }
+        if (strcmp(arg, "--object-streams") == 0) {
+            opts->object_streams = 1;
+            continue;
+        }
+
+        if (i + 1 >= argc) return -1;
+        const char *value = argv[++i];
+        int ok = 0;
+
+        if (strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) {
+            opts->output = value;
+        } else if (strcmp(arg, "--profile") == 0) {
+            // Applied above
+        } else if (strcmp(arg, "--seed") == 0) {
+            char *end = NULL;
+            opts->seed = strtoull(value, &end, 10);
+            ok = *end ? -1 : 0;
+        } else if (strcmp(arg, "--pages") == 0) {
+            ok = parse_int(value, 1, MAX_PAGES, &opts->pages);
+        } else if (strcmp(arg, "--images") == 0) {
+            ok = parse_int(value, 0, 1000, &opts->images_per_page);
+        } else if (strcmp(arg, "--image-size") == 0) {
+            ok = sscanf(value, "%dx%d", &opts->image_width, &opts->image_height) == 2
+                && opts->image_width >= 1 && opts->image_width <= 20000
+                && opts->image_height >= 1 && opts->image_height <= 20000 ? 0 : -1;
+        } else if (strcmp(arg, "--image-format") == 0) {
+            ok = -1;
+            for (int f = 0; f < (int)(sizeof(format_names) / sizeof(format_names[0])); f++) {
+                if (strcmp(value, format_names[f]) == 0) {
+                    opts->format = (image_format)f;
+                    ok = 0;
+                }
+            }
+        } else if (strcmp(arg, "--jpx-source") == 0) {
+            opts->jpx_source = value;
+        } else if (strcmp(arg, "--jpeg-quality") == 0) {
+            ok = parse_int(value, 1, 100, &opts->jpeg_quality);
+        } else if (strcmp(arg, "--unique-images") == 0) {
+            ok = parse_int(value, 0, 100000, &opts->unique_images);
+        } else if (strcmp(arg, "--fonts") == 0) {
+            ok = parse_int(value, 0, MAX_FONTS, &opts->fonts);
+        } else if (strcmp(arg, "--text-lines") == 0) {
+            ok = parse_int(value, 0, 1000, &opts->text_lines);
+        } else if (strcmp(arg, "--paths") == 0) {
+            ok = parse_int(value, 0, 1000000, &opts->paths);
+        } else if (strcmp(arg, "--icc-profiles") == 0) {
+            ok = parse_int(value, 0, MAX_PROFILES, &opts->icc_profiles);
+        } else {
+            return -1;
+        }
+        if (ok != 0) return -1;
+    }
+
+    if (!opts->output) return -1;
+    if (opts->format == IMAGE_JPX && opts->images_per_page > 0 && !opts->jpx_source) return -1;
+    return 0;
+}
+
+// MARK: - Main
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    gen_options opts;
+    if (parse_options(argc, argv, &opts) != 0) {
+        usage(stderr);
+        return EXIT_USAGE;
+    }
+
+    fz_context *ctx = mino_create_context();
+    if (!ctx) {
+        fprintf(stderr, "mino-gen: %s\n", mino_get_last_error());
+        return EXIT_FAILED;
+    }
+
+    pdf_document *doc = mino_create_pdf_document(ctx);
+    if (!doc) {
+        fprintf(stderr, "mino-gen: %s\n", mino_get_last_error());
+        mino_drop_context(ctx);
+        return EXIT_FAILED;
+    }
+
+    generator gen = {
+        .ctx = ctx,
+        .doc = doc,
+        .opts = &opts,
+        .image_pool = calloc(opts.unique_images > 0 ? (size_t)opts.unique_images : 1, sizeof(pdf_obj *)),
+        .fonts = calloc(MAX_FONTS, sizeof(pdf_obj *)),
+    };
+
+    int64_t start = now_ns();
+    int status = EXIT_OK;
+    char error[256] = "";
+
+    fz_var(gen);
+
+    fz_try(ctx) {
+        if (!gen.image_pool || !gen.fonts) {
+            fz_throw(ctx, FZ_ERROR_SYSTEM, "Out of memory");
+        }
+        if (opts.format == IMAGE_JPX && opts.jpx_source) {
+            gen.jpx_data = fz_read_file(ctx, opts.jpx_source);
+        }
+        generate(&gen);
+    }
+    fz_always(ctx) {
+        for (int i = 0; i < opts.unique_images; i++) {
+            pdf_drop_obj(ctx, gen.image_pool[i]);
+        }
+        for (int i = 0; i < MAX_FONTS; i++) {
+            pdf_drop_obj(ctx, gen.fonts[i]);
+        }
+        for (int i = 0; i < MAX_PROFILES; i++) {
+            pdf_drop_obj(ctx, gen.profiles[i]);
+        }
+        fz_drop_buffer(ctx, gen.jpx_data);
+    }
+    fz_catch(ctx) {
+        snprintf(error, sizeof(error), "%s", fz_caught_message(ctx));
+        status = EXIT_FAILED;
+        remove(opts.output);
+    }
+
+    free(gen.image_pool);
+    free(gen.fonts);
+    mino_drop_pdf_document(ctx, doc);
+    mino_drop_context(ctx);
+
+    json_writer w;
+    json_init(&w, stdout);
+    json_begin_object(&w, NULL);
+    json_string(&w, "status", status == EXIT_OK ? "ok" : "error");
+    if (status != EXIT_OK) {
+        json_string(&w, "error", error);
+    }
+    json_string(&w, "output", opts.output);
+    json_int(&w, "seed", (int64_t)opts.seed);
+    json_int(&w, "pages", opts.pages);
+    json_int(&w, "image_placements", gen.placements);
+    json_int(&w, "image_objects", gen.image_objects);
+    json_string(&w, "image_format", format_names[opts.format]);
+    json_int(&w, "fonts", opts.fonts);
+    json_bool(&w, "object_streams", opts.object_streams);
+    json_bool(&w, "duplicate_resources", opts.duplicate_resources);
+    json_int(&w, "icc_profiles", opts.icc_profiles);
+    if (status == EXIT_OK) {
+        json_int(&w, "output_bytes", mino_get_file_size(opts.output));
+    }
+    json_int(&w, "duration_ns", now_ns() - start);
+    json_end_object(&w);
+
+    return status;
+}